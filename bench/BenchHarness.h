@@ -0,0 +1,151 @@
+/*
+	Minimal timing harness for the microbenchmarks in bench.cpp.
+	Each benchmark body runs a batch of iterations. The batch size is doubled until one batch takes at least
+	BENCH_MIN_SAMPLE_MS (this also warms caches and the branch predictor), then that batch is timed a number of times.
+	The median per-operation time is reported along with the fastest sample and the median absolute deviation, so
+	noisy runs are easy to spot. The process is pinned to one CPU on Linux so samples don't migrate between cores,
+	multithreaded benchmarks unpin it while they run.
+	Sameer Al Harbi 2022
+*/
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+const double BENCH_MIN_SAMPLE_MS = 20.0;
+
+struct BenchResult
+{
+	std::string name;
+	std::string params;
+	double medianNs; //Per operation
+	double minNs;
+	double madPercent; //Median absolute deviation relative to the median
+	double itemsPerOp; //Work items (noise samples, blocks...) per operation, 0 when not meaningful
+	uint64_t iterations; //Per sample
+};
+
+//Keeps the compiler from optimising away a result that is otherwise unused
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	volatile const T* sink = &value;
+	(void)sink;
+#endif
+}
+
+inline void pinToCurrentCpu()
+{
+#ifdef __linux__
+	int cpu = sched_getcpu();
+	if (cpu >= 0)
+	{
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		sched_setaffinity(0, sizeof(set), &set);
+	}
+#endif
+}
+
+//Let threads started from here on run on any CPU
+inline void unpinCpu(int cpus)
+{
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (int cpu = 0; cpu < cpus && cpu < CPU_SETSIZE; cpu++)
+	{
+		CPU_SET(cpu, &set);
+	}
+	sched_setaffinity(0, sizeof(set), &set);
+#endif
+}
+
+//body(n) must run the operation n times
+template <typename Body>
+BenchResult runBenchmark(const std::string& name, const std::string& params, double itemsPerOp, int samples, Body body)
+{
+	typedef std::chrono::steady_clock clock;
+
+	uint64_t iterations = 1;
+	while (true)
+	{
+		clock::time_point start = clock::now();
+		body(iterations);
+		double ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+		if (ms >= BENCH_MIN_SAMPLE_MS || iterations >= (1ull << 40))
+		{
+			break;
+		}
+		//Jump close to the target once the batch is long enough to measure
+		iterations = ms > 1.0 ? (uint64_t)std::ceil(iterations * BENCH_MIN_SAMPLE_MS / ms) : iterations * 2;
+	}
+
+	std::vector<double> perOp(samples);
+	for (int s = 0; s < samples; s++)
+	{
+		clock::time_point start = clock::now();
+		body(iterations);
+		perOp[s] = std::chrono::duration<double, std::nano>(clock::now() - start).count() / iterations;
+	}
+
+	std::sort(perOp.begin(), perOp.end());
+	double median = perOp[samples / 2];
+
+	std::vector<double> deviation(samples);
+	for (int s = 0; s < samples; s++)
+	{
+		deviation[s] = std::fabs(perOp[s] - median);
+	}
+	std::sort(deviation.begin(), deviation.end());
+
+	BenchResult result;
+	result.name = name;
+	result.params = params;
+	result.medianNs = median;
+	result.minNs = perOp[0];
+	result.madPercent = median > 0.0 ? deviation[samples / 2] / median * 100.0 : 0.0;
+	result.itemsPerOp = itemsPerOp;
+	result.iterations = iterations;
+	return result;
+}
+
+//Human readable time for a per-operation duration in ns
+inline std::string formatTime(double ns)
+{
+	char text[32];
+	if (ns >= 1e6) snprintf(text, sizeof(text), "%.3f ms", ns / 1e6);
+	else if (ns >= 1e3) snprintf(text, sizeof(text), "%.3f us", ns / 1e3);
+	else snprintf(text, sizeof(text), "%.2f ns", ns);
+	return text;
+}
+
+inline void printResult(const BenchResult& r)
+{
+	printf("%-28s %-22s %12s %12s %7.2f%% %10llu", r.name.c_str(), r.params.c_str(), formatTime(r.medianNs).c_str(),
+		formatTime(r.minNs).c_str(), r.madPercent, (unsigned long long)r.iterations);
+	if (r.itemsPerOp > 0.0)
+	{
+		printf("  %10.2f M/s", r.itemsPerOp / r.medianNs * 1000.0);
+	}
+	printf("\n");
+	fflush(stdout);
+}
+
+inline void printHeader()
+{
+	printf("%-28s %-22s %12s %12s %8s %10s  %12s\n", "benchmark", "params", "median", "min", "mad", "iters", "throughput");
+}
@@ -0,0 +1,700 @@
+/*
+	CPU microbenchmarks: Perlin and simplex noise, biome climate, chunk instance generation, region file loads, voxel raycasts,
+	megachunk generation and obj parsing.
+	Before the chunk benchmarks for a size and heightmod are timed, the loops compiled for the size are checked to make
+	the same chunks as the ones for any size, and bench exits with 1 if they don't.
+	Nothing here needs a GL context. Build and run natively:
+		cmake --build <build dir> --target bench && <build dir>/bench [options]
+	Options:
+		--size <n,n..>       chunk sizes to run the chunk benchmarks with (16,32)
+		--heightmod <n,n..>  terrain height modifiers (10,30)
+		--samples <n>        timed samples per benchmark, the median is reported (11)
+		--filter <text>      only run benchmarks whose name contains text
+		--assets <dir>       folder holding Models/ (the source tree's src/Assets)
+	Sameer Al Harbi 2022
+*/
+
+#include "BenchHarness.h"
+
+#include <glm/glm.hpp>
+
+using namespace std;
+using namespace glm;
+
+#include "BlockWorld.h"
+#include "PerlinNoise.hpp"
+#include "SimplexNoise.h"
+#include "RegionStore.h"
+#include "VoxelRaycast.h"
+
+#include <iostream>
+#include <filesystem>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+#ifndef BLOCKWORLD_ASSETS
+#define BLOCKWORLD_ASSETS "."
+#endif
+
+//Same seed as ChunkBlock
+const siv::PerlinNoise::seed_type BENCH_SEED = 78948u;
+
+//Noise samples per operation, one 16^3 chunk worth
+const int NOISE_BATCH = 16;
+
+//Chunks saved for region.load to read back, one region's row
+const int REGION_BENCH_CHUNKS = 64;
+
+//Raycasts are against a square of chunks this many on a side, with rays cast from above looking down at it
+const int RAYCAST_BENCH_GRID = 8;
+const int RAYCAST_BENCH_RAYS = 4096;
+const float RAYCAST_BENCH_REACH = 128.0f;
+
+static vector<int> parseList(const char* text)
+{
+	vector<int> values;
+	stringstream list(text);
+	string item;
+	while (getline(list, item, ','))
+	{
+		values.push_back(atoi(item.c_str()));
+	}
+	return values;
+}
+
+static bool selected(const char* filter, const string& name)
+{
+	return filter == NULL || name.find(filter) != string::npos;
+}
+
+static string sizeParams(int size, int heightmod)
+{
+	return "size=" + to_string(size) + " heightmod=" + to_string(heightmod);
+}
+
+static void benchNoise(int samples, const char* filter)
+{
+	const siv::PerlinNoise perlin{ BENCH_SEED };
+	const SimplexNoise simplex{ BENCH_SEED };
+
+	for (int octaves = 1; octaves <= 4; octaves *= 4)
+	{
+		string params = "octaves=" + to_string(octaves);
+
+		if (selected(filter, "perlin.octave3D"))
+		{
+			//Same sample spacing as ChunkBlock::generateInstances
+			printResult(runBenchmark("perlin.octave3D", params, NOISE_BATCH * NOISE_BATCH * NOISE_BATCH, samples, [&](uint64_t n) {
+				for (uint64_t it = 0; it < n; it++)
+				{
+					double sum = 0.0;
+					for (int i = 0; i < NOISE_BATCH; i++)
+						for (int j = 0; j < NOISE_BATCH; j++)
+							for (int k = 0; k < NOISE_BATCH; k++)
+								sum += perlin.octave3D(j * 0.1 + it, i * 0.1, k * 0.1, octaves);
+					doNotOptimize(sum);
+				}
+			}));
+		}
+
+		//Against perlin.octave3D: the same samples one at a time, then a row of k at a time as ChunkBlock takes them
+		if (selected(filter, "simplex.octave3D"))
+		{
+			printResult(runBenchmark("simplex.octave3D", params, NOISE_BATCH * NOISE_BATCH * NOISE_BATCH, samples, [&](uint64_t n) {
+				for (uint64_t it = 0; it < n; it++)
+				{
+					double sum = 0.0;
+					for (int i = 0; i < NOISE_BATCH; i++)
+						for (int j = 0; j < NOISE_BATCH; j++)
+							for (int k = 0; k < NOISE_BATCH; k++)
+								sum += simplex.octave3D(j * 0.1 + it, i * 0.1, k * 0.1, octaves);
+					doNotOptimize(sum);
+				}
+			}));
+		}
+
+		if (selected(filter, "simplex.octave3DRow"))
+		{
+			double row[NOISE_BATCH];
+			printResult(runBenchmark("simplex.octave3DRow", params, NOISE_BATCH * NOISE_BATCH * NOISE_BATCH, samples, [&](uint64_t n) {
+				for (uint64_t it = 0; it < n; it++)
+				{
+					double sum = 0.0;
+					for (int i = 0; i < NOISE_BATCH; i++)
+						for (int j = 0; j < NOISE_BATCH; j++)
+						{
+							simplex.octave3DRow(j * 0.1 + it, i * 0.1, 0.0, 0.1, NOISE_BATCH, row, octaves);
+							for (int k = 0; k < NOISE_BATCH; k++)
+								sum += row[k];
+						}
+					doNotOptimize(sum);
+				}
+			}));
+		}
+
+		if (selected(filter, "perlin.octave2D"))
+		{
+			printResult(runBenchmark("perlin.octave2D", params, NOISE_BATCH * NOISE_BATCH * NOISE_BATCH, samples, [&](uint64_t n) {
+				for (uint64_t it = 0; it < n; it++)
+				{
+					double sum = 0.0;
+					for (int i = 0; i < NOISE_BATCH * 4; i++)
+						for (int j = 0; j < NOISE_BATCH * NOISE_BATCH / 4; j++)
+							sum += perlin.octave2D(j * 0.1 + it, i * 0.1, octaves);
+					doNotOptimize(sum);
+				}
+			}));
+		}
+
+		if (selected(filter, "simplex.octave2D"))
+		{
+			printResult(runBenchmark("simplex.octave2D", params, NOISE_BATCH * NOISE_BATCH * NOISE_BATCH, samples, [&](uint64_t n) {
+				for (uint64_t it = 0; it < n; it++)
+				{
+					double sum = 0.0;
+					for (int i = 0; i < NOISE_BATCH * 4; i++)
+						for (int j = 0; j < NOISE_BATCH * NOISE_BATCH / 4; j++)
+							sum += simplex.octave2D(j * 0.1 + it, i * 0.1, octaves);
+					doNotOptimize(sum);
+				}
+			}));
+		}
+	}
+}
+
+//Chunks stored as edit lists replay this many edits (a quarter of what they can hold before being compacted)
+const int REGION_BENCH_EDITS = REGION_COMPACT_EDITS / 4;
+
+static void benchRegion(ChunkBlock& chunkblock, int size, int heightmod, int samples, RegionMode mode)
+{
+	error_code error;
+	filesystem::path directory = filesystem::temp_directory_path(error) / ("blockworld-bench-" + to_string(size));
+	filesystem::remove_all(directory, error);
+
+	RegionStore store;
+	if (!store.open(directory.string(), size, mode))
+	{
+		return;
+	}
+	vector<int8_t> offsets((size_t)size * size * size);
+	vector<ChunkEdit> edits;
+	edits.reserve(REGION_COMPACT_EDITS);
+	for (int e = 0; e < REGION_BENCH_EDITS; e++)
+	{
+		ChunkEdit edit = { (uint16_t)(e * 61 % offsets.size()), (int8_t)(e % 8), 0 };
+		edits.push_back(edit);
+	}
+	for (int c = 0; c < REGION_BENCH_CHUNKS; c++)
+	{
+		vec3 position(c * size, -20, 0);
+		chunkblock.generateOffsets(position, heightmod, offsets.data());
+		store.save(position, heightmod, offsets.data(), mode == REGION_EDITS ? &edits : NULL, true);
+	}
+	//Reopened so loads read from the files rather than the write queue
+	store.close();
+	store.open(directory.string(), size, mode);
+
+	string name = mode == REGION_EDITS ? "region.loadEdits" : "region.load";
+	string params = sizeParams(size, heightmod) + (mode == REGION_EDITS ? " edits=" + to_string(REGION_BENCH_EDITS) : "");
+	printResult(runBenchmark(name, params, (double)size * size * size, samples, [&](uint64_t n) {
+		for (uint64_t it = 0; it < n; it++)
+		{
+			vec3 position(it % REGION_BENCH_CHUNKS * size, -20, 0);
+			StoredChunk stored = store.load(position, heightmod, offsets.data(), edits);
+			if (stored == STORED_WHOLE)
+			{
+				chunkblock.buildInstances(position, offsets.data());
+			}
+			else if (stored == STORED_EDITS)
+			{
+				chunkblock.generateOffsets(position, heightmod, offsets.data());
+				for (size_t e = 0; e < edits.size(); e++)
+				{
+					offsets[edits[e].index] = edits[e].offset;
+				}
+				chunkblock.buildInstances(position, offsets.data());
+			}
+			doNotOptimize(chunkblock.translations.data());
+		}
+	}));
+
+	store.close();
+	filesystem::remove_all(directory, error);
+}
+
+//Against raycast.single: the same DDA walking every cell, no chunk, brick or height skipping
+static bool castEveryCell(const VoxelScene& scene, const Ray& ray, RayHit& hit)
+{
+	hit.hit = false;
+	vec3 direction = normalize(ray.direction);
+	ivec3 cell = ivec3(floor(ray.origin));
+	ivec3 step = ivec3(sign(direction));
+	vec3 tDelta, tMax;
+	for (int a = 0; a < 3; a++)
+	{
+		tDelta[a] = step[a] ? fabs(1.0f / direction[a]) : INFINITY;
+		tMax[a] = step[a] ? ((step[a] > 0 ? cell[a] + 1 : cell[a]) - ray.origin[a]) / direction[a] : INFINITY;
+	}
+
+	float t = 0.0f;
+	while (t <= ray.maxDistance)
+	{
+		const ChunkOccupancy* chunk = scene.find(cell);
+		if (chunk)
+		{
+			ivec3 local = cell - chunk->origin;
+			if (local.y >= 0 && local.y < chunk->cells.y && chunk->occupied(local))
+			{
+				hit.hit = true;
+				hit.block = cell;
+				hit.distance = t;
+				return true;
+			}
+		}
+		int a = tMax.x < tMax.y ? (tMax.x < tMax.z ? 0 : 2) : (tMax.y < tMax.z ? 1 : 2);
+		t = tMax[a];
+		cell[a] += step[a];
+		tMax[a] += tDelta[a];
+	}
+	return false;
+}
+
+static void benchRaycast(ChunkBlock& chunkblock, int size, int heightmod, int samples, const char* filter)
+{
+	vector<int8_t> offsets((size_t)size * size * size);
+	vector<ChunkOccupancy> occupancy(RAYCAST_BENCH_GRID * RAYCAST_BENCH_GRID);
+	VoxelScene scene;
+	scene.chunkSize = size;
+	for (int x = 0; x < RAYCAST_BENCH_GRID; x++)
+	{
+		for (int z = 0; z < RAYCAST_BENCH_GRID; z++)
+		{
+			vec3 position(x * size, -20, z * size);
+			chunkblock.generateOffsets(position, heightmod, offsets.data());
+			occupancy[x * RAYCAST_BENCH_GRID + z].build(offsets.data(), size, position);
+			scene.chunks.push_back(&occupancy[x * RAYCAST_BENCH_GRID + z]);
+		}
+	}
+
+	//From a camera height over the grid, looking down at between 10 and 80 degrees in every direction
+	mt19937 random(BENCH_SEED);
+	uniform_real_distribution<float> unit(0.0f, 1.0f);
+	vector<Ray> rays(RAYCAST_BENCH_RAYS);
+	vector<RayHit> hits(RAYCAST_BENCH_RAYS);
+	float extent = (float)RAYCAST_BENCH_GRID * size;
+	for (size_t r = 0; r < rays.size(); r++)
+	{
+		float heading = unit(random) * 6.2831853f;
+		float pitch = radians(10.0f + unit(random) * 70.0f);
+		rays[r].origin = vec3(unit(random) * extent, 20.0f, unit(random) * extent);
+		rays[r].direction = vec3(cos(pitch) * cos(heading), -sin(pitch), cos(pitch) * sin(heading));
+		rays[r].maxDistance = RAYCAST_BENCH_REACH;
+	}
+
+	string params = sizeParams(size, heightmod);
+	if (selected(filter, "raycast.single"))
+	{
+		printResult(runBenchmark("raycast.single", params, RAYCAST_BENCH_RAYS, samples, [&](uint64_t n) {
+			for (uint64_t it = 0; it < n; it++)
+			{
+				for (size_t r = 0; r < rays.size(); r++)
+				{
+					VoxelRaycaster::cast(scene, rays[r], hits[r]);
+				}
+				doNotOptimize(hits.data());
+			}
+		}));
+	}
+	if (selected(filter, "raycast.everyCell"))
+	{
+		printResult(runBenchmark("raycast.everyCell", params, RAYCAST_BENCH_RAYS, samples, [&](uint64_t n) {
+			for (uint64_t it = 0; it < n; it++)
+			{
+				for (size_t r = 0; r < rays.size(); r++)
+				{
+					castEveryCell(scene, rays[r], hits[r]);
+				}
+				doNotOptimize(hits.data());
+			}
+		}));
+	}
+	if (selected(filter, "raycast.batch"))
+	{
+		//One worker per other core, the calling thread makes up the rest
+		int cpus = std::max(1, (int)thread::hardware_concurrency());
+		unpinCpu(cpus);
+		VoxelRaycaster raycaster;
+		raycaster.start(cpus - 1);
+		printResult(runBenchmark("raycast.batch", params + " threads=" + to_string(cpus), RAYCAST_BENCH_RAYS, samples, [&](uint64_t n) {
+			for (uint64_t it = 0; it < n; it++)
+			{
+				raycaster.castBatch(scene, rays.data(), hits.data(), (int)rays.size());
+				doNotOptimize(hits.data());
+			}
+		}));
+		raycaster.stop();
+		pinToCurrentCpu();
+	}
+}
+
+//What building a climate tile costs when it isn't cached, and a chunk's worth of column biomes with the climate noise
+//sampled for every column against looking it up in the cached tiles
+static void benchClimate(const vector<int>& sizes, int samples, const char* filter)
+{
+	ClimateMap climate(BENCH_SEED);
+
+	if (selected(filter, "climate.tile"))
+	{
+		//Every tile a new one, so none are cached
+		printResult(runBenchmark("climate.tile", "", (double)CLIMATE_SAMPLES * CLIMATE_SAMPLES, samples, [&](uint64_t n) {
+			for (uint64_t it = 0; it < n; it++)
+			{
+				glm::vec2 c = climate.climate((float)(climate.tilesBuilt * CLIMATE_TILE_BLOCKS), 0.0f);
+				doNotOptimize(c);
+			}
+		}));
+	}
+
+	for (size_t s = 0; s < sizes.size(); s++)
+	{
+		int size = sizes[s];
+		string params = "size=" + to_string(size);
+
+		if (selected(filter, "climate.chunkDirect"))
+		{
+			printResult(runBenchmark("climate.chunkDirect", params, (double)size * size, samples, [&](uint64_t n) {
+				for (uint64_t it = 0; it < n; it++)
+				{
+					float x = (float)(it % 64 * size);
+					for (int i = 0; i < size; i++)
+					{
+						for (int k = 0; k < size; k++)
+						{
+							ColumnBiome column = ClimateMap::blend(climate.sample(x + i, (float)k), 0.5f);
+							doNotOptimize(column);
+						}
+					}
+				}
+			}));
+		}
+		if (selected(filter, "climate.chunkCached"))
+		{
+			printResult(runBenchmark("climate.chunkCached", params, (double)size * size, samples, [&](uint64_t n) {
+				for (uint64_t it = 0; it < n; it++)
+				{
+					float x = (float)(it % 64 * size);
+					for (int i = 0; i < size; i++)
+					{
+						for (int k = 0; k < size; k++)
+						{
+							ColumnBiome column = climate.column(x + i, (float)k);
+							doNotOptimize(column);
+						}
+					}
+				}
+			}));
+		}
+	}
+}
+
+//Everything generating a chunk produces, to compare the loops compiled for a size with the ones for any size
+struct ChunkOutput
+{
+	vector<int8_t> noise;
+	vector<int8_t> offsets;
+	vector<BlockInstance> instances;
+	vector<BlockInstance> wholeInstances; //Laid out from the offsets alone, as a chunk read back whole is
+	vec3 props[MAX_PROPS_PER_CHUNK];
+};
+
+static void generateChunk(ChunkBlock& chunkblock, vec3 position, int heightmod, ChunkOutput& out)
+{
+	chunkblock.generateInstances(position, heightmod);
+	out.noise = chunkblock.noise;
+	out.offsets = chunkblock.offsets;
+	out.instances = chunkblock.translations;
+	for (int i = 0; i < MAX_PROPS_PER_CHUNK; i++)
+	{
+		out.props[i] = chunkblock.getPropPosition(i);
+	}
+	chunkblock.buildInstances(position, out.offsets.data());
+	out.wholeInstances = chunkblock.translations;
+}
+
+static bool sameInstances(const vector<BlockInstance>& a, const vector<BlockInstance>& b)
+{
+	return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(BlockInstance)) == 0);
+}
+
+//The specialised loops are only worth timing if they make the same chunks, checked for both noise backends at a few
+//positions (negative ones too). False, with what differed printed, if they don't
+static bool checkSpecialised(ChunkBlock& chunkblock, int size, int heightmod)
+{
+	const vec3 positions[] = { vec3(0, -20, 0), vec3(size, -20, 3 * size), vec3(-2 * size, -20, -5 * size) };
+	const NoiseBackend backends[] = { NOISE_PERLIN, NOISE_SIMPLEX };
+	bool same = true;
+	for (int n = 0; n < 2; n++)
+	{
+		chunkblock.backend = backends[n];
+		for (int p = 0; p < 3; p++)
+		{
+			ChunkOutput sized, any;
+			chunkblock.specialised = true;
+			generateChunk(chunkblock, positions[p], heightmod, sized);
+			chunkblock.specialised = false;
+			generateChunk(chunkblock, positions[p], heightmod, any);
+
+			const char* differs = NULL;
+			if (sized.noise != any.noise) differs = "noise";
+			else if (sized.offsets != any.offsets) differs = "offsets";
+			else if (!sameInstances(sized.instances, any.instances)) differs = "instances";
+			else if (!sameInstances(sized.wholeInstances, any.wholeInstances)) differs = "instances laid out from offsets";
+			else if (memcmp(sized.props, any.props, sizeof(sized.props)) != 0) differs = "props";
+			if (differs)
+			{
+				cerr << "Chunk loops for size " << size << " make different " << differs << " to the ones for any size, at heightmod "
+					<< heightmod << " with " << (backends[n] == NOISE_SIMPLEX ? "simplex" : "perlin") << " noise at "
+					<< positions[p].x << "," << positions[p].z << endl;
+				same = false;
+			}
+		}
+	}
+	chunkblock.backend = NOISE_PERLIN;
+	chunkblock.specialised = true;
+	return same;
+}
+
+static bool benchChunks(const vector<int>& sizes, const vector<int>& heightmods, int samples, const char* filter)
+{
+	BlockWorld* bw = new BlockWorld();
+
+	for (size_t s = 0; s < sizes.size(); s++)
+	{
+		int size = sizes[s];
+		bw->chunkblock.size = size;
+
+		for (size_t h = 0; h < heightmods.size(); h++)
+		{
+			int heightmod = heightmods[h];
+			string params = sizeParams(size, heightmod);
+
+			if ((selected(filter, "chunk.generateInstances") || selected(filter, "chunk.generateAnySize")
+				|| selected(filter, "chunk.buildInstances") || selected(filter, "chunk.buildInstancesAnySize"))
+				&& !checkSpecialised(bw->chunkblock, size, heightmod))
+			{
+				delete bw;
+				return false;
+			}
+
+			if (selected(filter, "chunk.generateInstances"))
+			{
+				printResult(runBenchmark("chunk.generateInstances", params, (double)size * size * size, samples, [&](uint64_t n) {
+					for (uint64_t it = 0; it < n; it++)
+					{
+						bw->chunkblock.generateInstances(vec3(it % 64 * size, -20, 0), heightmod);
+						doNotOptimize(bw->chunkblock.translations.data());
+					}
+				}));
+			}
+
+			//Against chunk.generateInstances: the same loops with the chunk size only known at run time
+			if (selected(filter, "chunk.generateAnySize"))
+			{
+				bw->chunkblock.specialised = false;
+				printResult(runBenchmark("chunk.generateAnySize", params, (double)size * size * size, samples, [&](uint64_t n) {
+					for (uint64_t it = 0; it < n; it++)
+					{
+						bw->chunkblock.generateInstances(vec3(it % 64 * size, -20, 0), heightmod);
+						doNotOptimize(bw->chunkblock.translations.data());
+					}
+				}));
+				bw->chunkblock.specialised = true;
+			}
+
+			//Laying out blocks from offsets already sampled, what a chunk read back from a region file costs, with the
+			//loops for the size and without
+			for (int sized = 1; sized >= 0; sized--)
+			{
+				const char* name = sized ? "chunk.buildInstances" : "chunk.buildInstancesAnySize";
+				if (!selected(filter, name))
+				{
+					continue;
+				}
+				bw->chunkblock.specialised = sized != 0;
+				bw->chunkblock.generateInstances(vec3(0, -20, 0), heightmod);
+				vector<int8_t> sampled = bw->chunkblock.offsets;
+				printResult(runBenchmark(name, params, (double)size * size * size, samples, [&](uint64_t n) {
+					for (uint64_t it = 0; it < n; it++)
+					{
+						bw->chunkblock.buildInstances(vec3(0, -20, 0), sampled.data());
+						doNotOptimize(bw->chunkblock.translations.data());
+					}
+				}));
+				bw->chunkblock.specialised = true;
+			}
+
+			//Against chunk.generateInstances: what changing heightmod costs a resident chunk, its offsets worked out
+			//again from its noise (the shader moves its blocks, nothing is uploaded)
+			if (selected(filter, "chunk.applyHeightmod"))
+			{
+				bw->chunkblock.generateInstances(vec3(0, -20, 0), heightmod);
+				vector<int8_t> sampled = bw->chunkblock.noise;
+				vector<int8_t> offsets(sampled.size());
+				printResult(runBenchmark("chunk.applyHeightmod", params, (double)size * size * size, samples, [&](uint64_t n) {
+					for (uint64_t it = 0; it < n; it++)
+					{
+						bw->chunkblock.applyHeightmod(vec3(0, -20, 0), sampled.data(), heightmod + (int)(it % 2), offsets.data());
+						doNotOptimize(offsets.data());
+					}
+				}));
+			}
+
+			if (selected(filter, "chunk.generateSimplex"))
+			{
+				bw->chunkblock.backend = NOISE_SIMPLEX;
+				printResult(runBenchmark("chunk.generateSimplex", params, (double)size * size * size, samples, [&](uint64_t n) {
+					for (uint64_t it = 0; it < n; it++)
+					{
+						bw->chunkblock.generateInstances(vec3(it % 64 * size, -20, 0), heightmod);
+						doNotOptimize(bw->chunkblock.translations.data());
+					}
+				}));
+				bw->chunkblock.backend = NOISE_PERLIN;
+			}
+
+			//Against chunk.generateInstances: the same chunk read back from a region file and laid out from its offsets,
+			//or generated again with an edit list read back and replayed over it
+			if (selected(filter, "region.load"))
+			{
+				benchRegion(bw->chunkblock, size, heightmod, samples, REGION_WHOLE_CHUNKS);
+			}
+			if (selected(filter, "region.loadEdits"))
+			{
+				benchRegion(bw->chunkblock, size, heightmod, samples, REGION_EDITS);
+			}
+
+			//Rays per second, items are rays
+			if (selected(filter, "raycast.single") || selected(filter, "raycast.everyCell") || selected(filter, "raycast.batch"))
+			{
+				benchRaycast(bw->chunkblock, size, heightmod, samples, filter);
+			}
+
+			//Worst case for a frame at the default view radius: new layout plus all 9 chunks generated (instance data, no upload)
+			if (selected(filter, "megachunk.build"))
+			{
+				generateMegaChunk(true, vec3(0), bw);
+				printResult(runBenchmark("megachunk.build", params, (double)bw->visibleChunks * size * size * size, samples, [&](uint64_t n) {
+					for (uint64_t it = 0; it < n; it++)
+					{
+						generateMegaChunk(false, vec3(it % 2 ? -size : size, 0, 0), bw);
+						for (int c = 0; c < bw->visibleChunks; c++)
+						{
+							bw->chunkblock.generateInstances(bw->megaChunk[c], heightmod);
+						}
+						doNotOptimize(bw->chunkblock.translations.data());
+					}
+				}));
+			}
+		}
+
+		//Only depends on the chunk size
+		if (selected(filter, "megachunk.layout"))
+		{
+			bw->cam_x = bw->cam_z = 13;
+			printResult(runBenchmark("megachunk.layout", "size=" + to_string(size), 0, samples, [&](uint64_t n) {
+				for (uint64_t it = 0; it < n; it++)
+				{
+					generateMegaChunk(it % 8 == 0, vec3(it % 2 ? -size : size, 0, 0), bw);
+					doNotOptimize(bw->megaChunk[4]);
+				}
+			}));
+		}
+	}
+
+	delete bw;
+	return true;
+}
+
+//parse_obj is the CPU part of TinyObjLoader::load_obj, the rest is the buffer upload
+static void benchModels(const string& assets, int samples, const char* filter)
+{
+	vector<string> models;
+	error_code error;
+	for (filesystem::directory_iterator it(assets + "/Models", error), end; !error && it != end; it.increment(error))
+	{
+		if (it->path().extension() == ".obj")
+		{
+			models.push_back(it->path().filename().string());
+		}
+	}
+	sort(models.begin(), models.end());
+
+	if (models.empty())
+	{
+		cerr << "No models found in " << assets << "/Models" << endl;
+		return;
+	}
+
+	for (size_t m = 0; m < models.size(); m++)
+	{
+		string path = assets + "/Models/" + models[m];
+		if (!selected(filter, "obj.parse"))
+		{
+			continue;
+		}
+
+		ObjMeshData mesh;
+		if (!TinyObjLoader::parse_obj(path, mesh))
+		{
+			continue;
+		}
+		double vertices = mesh.vertices.size() / 3.0;
+
+		printResult(runBenchmark("obj.parse", models[m], vertices, samples, [&](uint64_t n) {
+			for (uint64_t it = 0; it < n; it++)
+			{
+				ObjMeshData parsed;
+				TinyObjLoader::parse_obj(path, parsed);
+				doNotOptimize(parsed.vertices.data());
+			}
+		}));
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	vector<int> sizes = { 16, 32 };
+	vector<int> heightmods = { 10, 30 };
+	int samples = 11;
+	const char* filter = NULL;
+	string assets = BLOCKWORLD_ASSETS;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) sizes = parseList(argv[++i]);
+		else if (strcmp(argv[i], "--heightmod") == 0 && i + 1 < argc) heightmods = parseList(argv[++i]);
+		else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) samples = std::max(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) filter = argv[++i];
+		else if (strcmp(argv[i], "--assets") == 0 && i + 1 < argc) assets = argv[++i];
+		else
+		{
+			cout << "Unknown argument " << argv[i] << endl;
+			return 1;
+		}
+	}
+
+	pinToCurrentCpu();
+	printHeader();
+
+	benchNoise(samples, filter);
+	benchClimate(sizes, samples, filter);
+	if (!benchChunks(sizes, heightmods, samples, filter))
+	{
+		return 1;
+	}
+	benchModels(assets, samples, filter);
+	return 0;
+}
@@ -0,0 +1,22 @@
+# Generates a C++ source embedding every shader file as a raw string literal (table declared in src/ShaderLibrary.h)
+# Run as a build step by CMakeLists.txt:
+#   cmake -DSHADER_DIR=<folder> -DSHADER_PREFIX=Shaders/ -DOUTPUT=<file.cpp> -P EmbedShaders.cmake
+file(GLOB SHADER_FILES RELATIVE ${SHADER_DIR} ${SHADER_DIR}/*.vert ${SHADER_DIR}/*.frag ${SHADER_DIR}/*.glsl)
+list(SORT SHADER_FILES)
+list(LENGTH SHADER_FILES SHADER_COUNT)
+
+set(CONTENT "// Generated by cmake/EmbedShaders.cmake from ${SHADER_DIR}, do not edit\n")
+string(APPEND CONTENT "#include \"ShaderLibrary.h\"\n\nconst EmbeddedShader EMBEDDED_SHADERS[] =\n{\n")
+foreach(SHADER ${SHADER_FILES})
+    file(READ ${SHADER_DIR}/${SHADER} SOURCE)
+    string(APPEND CONTENT "\t{ \"${SHADER_PREFIX}${SHADER}\", R\"BWSHADER(${SOURCE})BWSHADER\" },\n")
+endforeach()
+string(APPEND CONTENT "};\n\nconst int NUM_EMBEDDED_SHADERS = ${SHADER_COUNT};\n")
+
+# Only touch the output when a shader changed so nothing else recompiles
+if(EXISTS ${OUTPUT})
+    file(READ ${OUTPUT} PREVIOUS)
+endif()
+if(NOT "${PREVIOUS}" STREQUAL "${CONTENT}")
+    file(WRITE ${OUTPUT} "${CONTENT}")
+endif()
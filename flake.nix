@@ -29,6 +29,7 @@
         gcc
         glfw
         glew
+        libGL # EGL for the native --headless mode
         gtk4
         libdecor
         gtkmm4
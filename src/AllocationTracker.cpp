@@ -0,0 +1,145 @@
+/*
+	Global operator new/delete replacements that count allocations, see AllocationTracker.h
+	Sameer Al Harbi 2022
+*/
+
+#include "AllocationTracker.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <cstdio>
+
+#if defined(__GLIBC__)
+#include <execinfo.h>
+#include <unistd.h>
+#endif
+
+static std::atomic<uint64_t> allocationCount(0);
+static std::atomic<uint64_t> allocationBytes(0);
+static std::atomic<uint64_t> forbiddenCount(0);
+static thread_local bool allocationsForbidden = false;
+
+//Backtraces printed, after this only the count goes up
+const uint64_t MAX_REPORTED_ALLOCATIONS = 10;
+
+AllocationCounts allocationCounts()
+{
+	AllocationCounts counts;
+	counts.allocations = allocationCount.load(std::memory_order_relaxed);
+	counts.bytes = allocationBytes.load(std::memory_order_relaxed);
+	return counts;
+}
+
+void forbidAllocations(bool forbidden)
+{
+#if defined(__GLIBC__)
+	//The first backtrace() loads libgcc, which allocates, so get that done before anything is forbidden
+	static bool backtraceLoaded = false;
+	if (forbidden && !backtraceLoaded)
+	{
+		void* frame[1];
+		backtrace(frame, 1);
+		backtraceLoaded = true;
+	}
+#endif
+	allocationsForbidden = forbidden;
+}
+
+uint64_t forbiddenAllocations()
+{
+	return forbiddenCount.load(std::memory_order_relaxed);
+}
+
+//Written with stdio and without allocating, this runs inside operator new
+static void reportForbiddenAllocation(std::size_t size)
+{
+	uint64_t count = forbiddenCount.fetch_add(1, std::memory_order_relaxed) + 1;
+	if (count > MAX_REPORTED_ALLOCATIONS)
+	{
+		return;
+	}
+
+	fprintf(stderr, "Allocation of %zu bytes in a frame that shouldn't allocate%s\n", size,
+		count == MAX_REPORTED_ALLOCATIONS ? " (reporting no more)" : "");
+#if defined(__GLIBC__)
+	void* frames[32];
+	int depth = backtrace(frames, 32);
+	backtrace_symbols_fd(frames, depth, STDERR_FILENO);
+#endif
+}
+
+static void* countedAllocate(std::size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	allocationBytes.fetch_add(size, std::memory_order_relaxed);
+
+	if (allocationsForbidden)
+	{
+		//Anything the report itself allocates isn't reported again
+		allocationsForbidden = false;
+		reportForbiddenAllocation(size);
+		allocationsForbidden = true;
+	}
+
+	//malloc(0) may return NULL, new must not
+	void* memory = std::malloc(size ? size : 1);
+	if (!memory)
+	{
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void* operator new(std::size_t size)
+{
+	return countedAllocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+	return countedAllocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return countedAllocate(size);
+	}
+	catch (...)
+	{
+		return nullptr;
+	}
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return countedAllocate(size);
+	}
+	catch (...)
+	{
+		return nullptr;
+	}
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
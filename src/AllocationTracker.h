@@ -0,0 +1,37 @@
+/*
+	Counts every heap allocation made through operator new (which is also what std containers use), so frame loops
+	can report how many allocations and bytes each frame costs. The counters are relaxed atomics, cheap enough to
+	leave on all the time.
+	For checking that frames don't allocate (--alloc-check), a thread can also forbid allocations for a while: any it
+	makes is counted and reported with its size and, where glibc can provide one, a backtrace.
+	Sameer Al Harbi 2022
+*/
+#pragma once
+
+#include <cstdint>
+
+struct AllocationCounts
+{
+	uint64_t allocations;
+	uint64_t bytes;
+};
+
+//Totals since the program started, subtract two snapshots to get the allocations in between
+AllocationCounts allocationCounts();
+
+//Report every allocation the calling thread makes while forbidden, other threads are unaffected
+void forbidAllocations(bool forbidden);
+
+//Allocations made while forbidden, on any thread
+uint64_t forbiddenAllocations();
+
+//Forbids allocations on this thread for its lifetime when check is true
+class NoAllocationScope
+{
+public:
+	NoAllocationScope(bool check) : active(check) { if (active) forbidAllocations(true); }
+	~NoAllocationScope() { if (active) forbidAllocations(false); }
+
+private:
+	bool active;
+};
@@ -0,0 +1,475 @@
+/*
+	Asynchronous texture and model loader, see AssetLoader.h
+	Sameer Al Harbi 2022
+*/
+
+#include "AssetLoader.h"
+#include "Profiler.h"
+#include "MemoryTracker.h"
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+
+/* Include the image loader */
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+//The web build only has threads when compiled with -pthread, otherwise jobs are run from pump()
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+#define ASSET_LOADER_NO_THREADS
+#endif
+
+using namespace std;
+
+template <typename T>
+static bool isReady(const shared_future<T>& f)
+{
+	return f.wait_for(chrono::seconds(0)) == future_status::ready;
+}
+
+//Note: this is not a full check of all pixel format types, just the most common two!
+static GLenum pixelFormat(int channels)
+{
+	return channels == 3 ? GL_RGB : GL_RGBA;
+}
+
+static void setTextureParameters(GLenum target, bool mipmapped)
+{
+	glTexParameteri(target, GL_TEXTURE_MIN_FILTER, mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+}
+
+//Record a texture's size, the cube map is the skybox. A full mip chain adds a third to the base level
+static void trackTexture(GLenum target, GLuint texID, size_t bytes, bool mipmapped)
+{
+	MemoryTracker::texture(texID, target == GL_TEXTURE_CUBE_MAP ? MEMORY_SKYBOX : MEMORY_TEXTURES, mipmapped ? bytes + bytes / 3 : bytes);
+}
+
+//Upload a compressed texture into the currently bound target, replacing the placeholder
+static void uploadCompressed(GLenum target, GLuint texID, KTXTexture& ktx)
+{
+	ktx.upload();
+	trackTexture(target, texID, ktx.dataSize(), false);
+	glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, (GLint)ktx.levels.size() - 1);
+	setTextureParameters(target, ktx.levels.size() > 1);
+}
+
+AssetLoader::AssetLoader(int numThreads)
+{
+	stopping = false;
+
+	//Formats are checked on the main thread while the context is current
+	compressedSupported = compressedFormatSupported(GL_COMPRESSED_RGB8_ETC2) && compressedFormatSupported(GL_COMPRESSED_RGBA8_ETC2_EAC);
+
+#ifndef ASSET_LOADER_NO_THREADS
+	if (numThreads <= 0)
+	{
+		//Leave a core for the main thread
+		numThreads = max(1, (int)thread::hardware_concurrency() - 1);
+	}
+
+	for (int i = 0; i < numThreads; i++)
+	{
+		workers.push_back(thread(&AssetLoader::workerLoop, this));
+	}
+#endif
+}
+
+AssetLoader::~AssetLoader()
+{
+	{
+		lock_guard<mutex> lock(jobMutex);
+		stopping = true;
+	}
+	jobSignal.notify_all();
+
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+}
+
+void AssetLoader::submit(function<void()> job)
+{
+	{
+		lock_guard<mutex> lock(jobMutex);
+		jobs.push_back(move(job));
+	}
+	jobSignal.notify_one();
+}
+
+void AssetLoader::workerLoop()
+{
+	Profiler::setThreadName("asset loader");
+
+	while (true)
+	{
+		function<void()> job;
+		{
+			unique_lock<mutex> lock(jobMutex);
+			jobSignal.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if (stopping)
+			{
+				return;
+			}
+			job = move(jobs.front());
+			jobs.pop_front();
+		}
+		PROFILE_SCOPE("asset job");
+		job();
+	}
+}
+
+bool AssetLoader::runOneJob()
+{
+	function<void()> job;
+	{
+		lock_guard<mutex> lock(jobMutex);
+		if (jobs.empty())
+		{
+			return false;
+		}
+		job = move(jobs.front());
+		jobs.pop_front();
+	}
+	job();
+	return true;
+}
+
+shared_future<shared_ptr<ImageData>> AssetLoader::requestImage(const string& path, bool flip, int channels)
+{
+	string key = path + (flip ? "#flipped" : "") + (channels ? "#" + to_string(channels) : "");
+
+	auto cached = images.find(key);
+	if (cached != images.end())
+	{
+		return cached->second;
+	}
+
+	shared_ptr<promise<shared_ptr<ImageData>>> result = make_shared<promise<shared_ptr<ImageData>>>();
+	shared_future<shared_ptr<ImageData>> future = result->get_future().share();
+	images[key] = future;
+
+	submit([result, path, flip, channels]() {
+		shared_ptr<ImageData> image;
+
+		AssetData file;
+		if (AssetPack::instance().read(path, file))
+		{
+			int width, height, fileChannels;
+			unsigned char* data = stbi_load_from_memory(file.data(), (int)file.size(), &width, &height, &fileChannels, channels);
+			if (data)
+			{
+				image = make_shared<ImageData>();
+				image->width = width;
+				image->height = height;
+				image->channels = channels ? channels : fileChannels;
+				image->pixels.assign(data, data + width * height * image->channels);
+				stbi_image_free(data);
+
+				//stbi_set_flip_vertically_on_load is global state so flip here instead
+				if (flip)
+				{
+					size_t row = width * image->channels;
+					for (int y = 0; y < height / 2; y++)
+					{
+						swap_ranges(image->pixels.begin() + y * row, image->pixels.begin() + (y + 1) * row, image->pixels.begin() + (height - 1 - y) * row);
+					}
+				}
+			}
+		}
+
+		if (!image)
+		{
+			cout << "stb_image loading error: filename=" << path << endl;
+		}
+		result->set_value(image);
+	});
+
+	return future;
+}
+
+shared_future<shared_ptr<CompressedImageData>> AssetLoader::requestCompressedImage(const string& path)
+{
+	auto cached = compressedImages.find(path);
+	if (cached != compressedImages.end())
+	{
+		return cached->second;
+	}
+
+	shared_ptr<promise<shared_ptr<CompressedImageData>>> result = make_shared<promise<shared_ptr<CompressedImageData>>>();
+	shared_future<shared_ptr<CompressedImageData>> future = result->get_future().share();
+	compressedImages[path] = future;
+
+	submit([result, path]() {
+		shared_ptr<CompressedImageData> image = make_shared<CompressedImageData>();
+		if (!AssetPack::instance().read(path, image->file) || !image->ktx.parse(image->file))
+		{
+			image.reset();
+		}
+		result->set_value(image);
+	});
+
+	return future;
+}
+
+shared_future<shared_ptr<ObjMeshData>> AssetLoader::requestMesh(const string& path)
+{
+	auto cached = meshes.find(path);
+	if (cached != meshes.end())
+	{
+		return cached->second;
+	}
+
+	shared_ptr<promise<shared_ptr<ObjMeshData>>> result = make_shared<promise<shared_ptr<ObjMeshData>>>();
+	shared_future<shared_ptr<ObjMeshData>> future = result->get_future().share();
+	meshes[path] = future;
+
+	submit([result, path]() {
+		shared_ptr<ObjMeshData> mesh = make_shared<ObjMeshData>();
+		if (!TinyObjLoader::parse_obj(path, *mesh))
+		{
+			mesh.reset();
+		}
+		result->set_value(mesh);
+	});
+
+	return future;
+}
+
+GLuint AssetLoader::loadTexture(const string& path, bool flip, bool genMipmaps, const string& compressedPath)
+{
+	GLuint texID;
+	glGenTextures(1, &texID);
+	glBindTexture(GL_TEXTURE_2D, texID);
+
+	//Grey placeholder until the real image arrives
+	const unsigned char placeholder[4] = { 128, 128, 128, 255 };
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+	setTextureParameters(GL_TEXTURE_2D, false);
+	trackTexture(GL_TEXTURE_2D, texID, sizeof(placeholder), false);
+
+	//Decoded fallback, only requested if the compressed version can't be used
+	auto loadDecoded = [this, texID, path, flip, genMipmaps]() {
+		shared_future<shared_ptr<ImageData>> image = requestImage(path, flip);
+		uploads.push_back({ [image]() { return isReady(image); }, [image, texID, path, genMipmaps]() {
+			shared_ptr<ImageData> data = image.get();
+			if (!data)
+			{
+				cout << "Fatal error loading texture " << path << endl;
+				exit(0);
+			}
+
+			GLenum format = pixelFormat(data->channels);
+			glBindTexture(GL_TEXTURE_2D, texID);
+			glTexImage2D(GL_TEXTURE_2D, 0, format, data->width, data->height, 0, format, GL_UNSIGNED_BYTE, data->pixels.data());
+			if (genMipmaps)
+			{
+				glGenerateMipmap(GL_TEXTURE_2D);
+			}
+			setTextureParameters(GL_TEXTURE_2D, genMipmaps);
+			trackTexture(GL_TEXTURE_2D, texID, (size_t)data->width * data->height * (format == GL_RGB ? 3 : 4), genMipmaps);
+		} });
+	};
+
+	if (compressedPath.empty() || !compressedSupported)
+	{
+		loadDecoded();
+		return texID;
+	}
+
+	shared_future<shared_ptr<CompressedImageData>> compressed = requestCompressedImage(compressedPath);
+	uploads.push_back({ [compressed]() { return isReady(compressed); }, [compressed, texID, loadDecoded]() {
+		shared_ptr<CompressedImageData> data = compressed.get();
+		if (!data || data->ktx.isCubeMap() || data->ktx.isArray())
+		{
+			loadDecoded();
+			return;
+		}
+		glBindTexture(GL_TEXTURE_2D, texID);
+		uploadCompressed(GL_TEXTURE_2D, texID, data->ktx);
+	} });
+
+	return texID;
+}
+
+GLuint AssetLoader::loadCubeMap(const vector<string>& faces, const string& compressedPath)
+{
+	GLuint texID;
+	glGenTextures(1, &texID);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, texID);
+
+	const unsigned char placeholder[4] = { 128, 128, 128, 255 };
+	for (unsigned int i = 0; i < 6; i++)
+	{
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+	}
+	setTextureParameters(GL_TEXTURE_CUBE_MAP, false);
+	trackTexture(GL_TEXTURE_CUBE_MAP, texID, sizeof(placeholder) * 6, false);
+
+	auto loadDecoded = [this, texID, faces]() {
+		vector<shared_future<shared_ptr<ImageData>>> images;
+		for (size_t i = 0; i < faces.size(); i++)
+		{
+			images.push_back(requestImage(faces[i], false));
+		}
+
+		uploads.push_back({ [images]() { return all_of(images.begin(), images.end(), isReady<shared_ptr<ImageData>>); }, [images, texID, faces]() {
+			glBindTexture(GL_TEXTURE_CUBE_MAP, texID);
+			size_t bytes = 0;
+			for (size_t i = 0; i < images.size(); i++)
+			{
+				shared_ptr<ImageData> data = images[i].get();
+				if (!data)
+				{
+					cout << "Cubemap tex failed to load at path: " << faces[i] << endl;
+					exit(0);
+				}
+
+				GLenum format = pixelFormat(data->channels);
+				glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + (GLenum)i, 0, format, data->width, data->height, 0, format, GL_UNSIGNED_BYTE, data->pixels.data());
+				bytes += (size_t)data->width * data->height * (format == GL_RGB ? 3 : 4);
+			}
+			setTextureParameters(GL_TEXTURE_CUBE_MAP, false);
+			trackTexture(GL_TEXTURE_CUBE_MAP, texID, bytes, false);
+		} });
+	};
+
+	if (compressedPath.empty() || !compressedSupported)
+	{
+		loadDecoded();
+		return texID;
+	}
+
+	shared_future<shared_ptr<CompressedImageData>> compressed = requestCompressedImage(compressedPath);
+	uploads.push_back({ [compressed]() { return isReady(compressed); }, [compressed, texID, loadDecoded]() {
+		shared_ptr<CompressedImageData> data = compressed.get();
+		if (!data || !data->ktx.isCubeMap())
+		{
+			loadDecoded();
+			return;
+		}
+		glBindTexture(GL_TEXTURE_CUBE_MAP, texID);
+		uploadCompressed(GL_TEXTURE_CUBE_MAP, texID, data->ktx);
+	} });
+
+	return texID;
+}
+
+GLuint AssetLoader::loadTextureArray(const vector<string>& layers, const string& compressedPath)
+{
+	GLuint texID;
+	glGenTextures(1, &texID);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texID);
+
+	vector<unsigned char> placeholder(layers.size() * 4, 128);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, 1, 1, (GLsizei)layers.size(), 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder.data());
+	setTextureParameters(GL_TEXTURE_2D_ARRAY, false);
+	trackTexture(GL_TEXTURE_2D_ARRAY, texID, placeholder.size(), false);
+
+	auto loadDecoded = [this, texID, layers]() {
+		//Every layer has to be uploaded in the same format so they are all decoded to RGBA
+		vector<shared_future<shared_ptr<ImageData>>> images;
+		for (size_t i = 0; i < layers.size(); i++)
+		{
+			images.push_back(requestImage(layers[i], false, 4));
+		}
+
+		uploads.push_back({ [images]() { return all_of(images.begin(), images.end(), isReady<shared_ptr<ImageData>>); }, [images, texID, layers]() {
+			shared_ptr<ImageData> first = images[0].get();
+			for (size_t i = 0; i < images.size(); i++)
+			{
+				shared_ptr<ImageData> data = images[i].get();
+				if (!data || !first || data->width != first->width || data->height != first->height)
+				{
+					cout << "Texture array layer failed to load or has the wrong size: " << layers[i] << endl;
+					exit(0);
+				}
+			}
+
+			glBindTexture(GL_TEXTURE_2D_ARRAY, texID);
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, first->width, first->height, (GLsizei)images.size(), 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+			for (size_t i = 0; i < images.size(); i++)
+			{
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, (GLint)i, first->width, first->height, 1, GL_RGBA, GL_UNSIGNED_BYTE, images[i].get()->pixels.data());
+			}
+			glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+			setTextureParameters(GL_TEXTURE_2D_ARRAY, true);
+			trackTexture(GL_TEXTURE_2D_ARRAY, texID, (size_t)first->width * first->height * 4 * images.size(), true);
+		} });
+	};
+
+	if (compressedPath.empty() || !compressedSupported)
+	{
+		loadDecoded();
+		return texID;
+	}
+
+	size_t numLayers = layers.size();
+	shared_future<shared_ptr<CompressedImageData>> compressed = requestCompressedImage(compressedPath);
+	uploads.push_back({ [compressed]() { return isReady(compressed); }, [compressed, texID, numLayers, loadDecoded]() {
+		shared_ptr<CompressedImageData> data = compressed.get();
+		if (!data || data->ktx.numLayers != numLayers)
+		{
+			loadDecoded();
+			return;
+		}
+		glBindTexture(GL_TEXTURE_2D_ARRAY, texID);
+		uploadCompressed(GL_TEXTURE_2D_ARRAY, texID, data->ktx);
+	} });
+
+	return texID;
+}
+
+void AssetLoader::loadModel(TinyObjLoader* model, const string& path)
+{
+	shared_future<shared_ptr<ObjMeshData>> mesh = requestMesh(path);
+	uploads.push_back({ [mesh]() { return isReady(mesh); }, [mesh, model, path]() {
+		shared_ptr<ObjMeshData> data = mesh.get();
+		if (!data)
+		{
+			cout << "Fatal error loading model " << path << endl;
+			exit(1);
+		}
+		model->upload(*data);
+	} });
+}
+
+void AssetLoader::pump()
+{
+	PROFILE_SCOPE("AssetLoader::pump");
+
+#ifdef ASSET_LOADER_NO_THREADS
+	//One job per frame keeps frames responsive while loading
+	runOneJob();
+#endif
+
+	//Uploads can queue more uploads (compressed -> decoded fallback) so work on a copy
+	vector<Upload> current;
+	current.swap(uploads);
+
+	for (size_t i = 0; i < current.size(); i++)
+	{
+		if (current[i].ready())
+		{
+			current[i].run();
+		}
+		else
+		{
+			uploads.push_back(move(current[i]));
+		}
+	}
+}
+
+bool AssetLoader::idle()
+{
+	return uploads.empty();
+}
+
+int AssetLoader::pendingUploads()
+{
+	return (int)uploads.size();
+}
@@ -0,0 +1,107 @@
+/*
+	Asynchronous texture and model loader used at startup.
+	Image decoding (stb_image), KTX parsing and OBJ parsing run on worker threads, results are cached by path so an
+	image used by several textures (dirt_grass.png is 4 of the 6 grass block faces) is only decoded once.
+	Only the GL uploads are queued back to the main thread where pump() runs them between frames.
+	Textures are created straight away with a 1x1 placeholder so rendering can start before anything has loaded.
+	Sameer Al Harbi 2022
+*/
+#pragma once
+
+#include "wrapper_glfw.h"
+#include "AssetPack.h"
+#include "KTXTexture.h"
+#include "ModelLoader/tiny_loader_texture.h"
+
+#include <vector>
+#include <string>
+#include <map>
+#include <deque>
+#include <memory>
+#include <future>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//Decoded image, rows in upload order
+struct ImageData
+{
+	int width;
+	int height;
+	int channels;
+	std::vector<unsigned char> pixels;
+};
+
+//Parsed KTX file, keeps the file bytes alive for the KTXTexture pointers
+struct CompressedImageData
+{
+	AssetData file;
+	KTXTexture ktx;
+};
+
+class AssetLoader
+{
+public:
+	//numThreads of 0 picks the number of cores. Builds without threads run the jobs inside pump()
+	AssetLoader(int numThreads = 0);
+	~AssetLoader();
+
+	//Decode an image once per (path, flip, channels), later requests share the result. Null result if it failed to load
+	//channels of 0 keeps the image's own channel count
+	std::shared_future<std::shared_ptr<ImageData>> requestImage(const std::string& path, bool flip, int channels = 0);
+
+	//Parse a KTX file, null result if missing or invalid
+	std::shared_future<std::shared_ptr<CompressedImageData>> requestCompressedImage(const std::string& path);
+
+	//Parse an OBJ into CPU buffers
+	std::shared_future<std::shared_ptr<ObjMeshData>> requestMesh(const std::string& path);
+
+	/*
+		Create a texture with a placeholder now and replace it once the data is ready.
+		compressedPath is tried first (if the GPU supports ETC2), the regular image(s) are the fallback
+	*/
+	GLuint loadTexture(const std::string& path, bool flip, bool genMipmaps, const std::string& compressedPath = "");
+	GLuint loadCubeMap(const std::vector<std::string>& faces, const std::string& compressedPath = "");
+
+	//GL_TEXTURE_2D_ARRAY with one layer per image, all images must be the same size
+	GLuint loadTextureArray(const std::vector<std::string>& layers, const std::string& compressedPath = "");
+
+	//Fill a model's buffers once it has been parsed
+	void loadModel(TinyObjLoader* model, const std::string& path);
+
+	//Run GL uploads whose data is ready, must be called on the thread that owns the context
+	void pump();
+
+	//True once every requested asset has been uploaded
+	bool idle();
+
+	int pendingUploads();
+
+private:
+	struct Upload
+	{
+		std::function<bool()> ready;
+		std::function<void()> run;
+	};
+
+	void submit(std::function<void()> job);
+	void workerLoop();
+	bool runOneJob();
+
+	//Worker pool
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+	std::mutex jobMutex;
+	std::condition_variable jobSignal;
+	bool stopping;
+
+	//Dedup caches, keyed by path
+	std::map<std::string, std::shared_future<std::shared_ptr<ImageData>>> images;
+	std::map<std::string, std::shared_future<std::shared_ptr<CompressedImageData>>> compressedImages;
+	std::map<std::string, std::shared_future<std::shared_ptr<ObjMeshData>>> meshes;
+
+	//Main thread only
+	std::vector<Upload> uploads;
+	bool compressedSupported;
+};
@@ -0,0 +1,274 @@
+/*
+	Single file asset archive, see AssetPack.h for the layout.
+	Sameer Al Harbi 2022
+*/
+
+#include "AssetPack.h"
+#include "LZ4Block.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+//Memory map the pack where it's available, the web build reads it into one buffer from the embedded file system
+#if !defined(__EMSCRIPTEN__) && (defined(__unix__) || defined(__APPLE__))
+#define ASSET_PACK_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+uint64_t assetNameHash(const char* name, size_t length)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < length; i++)
+	{
+		hash ^= (unsigned char)name[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+AssetData::AssetData()
+{
+	view = NULL;
+	viewSize = 0;
+}
+
+const unsigned char* AssetData::data() const
+{
+	return view ? view : owned.data();
+}
+
+size_t AssetData::size() const
+{
+	return view ? viewSize : owned.size();
+}
+
+bool AssetData::empty() const
+{
+	return size() == 0;
+}
+
+string AssetData::toString() const
+{
+	return string((const char*)data(), size());
+}
+
+AssetPack::AssetPack()
+{
+	base = NULL;
+	baseSize = 0;
+	mapping = NULL;
+	entries = NULL;
+	names = NULL;
+	entryCount = 0;
+}
+
+AssetPack::~AssetPack()
+{
+	close();
+}
+
+AssetPack& AssetPack::instance()
+{
+	static AssetPack pack;
+	return pack;
+}
+
+bool AssetPack::open(const char* path)
+{
+	close();
+
+#ifdef ASSET_PACK_MMAP
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	void* mapped = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd); //Mapping stays valid after the descriptor is closed
+	if (mapped == MAP_FAILED)
+	{
+		return false;
+	}
+	mapping = mapped;
+	base = (const unsigned char*)mapped;
+	baseSize = (size_t)st.st_size;
+#else
+	ifstream file(path, ios::in | ios::binary | ios::ate);
+	if (!file.is_open())
+	{
+		return false;
+	}
+	streamsize length = file.tellg();
+	file.seekg(0, ios::beg);
+	buffer.resize((size_t)length);
+	if (length <= 0 || !file.read((char*)buffer.data(), length))
+	{
+		buffer.clear();
+		return false;
+	}
+	base = buffer.data();
+	baseSize = buffer.size();
+#endif
+
+	//Validate the header and every entry once so reads don't need to
+	AssetPackHeader header;
+	if (baseSize < sizeof(header))
+	{
+		cerr << "Asset pack " << path << " is truncated" << endl;
+		close();
+		return false;
+	}
+	memcpy(&header, base, sizeof(header));
+
+	if (memcmp(header.magic, ASSET_PACK_MAGIC, 4) != 0 || header.version != ASSET_PACK_VERSION)
+	{
+		cerr << "Asset pack " << path << " has wrong magic or version" << endl;
+		close();
+		return false;
+	}
+
+	//Offsets and sizes come from the file, they're checked against what's left of the pack rather than added so a
+	//corrupt one can't wrap around and pass
+	bool tocFits = header.entryCount <= (baseSize - sizeof(header)) / sizeof(AssetPackEntry);
+	uint64_t tocEnd = sizeof(header) + (uint64_t)header.entryCount * sizeof(AssetPackEntry);
+	if (!tocFits || header.namesOffset < tocEnd || header.namesOffset > baseSize || header.namesSize > baseSize - header.namesOffset)
+	{
+		cerr << "Asset pack " << path << " has a corrupt table of contents" << endl;
+		close();
+		return false;
+	}
+
+	entries = (const AssetPackEntry*)(base + sizeof(header));
+	names = (const char*)(base + header.namesOffset);
+	entryCount = header.entryCount;
+
+	for (uint32_t i = 0; i < entryCount; i++)
+	{
+		//Uncompressed entries are read straight out of the pack, so their size has to be what's stored
+		const AssetPackEntry& e = entries[i];
+		bool sized = (e.flags & ASSET_PACK_FLAG_LZ4) || e.size == e.storedSize;
+		bool stored = e.dataOffset <= baseSize && e.storedSize <= baseSize - e.dataOffset;
+		if ((uint64_t)e.nameOffset + e.nameLength > header.namesSize || !stored || !sized)
+		{
+			cerr << "Asset pack " << path << " has a corrupt entry " << i << endl;
+			close();
+			return false;
+		}
+	}
+
+	cout << "Asset pack " << path << " opened with " << entryCount << " entries" << endl;
+	return true;
+}
+
+void AssetPack::close()
+{
+#ifdef ASSET_PACK_MMAP
+	if (mapping)
+	{
+		munmap(mapping, baseSize);
+	}
+#endif
+	mapping = NULL;
+	buffer.clear();
+	base = NULL;
+	baseSize = 0;
+	entries = NULL;
+	names = NULL;
+	entryCount = 0;
+}
+
+bool AssetPack::isOpen()
+{
+	return base != NULL;
+}
+
+const AssetPackEntry* AssetPack::find(const string& name)
+{
+	if (!isOpen())
+	{
+		return NULL;
+	}
+
+	uint64_t hash = assetNameHash(name.data(), name.size());
+
+	const AssetPackEntry* first = entries;
+	const AssetPackEntry* last = entries + entryCount;
+	const AssetPackEntry* it = lower_bound(first, last, hash, [](const AssetPackEntry& e, uint64_t h) { return e.nameHash < h; });
+
+	//Names with a colliding hash sit next to each other
+	for (; it != last && it->nameHash == hash; ++it)
+	{
+		if (it->nameLength == name.size() && memcmp(names + it->nameOffset, name.data(), name.size()) == 0)
+		{
+			return it;
+		}
+	}
+	return NULL;
+}
+
+bool AssetPack::read(const string& name, AssetData& out)
+{
+	out.view = NULL;
+	out.viewSize = 0;
+	out.owned.clear();
+
+	const AssetPackEntry* entry = find(name);
+	if (!entry)
+	{
+		return readLooseFile(name, out);
+	}
+
+	const unsigned char* blob = base + entry->dataOffset;
+
+	if (entry->flags & ASSET_PACK_FLAG_LZ4)
+	{
+		out.owned.resize((size_t)entry->size);
+		if (!LZ4Block::decompress(blob, (size_t)entry->storedSize, out.owned.data(), out.owned.size()))
+		{
+			cerr << "Asset " << name << " failed to decompress" << endl;
+			out.owned.clear();
+			return false;
+		}
+	}
+	else
+	{
+		//Zero copy, point straight into the pack
+		out.view = blob;
+		out.viewSize = (size_t)entry->size;
+	}
+	return true;
+}
+
+bool AssetPack::readLooseFile(const string& name, AssetData& out)
+{
+	ifstream file(name, ios::in | ios::binary | ios::ate);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	streamsize length = file.tellg();
+	file.seekg(0, ios::beg);
+	out.owned.resize((size_t)max<streamsize>(length, 0));
+	if (length > 0 && !file.read((char*)out.owned.data(), length))
+	{
+		out.owned.clear();
+		return false;
+	}
+	return true;
+}
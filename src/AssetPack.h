@@ -0,0 +1,100 @@
+/*
+	Single file asset archive. All files under src/Assets are packed offline by tools/asset_packer into one
+	file with a table of contents at the front and every blob aligned, optionally LZ4 compressed per entry.
+	At runtime the pack is mapped with mmap (native) or read once into one contiguous buffer (web) and
+	uncompressed entries are handed out as pointers straight into it, so there are no per-file opens or copies.
+	If no pack is open (or an asset is missing from it) the loose file on disk is read instead.
+	Sameer Al Harbi 2022
+*/
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+	On-disk layout, all values little endian
+
+	[AssetPackHeader][AssetPackEntry * entryCount (sorted by nameHash)][name strings][pad][blob][pad][blob]...
+*/
+const char ASSET_PACK_MAGIC[4] = { 'B', 'W', 'P', 'K' };
+const uint32_t ASSET_PACK_VERSION = 1;
+const uint32_t ASSET_PACK_ALIGNMENT = 16;
+const uint32_t ASSET_PACK_FLAG_LZ4 = 1;
+
+struct AssetPackHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t alignment;
+	uint64_t namesOffset;
+	uint64_t namesSize;
+};
+
+struct AssetPackEntry
+{
+	uint64_t nameHash;
+	uint32_t nameOffset; //Relative to namesOffset
+	uint32_t nameLength;
+	uint64_t dataOffset; //Relative to start of the pack, multiple of alignment
+	uint64_t storedSize; //Bytes in the pack
+	uint64_t size; //Bytes after decompression
+	uint32_t flags;
+	uint32_t reserved;
+};
+
+//FNV-1a, used to sort and look up entries by name
+uint64_t assetNameHash(const char* name, size_t length);
+
+/*
+	Bytes of one asset. Uncompressed pack entries point into the pack itself, anything else is owned here
+*/
+class AssetData
+{
+public:
+	AssetData();
+
+	const unsigned char* data() const;
+	size_t size() const;
+	bool empty() const;
+
+	//Assets that are text (shaders) are wanted as a string
+	std::string toString() const;
+
+	const unsigned char* view;
+	size_t viewSize;
+	std::vector<unsigned char> owned;
+};
+
+class AssetPack
+{
+public:
+	AssetPack();
+	~AssetPack();
+
+	//Pack shared by all loaders
+	static AssetPack& instance();
+
+	bool open(const char* path);
+	void close();
+	bool isOpen();
+
+	//Read an asset by its path relative to the Assets folder, e.g "Shaders/program_v_0.vert"
+	bool read(const std::string& name, AssetData& out);
+
+	const AssetPackEntry* find(const std::string& name);
+
+private:
+	bool readLooseFile(const std::string& name, AssetData& out);
+
+	const unsigned char* base; //Start of the pack in memory
+	size_t baseSize;
+	void* mapping; //mmap'd pack on native builds
+	std::vector<unsigned char> buffer; //Whole pack on builds without mmap
+
+	const AssetPackEntry* entries;
+	const char* names;
+	uint32_t entryCount;
+};
@@ -0,0 +1,21 @@
+// Distance fog shared by the terrain and tree fragment shaders
+// The distances can be changed per program with variant defines, e.g. "FOG_MAX_DIST 30.0"
+// Sameer Al Harbi 2022
+
+#ifndef FOG_MAX_DIST
+#define FOG_MAX_DIST 20.0
+#endif
+
+#ifndef FOG_MIN_DIST
+#define FOG_MIN_DIST 6.0
+#endif
+
+mediump vec4 fog_colour = vec4(0.4, 0.4, 0.4, 1.0);
+
+// 1 when closer than FOG_MIN_DIST, 0 beyond FOG_MAX_DIST
+mediump float fogFactor(mediump vec3 position)
+{
+	mediump float dist = length(position);
+	mediump float fog_factor = (FOG_MAX_DIST - dist) / (FOG_MAX_DIST - FOG_MIN_DIST);
+	return clamp(fog_factor, 0.0, 1.0);
+}
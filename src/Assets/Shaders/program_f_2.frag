@@ -22,10 +22,8 @@ uniform int emitmode;
 const mediump float PI = 3.141592653;
 const mediump float roughness = 0.99;
 
-// Fog parameters, could make them uniforms and pass them into the fragment shader
-mediump float fog_maxdist = 20.0;
-mediump float fog_mindist = 6.0;
-mediump vec4 fog_colour = vec4(0.4, 0.4, 0.4, 1.0);
+// Fog parameters and fogFactor()
+#include "fog.glsl"
 
 
 // Output pixel fragment colour
@@ -33,10 +31,7 @@ out mediump vec4 outputColor;
 void main()
 {
 	// Calculate fog
-	mediump float dist = length(fposition.xyz);
-	mediump float fog_factor = (fog_maxdist - dist) /
-                  (fog_maxdist - fog_mindist);
-	fog_factor = clamp(fog_factor, 0.0, 1.0);
+	mediump float fog_factor = fogFactor(fposition.xyz);
 	
 	// Create a vec4(0, 0, 0) for our emmissive light but set to zero unless the emitmode flag is set
 	mediump vec4 emissive = vec4(0);				
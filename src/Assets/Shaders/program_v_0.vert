@@ -10,16 +10,19 @@ layout(location = 0) in vec3 position;
 layout(location = 1) in vec4 colour;
 layout(location = 2) in vec3 normal;
 layout(location = 3) in vec3 offset;
+layout(location = 4) in uvec2 facelayers; // Texture array layer of each face, 8 bits per face
+layout(location = 5) in vec2 lift; // Base and shape of the block's height offset, see blockOffset in ChunkBlock.h
 
 // Uniform variables are passed in from the application
 uniform mat4 model, view, projection, light_view;
 uniform int colourmode;
+uniform float heightmod;
 
 // Output the vertex colour - to be rasterized into pixel fragments
 out vec4 fcolour;
 out vec4 fposition;
 
-// Output the  texture coordinate - just pass it through
+// Output the texture coordinate, z is the texture array layer
 out vec3 ftexcoord;
 vec4 ambient = vec4(0.2, 0.2,0.2,1.0);
 vec3 light_dir = vec3(0.0, 0.0, 10.0);
@@ -53,11 +56,28 @@ void main()
 	// Define the vertex colour
 	fcolour = vec4(diffuse, 1.0) + ambient + specular;
 
+	// Raise the block by its height offset, in whole blocks. Generated offsets are kept within MAX_BLOCK_OFFSET (30),
+	// edited blocks have no shape and are raised by the offset they were put at, however far that is
+	float lifted = trunc(lift.x + lift.y * heightmod);
+	float raised = offset.y + (lift.y == 0.0 ? lifted : clamp(lifted, -30.0, 30.0));
+
 	// Define the vertex position
-	gl_Position = projection * view * model * vec4(position_h.x+offset.x/2.0, position_h.y+offset.y/2.0, position_h.z+offset.z/2.0, 1.0);
+	gl_Position = projection * view * model * vec4(position_h.x+offset.x/2.0, position_h.y+raised/2.0, position_h.z+offset.z/2.0, 1.0);
+
+	// Faces are 6 vertices each in the cube buffer so the face is known from the vertex index
+	int face = gl_VertexID / 6;
+	uint layers = face < 4 ? facelayers.x : facelayers.y;
+	uint layer = (layers >> uint((face % 4) * 8)) & 255u;
 
-	// Pas through the texture coordinate
-	ftexcoord = position;
+	// Project the cube corner onto the face plane for the texture coordinate, the image top is +y on side faces
+	vec2 uv;
+	if (normal.x != 0.0)
+		uv = position.zy;
+	else if (normal.z != 0.0)
+		uv = position.xy;
+	else
+		uv = position.xz;
+	ftexcoord = vec3(uv.x * 2.0 + 0.5, 0.5 - uv.y * 2.0, float(layer));
 
 	fposition = gl_Position;
 }
@@ -0,0 +1,229 @@
+/*
+	Camera path playback and frame time report, see Benchmark.h
+	Sameer Al Harbi 2022
+*/
+
+#include "Benchmark.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+bool CameraPath::load(const string& path)
+{
+	ifstream file(path);
+	if (!file.is_open())
+	{
+		cerr << "Could not open camera path " << path << endl;
+		return false;
+	}
+
+	keys.clear();
+	string line;
+	int lineNumber = 0;
+	while (getline(file, line))
+	{
+		lineNumber++;
+		size_t start = line.find_first_not_of(" \t\r");
+		if (start == string::npos || line[start] == '#')
+		{
+			continue;
+		}
+
+		istringstream fields(line);
+		CameraKey key;
+		if (!(fields >> key.time >> key.position.x >> key.position.y >> key.position.z >> key.horizontal >> key.vertical))
+		{
+			cerr << path << ":" << lineNumber << " expected: time x y z horizontal vertical [keys]" << endl;
+			return false;
+		}
+		fields >> key.keys;
+
+		if (!keys.empty() && key.time < keys.back().time)
+		{
+			cerr << path << ":" << lineNumber << " keys must be in time order" << endl;
+			return false;
+		}
+		keys.push_back(key);
+	}
+
+	if (keys.empty())
+	{
+		cerr << "Camera path " << path << " has no keys" << endl;
+		return false;
+	}
+	return true;
+}
+
+void CameraPath::sample(double t, glm::vec3& position, double& horizontal, double& vertical) const
+{
+	size_t next = 0;
+	while (next < keys.size() && keys[next].time <= t)
+	{
+		next++;
+	}
+
+	//Before the first or after the last key the camera holds still
+	if (next == 0 || next == keys.size())
+	{
+		const CameraKey& key = keys[next == 0 ? 0 : keys.size() - 1];
+		position = key.position;
+		horizontal = key.horizontal;
+		vertical = key.vertical;
+		return;
+	}
+
+	const CameraKey& a = keys[next - 1];
+	const CameraKey& b = keys[next];
+	double f = (t - a.time) / (b.time - a.time);
+	position = glm::mix(a.position, b.position, (float)f);
+	horizontal = a.horizontal + (b.horizontal - a.horizontal) * f;
+	vertical = a.vertical + (b.vertical - a.vertical) * f;
+}
+
+string CameraPath::keysBetween(double from, double to) const
+{
+	string pressed;
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		if (keys[i].time > from && keys[i].time <= to)
+		{
+			pressed += keys[i].keys;
+		}
+	}
+	return pressed;
+}
+
+double CameraPath::duration() const
+{
+	return keys.empty() ? 0.0 : keys.back().time;
+}
+
+Benchmark::Benchmark(const string& pathFile, double timestep)
+{
+	this->pathFile = pathFile;
+	this->timestep = timestep;
+	frame = 0;
+	lastTime = 0.0;
+	horizontal = vertical = 0.0;
+	startCounters = { 0, 0, 0 };
+}
+
+bool Benchmark::load()
+{
+	if (!path.load(pathFile))
+	{
+		return false;
+	}
+	frameTimes.reserve(frameCount());
+	cout << "Benchmark: " << pathFile << ", " << frameCount() << " frames at " << timestep * 1000.0 << " ms per step" << endl;
+	return true;
+}
+
+int Benchmark::frameCount() const
+{
+	return (int)floor(path.duration() / timestep + 1e-9) + 1;
+}
+
+bool Benchmark::beginFrame(const BenchmarkCounters& counters)
+{
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	if (frame == 0)
+	{
+		startCounters = counters;
+	}
+	else if ((int)frameTimes.size() < frame)
+	{
+		frameTimes.push_back(chrono::duration<double, milli>(now - frameStart).count());
+	}
+	frameStart = now;
+
+	if (frame >= frameCount())
+	{
+		return false;
+	}
+
+	//Simulated time only depends on the frame number, the first frame also presses the keys at time 0
+	double t = frame * timestep;
+	path.sample(t, position, horizontal, vertical);
+	keys = path.keysBetween(frame == 0 ? -1.0 : lastTime, t);
+	lastTime = t;
+	frame++;
+	return true;
+}
+
+//Nearest rank percentile of sorted times
+static double percentile(const vector<double>& sorted, double p)
+{
+	if (sorted.empty())
+	{
+		return 0.0;
+	}
+	size_t rank = (size_t)ceil(p / 100.0 * sorted.size());
+	return sorted[rank == 0 ? 0 : rank - 1];
+}
+
+bool Benchmark::finish(const BenchmarkCounters& counters, const string& outputPath, const char* modeName)
+{
+	//The loop can also end early (frame limit, window closed) with the last frame still open
+	if (frame > 0 && (int)frameTimes.size() < frame)
+	{
+		frameTimes.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - frameStart).count());
+	}
+
+	if (frameTimes.empty())
+	{
+		cerr << "Benchmark did not run any frames" << endl;
+		return false;
+	}
+
+	vector<double> sorted = frameTimes;
+	sort(sorted.begin(), sorted.end());
+	double total = 0.0;
+	for (size_t i = 0; i < sorted.size(); i++)
+	{
+		total += sorted[i];
+	}
+
+	uint64_t chunkBuilds = counters.chunkBuilds - startCounters.chunkBuilds;
+	uint64_t megaChunkMoves = counters.megaChunkMoves - startCounters.megaChunkMoves;
+	uint64_t uploadBytes = counters.uploadBytes - startCounters.uploadBytes;
+
+	ostringstream json;
+	json << "{\n";
+	json << "  \"path\": \"" << pathFile << "\",\n";
+	json << "  \"mode\": \"" << modeName << "\",\n";
+	json << "  \"frames\": " << frameTimes.size() << ",\n";
+	json << "  \"timestep_ms\": " << timestep * 1000.0 << ",\n";
+	json << "  \"frame_ms\": { \"avg\": " << total / sorted.size() << ", \"p50\": " << percentile(sorted, 50)
+		<< ", \"p95\": " << percentile(sorted, 95) << ", \"p99\": " << percentile(sorted, 99)
+		<< ", \"min\": " << sorted.front() << ", \"max\": " << sorted.back() << " },\n";
+	json << "  \"chunk_builds\": " << chunkBuilds << ",\n";
+	json << "  \"megachunk_moves\": " << megaChunkMoves << ",\n";
+	json << "  \"upload_bytes\": " << uploadBytes << ",\n";
+	json << "  \"upload_bytes_per_frame\": " << uploadBytes / frameTimes.size() << (editLatencyMs.empty() ? "\n" : ",\n");
+	if (!editLatencyMs.empty())
+	{
+		vector<double> edits = editLatencyMs;
+		sort(edits.begin(), edits.end());
+		json << "  \"edit_latency_ms\": { \"count\": " << edits.size() << ", \"p50\": " << percentile(edits, 50)
+			<< ", \"p95\": " << percentile(edits, 95) << ", \"max\": " << edits.back() << " }\n";
+	}
+	json << "}\n";
+
+	cout << json.str();
+
+	ofstream file(outputPath, ios::out | ios::trunc);
+	if (!file.is_open())
+	{
+		cerr << "Could not write benchmark report " << outputPath << endl;
+		return false;
+	}
+	file << json.str();
+	cout << "Benchmark report written to " << outputPath << endl;
+	return true;
+}
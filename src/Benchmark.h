@@ -0,0 +1,86 @@
+/*
+	Scripted camera path benchmark (--benchmark <path-file>).
+	A path file is plain text, one key per line: time x y z horizontal vertical [keys]. Time is in seconds of simulated
+	time, the camera is interpolated linearly between keys and the keys (e.g. H, M, N) are pressed once when their time
+	is reached. Lines starting with # are comments, see benchmarks/flyover.path.
+	Playback starts once every asset is loaded and advances by a fixed timestep per frame no matter how long frames take,
+	so every run renders exactly the same frames and runs can be compared. Frame time percentiles, chunk generation
+	counts, upload bytes and block edit latencies are written as JSON when it ends.
+	Sameer Al Harbi 2022
+*/
+#pragma once
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+struct CameraKey
+{
+	double time;
+	glm::vec3 position;
+	double horizontal;
+	double vertical;
+	std::string keys;
+};
+
+class CameraPath
+{
+public:
+	bool load(const std::string& path);
+
+	//Interpolated camera at time t, clamped to the first/last key
+	void sample(double t, glm::vec3& position, double& horizontal, double& vertical) const;
+
+	//Keys pressed in (from, to]
+	std::string keysBetween(double from, double to) const;
+
+	double duration() const;
+
+	std::vector<CameraKey> keys;
+};
+
+//World work done so far, the benchmark reports the difference over the run
+struct BenchmarkCounters
+{
+	uint64_t chunkBuilds; //Chunks whose instance data was generated
+	uint64_t megaChunkMoves; //Times the 3x3 chunk area moved to follow the camera
+	uint64_t uploadBytes; //Instance data uploaded to the GPU
+};
+
+class Benchmark
+{
+public:
+	Benchmark(const std::string& pathFile, double timestep);
+
+	bool load();
+
+	//Frames the path takes at the fixed timestep
+	int frameCount() const;
+
+	//Call at the start of every frame once the scene is ready. Returns false once the path is finished
+	bool beginFrame(const BenchmarkCounters& counters);
+
+	//Camera and key presses for the frame started by beginFrame
+	glm::vec3 position;
+	double horizontal;
+	double vertical;
+	std::string keys;
+
+	//Edit to visible latencies (BlockEditor), reported when there were any
+	std::vector<double> editLatencyMs;
+
+	//Closes the last frame and writes the report (to stdout and outputPath)
+	bool finish(const BenchmarkCounters& counters, const std::string& outputPath, const char* modeName);
+
+private:
+	std::string pathFile;
+	CameraPath path;
+	double timestep;
+	int frame;
+	double lastTime; //Simulated time of the previous frame
+	std::chrono::steady_clock::time_point frameStart;
+	std::vector<double> frameTimes;
+	BenchmarkCounters startCounters;
+};
@@ -0,0 +1,167 @@
+/*
+	Climate tiles and biome rules, see Biomes.h
+	Sameer Al Harbi 2022
+*/
+
+#include "Biomes.h"
+#include "MemoryTracker.h"
+#include "Profiler.h"
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+const BiomeRules BIOME_RULES[NUM_BIOMES] =
+{
+	//Name, climate (temperature, moisture), amplitude, base, top and fill blocks
+	{ "plains", glm::vec2(0.55f, 0.45f), 0.6f, 0.0f, BLOCK_GRASS, BLOCK_DIRT },
+	{ "forest", glm::vec2(0.45f, 0.85f), 1.0f, 1.0f, BLOCK_GRASS, BLOCK_DIRT },
+	{ "desert", glm::vec2(0.9f, 0.15f), 0.35f, -2.0f, BLOCK_SAND, BLOCK_SAND },
+	{ "hills", glm::vec2(0.4f, 0.2f), 1.6f, 4.0f, BLOCK_GRASS, BLOCK_STONE },
+	{ "tundra", glm::vec2(0.1f, 0.5f), 0.8f, 0.0f, BLOCK_SNOW, BLOCK_DIRT }
+};
+
+//Floor division, so tiles at negative coordinates go below rather than towards 0
+static int floorDiv(int value, int divisor)
+{
+	return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+ClimateMap::ClimateMap(siv::PerlinNoise::seed_type seed) : temperature(seed + 1), moisture(seed + 2)
+{
+	tilesBuilt = 0;
+	lookups = 0;
+	lastTile = 0;
+	uses = 0;
+
+	//Every tile's samples are allocated up front, building one never allocates
+	for (int t = 0; t < CLIMATE_CACHE_TILES; t++)
+	{
+		tiles[t].x = tiles[t].z = 0;
+		tiles[t].valid = false;
+		tiles[t].lastUsed = 0;
+		tiles[t].samples.resize(CLIMATE_SAMPLES * CLIMATE_SAMPLES);
+	}
+	MemoryTracker::cpu(MEMORY_TERRAIN, (int64_t)CLIMATE_CACHE_TILES * CLIMATE_SAMPLES * CLIMATE_SAMPLES * sizeof(glm::vec2));
+}
+
+glm::vec2 ClimateMap::sample(float x, float z) const
+{
+	glm::vec2 noise((float)temperature.normalizedOctave2D_01(x / CLIMATE_SCALE, z / CLIMATE_SCALE, 3),
+		(float)moisture.normalizedOctave2D_01(x / CLIMATE_SCALE, z / CLIMATE_SCALE, 3));
+	return glm::clamp((noise - 0.5f) * CLIMATE_CONTRAST + 0.5f, 0.0f, 1.0f);
+}
+
+ClimateMap::Tile& ClimateMap::tile(int x, int z)
+{
+	uses++;
+	Tile* last = &tiles[lastTile];
+	if (last->valid && last->x == x && last->z == z)
+	{
+		last->lastUsed = uses;
+		return *last;
+	}
+
+	//Cached, or in place of the one used longest ago
+	int oldest = 0;
+	for (int t = 0; t < CLIMATE_CACHE_TILES; t++)
+	{
+		if (tiles[t].valid && tiles[t].x == x && tiles[t].z == z)
+		{
+			lastTile = t;
+			tiles[t].lastUsed = uses;
+			return tiles[t];
+		}
+		if (!tiles[t].valid || (tiles[oldest].valid && tiles[t].lastUsed < tiles[oldest].lastUsed))
+		{
+			oldest = t;
+		}
+	}
+
+	PROFILE_SCOPE("ClimateMap::buildTile");
+	Tile& built = tiles[oldest];
+	built.x = x;
+	built.z = z;
+	built.valid = true;
+	built.lastUsed = uses;
+	for (int i = 0; i < CLIMATE_SAMPLES; i++)
+	{
+		for (int k = 0; k < CLIMATE_SAMPLES; k++)
+		{
+			built.samples[i * CLIMATE_SAMPLES + k] = sample((float)(x * CLIMATE_TILE_BLOCKS + i * CLIMATE_SPACING),
+				(float)(z * CLIMATE_TILE_BLOCKS + k * CLIMATE_SPACING));
+		}
+	}
+	lastTile = oldest;
+	tilesBuilt++;
+	return built;
+}
+
+glm::vec2 ClimateMap::climate(float x, float z)
+{
+	lookups++;
+	int bx = (int)floor(x);
+	int bz = (int)floor(z);
+	const Tile& t = tile(floorDiv(bx, CLIMATE_TILE_BLOCKS), floorDiv(bz, CLIMATE_TILE_BLOCKS));
+
+	//Bilinear between the four samples around the column
+	float u = (x - (float)t.x * CLIMATE_TILE_BLOCKS) / CLIMATE_SPACING;
+	float v = (z - (float)t.z * CLIMATE_TILE_BLOCKS) / CLIMATE_SPACING;
+	int i = std::min((int)u, CLIMATE_SAMPLES - 2);
+	int k = std::min((int)v, CLIMATE_SAMPLES - 2);
+	float fu = u - i;
+	float fv = v - k;
+	const glm::vec2* s = &t.samples[i * CLIMATE_SAMPLES + k];
+	return glm::mix(glm::mix(s[0], s[1], fv), glm::mix(s[CLIMATE_SAMPLES], s[CLIMATE_SAMPLES + 1], fv), fu);
+}
+
+ColumnBiome ClimateMap::blend(glm::vec2 climate, float hash)
+{
+	float distance[NUM_BIOMES];
+	int nearestBiome = 0;
+	for (int b = 0; b < NUM_BIOMES; b++)
+	{
+		distance[b] = glm::length(climate - BIOME_RULES[b].climate);
+		if (distance[b] < distance[nearestBiome])
+		{
+			nearestBiome = b;
+		}
+	}
+	float nearest = distance[nearestBiome];
+
+	//The nearest biome weighs 1, others less the further they are behind it, nothing past BIOME_BLEND
+	float weight[NUM_BIOMES];
+	float total = 0.0f;
+	for (int b = 0; b < NUM_BIOMES; b++)
+	{
+		weight[b] = std::max(0.0f, 1.0f - (distance[b] - nearest) / BIOME_BLEND);
+		total += weight[b];
+	}
+
+	//Rounding can leave hash * total unpicked, the nearest biome is the one then
+	ColumnBiome column = { 0.0f, 0.0f, (Biome)nearestBiome };
+	float pick = hash * total;
+	bool picked = false;
+	for (int b = 0; b < NUM_BIOMES; b++)
+	{
+		column.amplitude += BIOME_RULES[b].amplitude * weight[b] / total;
+		column.base += BIOME_RULES[b].base * weight[b] / total;
+		pick -= weight[b];
+		if (!picked && weight[b] > 0.0f && pick < 0.0f)
+		{
+			column.material = (Biome)b;
+			picked = true;
+		}
+	}
+	return column;
+}
+
+ColumnBiome ClimateMap::column(float x, float z)
+{
+	//Fixed per column, so a border looks the same every time its chunks are generated
+	uint32_t h = (uint32_t)(int)floor(x) * 73856093u ^ (uint32_t)(int)floor(z) * 19349663u;
+	h ^= h >> 13;
+	h *= 0x5bd1e995u;
+	h ^= h >> 15;
+	return blend(climate(x, z), (h & 0xffffff) / (float)0x1000000);
+}
@@ -0,0 +1,105 @@
+/*
+	Biomes, the kind of terrain each column of blocks is, picked from two climate values: temperature and moisture.
+	Both are low frequency 2D noise. Being so smooth they're sampled every CLIMATE_SPACING blocks, once per square tile
+	of CLIMATE_TILE_BLOCKS, and interpolated in between. Tiles are kept in a small cache, so the noise for a tile is
+	worked out once and shared by every chunk on it.
+	Each biome sits at a point in climate space and a column is the biome nearest its climate. Near a border between
+	biomes (within BIOME_BLEND of being as near the other one) the column is weighted between them. Heights blend: each
+	biome scales the terrain noise by its own amplitude and raises it by its own base. Materials can't blend, so a
+	border column is made of one of its biomes, picked at random in proportion to their weights.
+	Sameer Al Harbi 2022
+*/
+#pragma once
+
+#include "BlockTypes.h"
+#include "PerlinNoise.hpp"
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+enum Biome
+{
+	BIOME_PLAINS,
+	BIOME_FOREST,
+	BIOME_DESERT,
+	BIOME_HILLS,
+	BIOME_TUNDRA,
+	NUM_BIOMES
+};
+
+//Height and material rules of a biome
+struct BiomeRules
+{
+	const char* name;
+	glm::vec2 climate; //Temperature and moisture the biome is centred on, 0 to 1
+	float amplitude; //Terrain noise is scaled by heightmod times this
+	float base; //Blocks every block of a column is raised by
+	BlockType top; //Top layer block
+	BlockType fill; //Every block under it
+};
+
+extern const BiomeRules BIOME_RULES[NUM_BIOMES];
+
+//What generating a column needs, blended across biome borders
+struct ColumnBiome
+{
+	float amplitude;
+	float base;
+	Biome material; //Biome whose blocks the column is made of
+};
+
+//Blocks along each side of a climate tile and between its samples. Samples go up to the far edge so a tile can be
+//interpolated across without its neighbours
+const int CLIMATE_TILE_BLOCKS = 256;
+const int CLIMATE_SPACING = 8;
+const int CLIMATE_SAMPLES = CLIMATE_TILE_BLOCKS / CLIMATE_SPACING + 1;
+
+//Tiles cached, far more than the chunks in view ever cover
+const int CLIMATE_CACHE_TILES = 16;
+
+//Blocks per unit of climate noise
+const double CLIMATE_SCALE = 384.0;
+
+//Octave noise stays close to 0.5, climate is stretched by this around it to cover 0 to 1
+const float CLIMATE_CONTRAST = 3.5f;
+
+//How much further from a column's climate a biome can be than the nearest one and still be blended in
+const float BIOME_BLEND = 0.1f;
+
+class ClimateMap
+{
+public:
+	ClimateMap(siv::PerlinNoise::seed_type seed);
+
+	//Biome of the column at (x, z) in block space, from the cached tiles
+	ColumnBiome column(float x, float z);
+
+	//Temperature and moisture of a column from the tiles, or straight from the noise
+	glm::vec2 climate(float x, float z);
+	glm::vec2 sample(float x, float z) const;
+
+	//Blend the biomes for climate into a column, hash (0 to 1, fixed per column) picks its material on a border
+	static ColumnBiome blend(glm::vec2 climate, float hash);
+
+	//For benchmarks: tiles whose noise has been sampled and lookups made
+	uint64_t tilesBuilt;
+	uint64_t lookups;
+
+private:
+	struct Tile
+	{
+		int x, z; //In tiles
+		bool valid;
+		uint64_t lastUsed;
+		std::vector<glm::vec2> samples; //CLIMATE_SAMPLES^2, x major
+	};
+
+	Tile& tile(int x, int z);
+
+	Tile tiles[CLIMATE_CACHE_TILES];
+	int lastTile; //Consecutive lookups are nearly always on the same tile
+	uint64_t uses;
+
+	const siv::PerlinNoise temperature;
+	const siv::PerlinNoise moisture;
+};
@@ -0,0 +1,177 @@
+/*
+	Block editing and remeshing, see BlockEditor.h
+	Sameer Al Harbi 2022
+*/
+
+#include "BlockEditor.h"
+#include "Profiler.h"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+BlockEditor::BlockEditor()
+{
+	applied = 0;
+	failed = 0;
+
+	//Recording a latency never allocates mid-frame
+	latencyMs.reserve(EDIT_LATENCY_SAMPLES);
+}
+
+bool BlockEditor::edit(ChunkCache& cache, const ChunkBlock& generator, const BlockEditRequest& request)
+{
+	Ray ray = { request.origin, request.direction, EDIT_REACH };
+	RayHit hit;
+	if (!VoxelRaycaster::cast(scene, ray, hit))
+	{
+		return false;
+	}
+
+	//A ray starting inside a block has no face to place against
+	glm::ivec3 cell = request.type == EDIT_REMOVE ? hit.block : hit.block + hit.normal;
+	if (request.type == EDIT_PLACE && hit.normal == glm::ivec3(0))
+	{
+		return false;
+	}
+
+	//Placing against the side of a chunk's edge block puts it in the next chunk
+	CachedChunk* chunk = cache.findContaining(glm::vec3(cell) + 0.5f, generator.size);
+	if (chunk == NULL)
+	{
+		return false;
+	}
+
+	//Every edit to a chunk has to be rebuilt, so one that can't be queued isn't made
+	DirtyChunk* queued = NULL;
+	for (size_t d = 0; d < dirty.size(); d++)
+	{
+		if (dirty[d].position == chunk->position)
+		{
+			queued = &dirty[d];
+		}
+	}
+	if (queued == NULL && dirty.size() == dirty.capacity())
+	{
+		return false;
+	}
+
+	//Noise moves every block of a column up or down on its own, the one in the cell is found by its height
+	int i = cell.x - (int)chunk->position.x;
+	int k = cell.z - (int)chunk->position.z;
+	int height = cell.y - (int)chunk->position.y;
+	int slot = -1;
+	int offset = 0;
+	for (int j = generator.size - 1; j >= 0 && slot < 0; j--)
+	{
+		int8_t current = chunk->offsets[generator.blockIndex(i, j, k)];
+		offset = height - j;
+		if (request.type == EDIT_REMOVE)
+		{
+			slot = current != BLOCK_REMOVED && current == offset ? j : -1;
+		}
+		else
+		{
+			//A column has size blocks, a new one takes the place of a removed one (the highest that can reach)
+			slot = current == BLOCK_REMOVED && offset > BLOCK_REMOVED && offset <= INT8_MAX ? j : -1;
+		}
+	}
+	if (slot < 0)
+	{
+		return false;
+	}
+	cache.edit(chunk, generator.blockIndex(i, slot, k), request.type == EDIT_REMOVE ? BLOCK_REMOVED : (int8_t)offset);
+
+	if (queued == NULL)
+	{
+		DirtyChunk added = { chunk->position, request.requested };
+		dirty.push_back(added);
+	}
+	return true;
+}
+
+void BlockEditor::apply(ChunkCache& cache, const ChunkBlock& generator, const BlockEditRequest* edits, int count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	//Edits update the chunks' occupancy as they're made, so each edit sees the ones before it
+	cache.fillScene(scene, generator.size);
+	for (int e = 0; e < count; e++)
+	{
+		if (edit(cache, generator, edits[e]))
+		{
+			applied++;
+		}
+		else
+		{
+			failed++;
+		}
+	}
+}
+
+void BlockEditor::remesh(ChunkCache& cache, ChunkBlock& generator)
+{
+	PROFILE_SCOPE("BlockEditor::remesh");
+
+	//Dirty chunks are in the order they were first edited
+	remeshed.clear();
+	size_t done = 0;
+	while (done < dirty.size() && remeshed.size() < remeshed.capacity())
+	{
+		//Evicted since, its edits were saved with it (or are lost without a store)
+		CachedChunk* chunk = cache.find(dirty[done].position);
+		if (chunk)
+		{
+			cache.remesh(generator, chunk);
+			remeshed.push_back(dirty[done]);
+		}
+		done++;
+	}
+
+	for (size_t d = done; d < dirty.size(); d++)
+	{
+		dirty[d - done] = dirty[d];
+	}
+	for (size_t d = 0; d < done; d++)
+	{
+		dirty.pop_back();
+	}
+}
+
+void BlockEditor::frameDrawn()
+{
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	for (size_t r = 0; r < remeshed.size() && latencyMs.size() < latencyMs.capacity(); r++)
+	{
+		latencyMs.push_back(chrono::duration<double, milli>(now - remeshed[r].oldest).count());
+	}
+	remeshed.clear();
+}
+
+//Nearest rank, of a copy so the samples keep their order
+static double percentile(vector<double> samples, double p)
+{
+	sort(samples.begin(), samples.end());
+	size_t rank = (size_t)ceil(p / 100.0 * samples.size());
+	return samples[rank == 0 ? 0 : rank - 1];
+}
+
+void BlockEditor::printStats()
+{
+	if (applied + failed == 0)
+	{
+		return;
+	}
+
+	cout << "Block edits: " << applied << " made, " << failed << " not possible (no block in reach or no room)";
+	if (!latencyMs.empty())
+	{
+		cout << ", edit to visible p50 " << percentile(latencyMs, 50) << " ms p95 " << percentile(latencyMs, 95) << " ms max "
+			<< percentile(latencyMs, 100) << " ms";
+	}
+	cout << endl;
+}
@@ -0,0 +1,86 @@
+/*
+	Removing and placing blocks (R and F, at the block the camera is looking at).
+	Edits are requested on the main thread and carried to the renderer in the frame snapshot, which owns the chunks.
+	There a ray from the camera picks the block (see VoxelRaycast.h): R removes it and F places one against the face
+	the ray hit. An edit changes one block of a resident chunk through ChunkCache::edit and marks the chunk dirty. Dirty
+	chunks are rebuilt from their offsets (no noise) at most REMESH_BUDGET a frame, before the chunks are drawn, so an
+	edit normally shows in the frame it reaches and a burst of edits spreads over the next few. Nothing else is rebuilt:
+	every block is drawn whole with no faces culled against the chunk next to it, so an edit on a chunk border has
+	nothing to change in the neighbouring chunk.
+	Edit to visible latency is the time from the request to the end of the frame that first draws its chunk rebuilt,
+	reported at exit (and in the benchmark report). It includes the wait for the renderer to take the snapshot.
+	Sameer Al Harbi 2022
+*/
+#pragma once
+
+#include "ChunkCache.h"
+#include "FixedContainers.h"
+#include "VoxelRaycast.h"
+#include <glm/glm.hpp>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+
+enum BlockEditType
+{
+	EDIT_REMOVE, //The block the ray hits
+	EDIT_PLACE //A block in front of the face the ray hits, in one of its column's removed blocks' places
+};
+
+struct BlockEditRequest
+{
+	BlockEditType type;
+	glm::vec3 origin; //Of the picking ray, in block space
+	glm::vec3 direction;
+	std::chrono::steady_clock::time_point requested;
+};
+
+//Edits carried by one frame snapshot, more requested in a frame wait for the next
+const int MAX_EDITS_PER_FRAME = 8;
+
+//Edited chunks rebuilt per frame, the rest wait for the next
+const int REMESH_BUDGET = 2;
+
+//Chunks that can be waiting to be rebuilt, edits to any more are dropped
+const int MAX_DIRTY_CHUNKS = 32;
+
+//Furthest block from the camera that can be edited, in blocks
+const float EDIT_REACH = 48.0f;
+
+//Latencies kept for the report
+const int EDIT_LATENCY_SAMPLES = 4096;
+
+class BlockEditor
+{
+public:
+	BlockEditor();
+
+	//Change the blocks edits ask for in the resident chunks, laid out as generator lays out chunks
+	void apply(ChunkCache& cache, const ChunkBlock& generator, const BlockEditRequest* edits, int count);
+
+	//Rebuild up to REMESH_BUDGET dirty chunks, oldest edit first
+	void remesh(ChunkCache& cache, ChunkBlock& generator);
+
+	//The frame the last remesh was for has been drawn
+	void frameDrawn();
+
+	void printStats();
+
+	uint64_t applied;
+	uint64_t failed; //No block within reach, or no room to place
+	std::vector<double> latencyMs; //Edit to visible, one per rebuilt chunk (its oldest edit)
+
+private:
+	struct DirtyChunk
+	{
+		glm::vec3 position;
+		std::chrono::steady_clock::time_point oldest; //First edit not drawn yet
+	};
+
+	bool edit(ChunkCache& cache, const ChunkBlock& generator, const BlockEditRequest& request);
+
+	VoxelScene scene; //Resident chunks edits are picked from
+
+	FixedVector<DirtyChunk, MAX_DIRTY_CHUNKS> dirty;
+	FixedVector<DirtyChunk, REMESH_BUDGET> remeshed; //Rebuilt this frame, waiting to be drawn
+};
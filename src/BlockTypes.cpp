@@ -0,0 +1,40 @@
+/*
+	Block face texture table, see BlockTypes.h
+	Sameer Al Harbi 2022
+*/
+
+#include "BlockTypes.h"
+
+/*
+	These textures are from Kenny Game Assets, Voxel Pack available here: https://www.kenney.nl/assets/voxel-pack
+	Sand, snow and stone are the dirt texture recoloured
+*/
+const std::vector<std::string> BLOCK_TEXTURE_LAYERS
+{
+	"Grassblock/grass_top.png", //0
+	"Grassblock/dirt_grass.png", //1
+	"Grassblock/dirt.png", //2
+	"Grassblock/sand.png", //3
+	"Grassblock/snow.png", //4
+	"Grassblock/stone.png" //5
+};
+
+//Layer used by each face of each block type, same face order as BLOCK_FACES
+static const unsigned char BLOCK_FACE_LAYERS[NUM_BLOCK_TYPES][BLOCK_FACES] =
+{
+	{ 1, 1, 1, 1, 2, 0 }, //Grass - grass sides, dirt bottom, grass top
+	{ 2, 2, 2, 2, 2, 2 }, //Dirt
+	{ 3, 3, 3, 3, 3, 3 }, //Sand
+	{ 4, 4, 4, 4, 2, 4 }, //Snow - dirt bottom
+	{ 5, 5, 5, 5, 5, 5 } //Stone
+};
+
+void blockTypeFaceLayers(BlockType type, GLuint packed[2])
+{
+	packed[0] = 0;
+	packed[1] = 0;
+	for (int f = 0; f < BLOCK_FACES; f++)
+	{
+		packed[f / 4] |= (GLuint)BLOCK_FACE_LAYERS[type][f] << ((f % 4) * 8);
+	}
+}
@@ -0,0 +1,37 @@
+/*
+	Block types and the textures their faces use. All block face textures are layers of one GL_TEXTURE_2D_ARRAY,
+	each instance in a chunk carries the layer index of its 6 faces so every block type is drawn in the same
+	instanced terrain draw call. Adding a block type only needs a new entry in blockTypeFaceLayers (and any
+	new textures appended to BLOCK_TEXTURE_LAYERS).
+	Sameer Al Harbi 2022
+*/
+#pragma once
+
+#include "wrapper_glfw.h"
+#include <vector>
+#include <string>
+
+enum BlockType
+{
+	BLOCK_GRASS,
+	BLOCK_DIRT,
+	BLOCK_SAND,
+	BLOCK_SNOW,
+	BLOCK_STONE,
+	NUM_BLOCK_TYPES
+};
+
+/*
+	Faces in the order the chunk cube vertices are defined in (ChunkBlock::makeChunkBlock)
+	0 = -z, 1 = +x, 2 = +z, 3 = -x, 4 = -y (bottom), 5 = +y (top)
+*/
+const int BLOCK_FACES = 6;
+
+//Image for each texture array layer, they must all be the same size
+extern const std::vector<std::string> BLOCK_TEXTURE_LAYERS;
+
+/*
+	Texture layer of each face of a block type packed 8 bits per face, faces 0-3 in x and 4-5 in y.
+	This is the per instance attribute read by program_v_0.vert
+*/
+void blockTypeFaceLayers(BlockType type, GLuint packed[2]);
@@ -28,27 +28,38 @@ if you prefer */
 #include "glm/gtc/matrix_transform.hpp"
 #include <glm/gtc/type_ptr.hpp>
 
-/* Include the image loader */
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
-
 // Object loader classes
 #include "ModelLoader/tiny_loader_texture.h"
 
 //Perlin Noise for random gen - MIT Licensed Library on github : https://github.com/Reputeless/PerlinNoise
 # include "PerlinNoise.hpp"
 
-/* Stack Data Structure */
-#include <stack>
+/* Fixed capacity stack for model transformations, and per-frame memory */
+#include "FixedContainers.h"
+#include "FrameAllocator.h"
+#include "AllocationTracker.h"
+
+/* Command line parsing */
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+
+/* Packed assets */
+#include "AssetPack.h"
+
+/* Embedded shaders and program cache */
+#include "ShaderLibrary.h"
+
+/* PROFILE_SCOPE timings and trace export */
+#include "Profiler.h"
+#include "GpuTimer.h"
+#include "MemoryTracker.h"
 
 using namespace std;
 using namespace glm;
 
 #include "BlockWorld.h"
 
-bool load_texture(char* filename, GLuint& texID, bool bGenMipmaps);
-bool loadCubeMap(GLuint& texID, vector<std::string> faces);
-
 // Not ideal way to do this, need refactor to ensure pure functions for web loop.
 double GLOBAL_horizontalCam;
 double GLOBAL_verticalCam;
@@ -63,10 +74,12 @@ int GLOBAL_colourmode;
 GLuint GLOBAL_drawmode;
 float GLOBAL_LightMode;
 float GLOBAL_automove;
+const char* GLOBAL_tracePath = "BlockWorld.trace.json";
+bool GLOBAL_printMemory;
+bool GLOBAL_printGpuTimes;
+FixedVector<BlockEditRequest, MAX_EDITS_PER_FRAME> GLOBAL_editRequests; //Key presses waiting for the next snapshot
 
-BlockWorld::BlockWorld() {
-	cube = Cube(true);
-}
+static void keyCallback(GLFWwindow* window, int key, int s, int action, int mods);
 
 //Menu of Controls
 void Menu()
@@ -78,161 +91,21 @@ void Menu()
 	cout << "Use H to cycle Height Modifier of terrain to a maximum value" << endl;
 	cout << "Use L to cycle light" << endl;
 	cout << "Use P to pause/unpause movement" << endl;
+	cout << "Use T to start profiling, press again to save a trace" << endl;
+	cout << "Use U to print memory use" << endl;
 	cout << "" << endl;
 }
 
-//Extensively uses code from https://learnopengl.com/Advanced-OpenGL/Cubemaps
-// Cube Map texture Loader / loads each face in faces vector. Returns true if texture loaded successfully
-bool loadCubeMap(GLuint& texID, vector<std::string> faces)
-{
-	glGenTextures(1, &texID);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, texID);
-
-	// local image parameters
-	int width, height, nrChannels;
-
-	for (unsigned int i = 0; i < faces.size(); i++)
-	{
-		unsigned char* data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-		if (data)
-		{
-			//Figure out what pixel format image is in
-			int pixel_format = 0;
-			if (nrChannels == 3)
-				pixel_format = GL_RGB;
-			else
-				pixel_format = GL_RGBA;
-			
-			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-				0, pixel_format, width, height, 0, pixel_format, GL_UNSIGNED_BYTE, data
-			);
-			stbi_image_free(data);
-		}
-		else
-		{
-			std::cout << "Cubemap tex failed to load at path: " << faces[i] << std::endl;
-			stbi_image_free(data);
-			return false;
-		}
-	}
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-
-	return true;
-}
-
-//Regular Texture Loader - One Image. Returns true if texture loaded successfully
-bool load_texture(const char* filename, GLuint& texID, bool bGenMipmaps)
-{
-	glGenTextures(1, &texID);
-	// local image parameters
-	int width, height, nrChannels;
-
-	/* load an image file using stb_image */
-	unsigned char* data = stbi_load(filename, &width, &height, &nrChannels, 0);
-
-	// check for an error during the load process
-	if (data)
-	{
-		// Note: this is not a full check of all pixel format types, just the most common two!
-		int pixel_format = 0;
-		if (nrChannels == 3)
-			pixel_format = GL_RGB;
-		else
-			pixel_format = GL_RGBA;
-
-		// Bind the texture ID before the call to create the texture.
-			// texID[i] will now be the identifier for this specific texture
-		glBindTexture(GL_TEXTURE_2D, texID);
-
-		// Create the texture, passing in the pointer to the loaded image pixel data
-		glTexImage2D(GL_TEXTURE_2D, 0, pixel_format, width, height, 0, pixel_format, GL_UNSIGNED_BYTE, data);
-
-		// Generate Mip Maps
-		if (bGenMipmaps)
-		{
-			glGenerateMipmap(GL_TEXTURE_2D);
-		}
-		else
-		{
-			// If mipmaps are not used then ensure that the min filter is defined
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		}
-	}
-	else
-	{
-		printf("stb_image  loading error: filename=%s", filename);
-		return false;
-	}
-	stbi_image_free(data);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-
-	return true;
-}
-
-//Generate positions at which chunks need to be drawn 
-static void generateMegaChunk(bool origin, glm::vec3 direction, BlockWorld *bw)
-{
-	/*
-		Mega Chunk Structure
-		|___| = One Chunk
-		|_x_| = Middle Chunk spawned at cam position and used to calculate rest of Mega Chunk relatively if orgin = true
-	
-		1|___|2|___|3|___|
-		4|___|5|_x_|6|___|
-		7|___|8|___|9|___|
-
-		When generating new mega chunks as the player is moving, instead of spawing a new chunk at camera position instead get 
-		the direction the player is moving and move the megachunk respectively, unchanged chunks are regenerated this way which could be improved 
-		chunks use perlin noise based on world position so the terrain looks continous irrespective of how chunks movement and regeneration
-	*/
-	
-	int chunkSize = bw->chunkblock.getChunkSize(); //Get size of a single chunk, default is defined as 16
-	glm::vec3 ip = glm::vec3(0, 0, 0); 
-	
-	if (origin == true)
-	{
-		ip = glm::vec3(bw->cam_x - chunkSize / 2, -20, bw->cam_z - chunkSize / 2); //Calculate where the new middle chunk should be based on cam positon
-		bw->chunkOrigin = glm::vec3(ip.x, ip.y, ip.z);
-	}
-	else
-	{
-		ip = glm::vec3(bw->chunkOrigin.x + direction.x, -20, bw->chunkOrigin.z + direction.z); //Move whole mega chunk towards a direction
-		bw->chunkOrigin = glm::vec3(ip.x, ip.y, ip.z);
-	}
-		
-	//Define actual positions of chunks 
-	bw->megaChunk[0] = glm::vec3(ip.x + chunkSize, ip.y, ip.z + chunkSize); //1
-	bw->megaChunk[1] = vec3(ip.x, ip.y, ip.z + chunkSize); //2
-	bw->megaChunk[2] = vec3(ip.x - chunkSize, ip.y, ip.z + chunkSize); //3
-
-	bw->megaChunk[3] = vec3(ip.x + chunkSize, ip.y, ip.z); //4
-	bw->megaChunk[4] = vec3(ip.x, ip.y, ip.z); //5
-	bw->megaChunk[5] = vec3(ip.x - chunkSize, ip.y, ip.z); //6
-
-	bw->megaChunk[6] = vec3(ip.x + chunkSize, ip.y, ip.z - chunkSize); //7
-	bw->megaChunk[7] = vec3(ip.x, ip.y, ip.z - chunkSize); //8
-	bw->megaChunk[8] = vec3(ip.x - chunkSize, ip.y, ip.z - chunkSize); //9
-}
-
 /*
 This function is called before entering the main rendering loop.
 Use it for all your initialisation stuff
 */
 static void init(GLWrapper* glw, BlockWorld* bw)
 {
+	PROFILE_SCOPE("init");
+
+	bw->glw = glw;
+
 	/* Set the object transformation controls to their initial values */
 
 	//Initial Terrain Position 
@@ -271,12 +144,18 @@ static void init(GLWrapper* glw, BlockWorld* bw)
 		These Models have been purchased as part of the POLYGON - Adventure Pack from the Synty Store
 		The Pack: https://syntystore.com/products/polygon-adventure-pack?_pos=1&_sid=19b8ccc9f&_ss=r
 	*/
-	bw->tree1.load_obj("Models/SM_Env_TreePine_03.obj");
-	bw->tree2.load_obj("Models/SM_Env_Tree_01.obj");
+	//Parsed on the loader's worker threads, the trees are skipped by drawObject until their buffers exist
+	bw->loader = new AssetLoader();
+	bw->loader->loadModel(&bw->tree1, "Models/SM_Env_TreePine_03.obj");
+	bw->loader->loadModel(&bw->tree2, "Models/SM_Env_Tree_01.obj");
 
 	//Create initial terrain megachunk positions using inital position
 	generateMegaChunk(true, bw->chunkOrigin, bw);
 
+	//Start as high over the surface as in the flat world
+	bw->startHeight = bw->megaChunk[0].y - WORLD_BASE_Y;
+	bw->cam_y = bw->startHeight;
+
 	// This is the location of the texture object (TEXTURE0), i.e. tex1 will be the name
 	// of the sampler in the fragment shader
 	int loc;
@@ -311,27 +190,19 @@ static void init(GLWrapper* glw, BlockWorld* bw)
 		if (loc >= 0) glUniform1i(loc, 0);
 	}
 
+	//Compile/link cost, or cache load cost when the programs were linked on a previous run
+	ShaderLibrary::printStats();
+
+	GpuTimer::init();
+
 	//Uniform that's only for shader program 0 & 2 - Terrain & Trees
 	bw->lightviewID[0] = glGetUniformLocation(bw->program[0], "light_view");
 	bw->lightviewID[1] = glGetUniformLocation(bw->program[2], "light_view");
+	bw->heightmodID = glGetUniformLocation(bw->program[0], "heightmod");
 
 	//Uniform that's only for shader program 2 - Trees
 	bw->normalMatrixID = glGetUniformLocation(bw->program[2], "normalmatrix");
 
-	//Define texture images that make a terrain block cubemap texture
-	/*
-		These textures are from Kenny Game Assets, Voxel Pack available here: https://www.kenney.nl/assets/voxel-pack
-	*/
-	vector<std::string> faces
-	{
-			"Grassblock/dirt_grass.png",
-			"Grassblock/dirt_grass.png",
-			"Grassblock/grass_top.png",
-			"Grassblock/dirt.png",
-			"Grassblock/dirt_grass.png",
-			"Grassblock/dirt_grass.png"
-	};
-
 	//Skybox cubemap
 	/*
 		These skybox textures are from OpenGameArt uploaded by Spiney as Cloudy Skyboxes, Available Here: https://opengameart.org/content/cloudy-skyboxes
@@ -346,28 +217,15 @@ static void init(GLWrapper* glw, BlockWorld* bw)
 			"Skybox/bluecloud_lf.jpg"
 	};
 
-	if (!loadCubeMap(bw->GrassTextureID, faces))
-	{
-		cout << "Fatal error loading Grass Cubemap" << endl;
-		exit(0);
-	}
-
-	if (!loadCubeMap(bw->SkyTextureID, faces_back))
-	{
-		cout << "Fatal error loading Grass Cubemap" << endl;
-		exit(0);
-	}
-
-	stbi_set_flip_vertically_on_load(true);
+	//Prefer the ETC2 versions made by tools/etc2_converter, decode the originals only if those are missing or unsupported
+	//Texture IDs are valid straight away (placeholder texel), the real data is uploaded by loader->pump() once decoded
+	//Block face textures are the layers of one texture array (BlockTypes.h)
+	bw->BlockTextureID = bw->loader->loadTextureArray(BLOCK_TEXTURE_LAYERS, "Grassblock/blocktextures.ktx");
+	bw->SkyTextureID = bw->loader->loadCubeMap(faces_back, "Skybox/bluecloud.ktx");
 
 	//Load in Atlas Texture for models - Was distributed with models (See above)
-	const char* atlasfilename = "PolyAdventureTexture_01.png";
-
-	if (!load_texture(atlasfilename, bw->AtlasID, true))
-	{
-		cout << "Fatal error loading Atlas Texture" << endl;
-		exit(0);
-	}
+	//The compressed atlas is flipped when it's converted
+	bw->AtlasID = bw->loader->loadTexture("PolyAdventureTexture_01.png", true, true, "PolyAdventureTexture_01.ktx");
 
 	GLOBAL_horizontalCam = bw->horizontalCam;
 	GLOBAL_verticalCam = bw->verticalCam;
@@ -382,6 +240,12 @@ static void init(GLWrapper* glw, BlockWorld* bw)
 	GLOBAL_drawmode = bw->drawmode;
 	GLOBAL_automove = 0.1;
 
+	//Simulation starts where the camera was just placed
+	bw->currentCamera.position = vec3(bw->cam_x, bw->cam_y, bw->cam_z);
+	bw->currentCamera.horizontal = bw->horizontalCam;
+	bw->currentCamera.vertical = bw->verticalCam;
+	bw->previousCamera = bw->currentCamera;
+
 	//Projection matrix : 45� Field of View, 4:3 ratio, display range : 0.1 unit <-> 100 units
 	bw->projection = perspective(radians(90.0f), bw->aspect_ratio, 0.1f, 100.0f);
 
@@ -392,8 +256,15 @@ static void init(GLWrapper* glw, BlockWorld* bw)
 /*
 	Display subfunction that handles rendering trees (program 2)
 */
-static void display_Trees(mat4 view, mat4 lightview, mat4 projection, TinyObjLoader tree, TinyObjLoader alt_tree, BlockWorld *bw)
+static void display_Trees(mat4 view, mat4 lightview, mat4 projection, const vec3* props, int numProps, const FrameSnapshot& frame, BlockWorld *bw)
 {
+	PROFILE_SCOPE("display_Trees");
+
+	if (numProps == 0)
+	{
+		return;
+	}
+
 	glUseProgram(bw->program[2]);
 
 	/* Enable depth test  */
@@ -406,11 +277,11 @@ static void display_Trees(mat4 view, mat4 lightview, mat4 projection, TinyObjLoa
 
 	// Define our model transformation in a stack and 
 	// push the identity matrix onto the stack
-	stack<mat4> model;
+	FixedStack<mat4, MATRIX_STACK_DEPTH> model;
 	model.push(mat4(1.0f));
 
 	// Send our uniforms variables to the currently bound shader,
-	glUniform1i(bw->colourmodeID[2], bw->colourmode);
+	glUniform1i(bw->colourmodeID[2], frame.colourmode);
 	glUniformMatrix4fv(bw->viewID[2], 1, GL_FALSE, &(view[0][0]));
 	glUniformMatrix4fv(bw->projectionID[2], 1, GL_FALSE, &(projection)[0][0]);
 	glUniformMatrix4fv(bw->lightviewID[1], 1, GL_FALSE, &(lightview[0][0]));
@@ -419,11 +290,11 @@ static void display_Trees(mat4 view, mat4 lightview, mat4 projection, TinyObjLoa
 	glBindTexture(GL_TEXTURE_2D, bw->AtlasID);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 
-	//Render 5 Trees 
-	for (int i = 1; i < 3; i++)
+	//Render a tree on every prop slot collected from the chunks drawn
+	for (int i = 0; i < numProps; i++)
 	{
-		//Get Position of a top block of previously rendered chunk
-		vec3 pos = bw->chunkblock.getTranslations((14 + 15 * 16) * (i * 2));
+		//Get Position of a top block of the chunk
+		vec3 pos = props[i];
 
 		model.push(model.top());
 		{
@@ -435,14 +306,14 @@ static void display_Trees(mat4 view, mat4 lightview, mat4 projection, TinyObjLoa
 			bw->normalmatrix = transpose(inverse(mat3(lightview * model.top())));
 			glUniformMatrix3fv(bw->normalMatrixID, 1, GL_FALSE, &(bw->normalmatrix[0][0]));
 
-			//Draw one of two tree models 
-			if (i > 1)
+			//Draw one of two tree models, alternating slots in each chunk
+			if (i % frame.propDensity % 2 == 1)
 			{
-				alt_tree.drawObject(bw->drawmode);
+				bw->tree2.drawObject(frame.drawmode);
 			}
 			else
 			{
-				tree.drawObject(bw->drawmode);
+				bw->tree1.drawObject(frame.drawmode);
 			}
 		}
 		model.pop();
@@ -455,8 +326,10 @@ static void display_Trees(mat4 view, mat4 lightview, mat4 projection, TinyObjLoa
 /*
 	Display subfunction that handles rendering terrain (program 0)
 */
-void display_Terrain(mat4 view, mat4 lightview, vec3 camPos, vec3 camDirection, mat4 projection, BlockWorld *bw)
+void display_Terrain(const FrameSnapshot& frame, mat4 projection, BlockWorld *bw)
 {
+	PROFILE_SCOPE("display_Terrain");
+
 	/* Enable depth test  */
 	glEnable(GL_DEPTH_TEST);
 	glDepthMask(GL_TRUE);
@@ -469,71 +342,87 @@ void display_Terrain(mat4 view, mat4 lightview, vec3 camPos, vec3 camDirection,
 
 	// Define our model transformation in a stack and 
 	// push the identity matrix onto the stack
-	stack<mat4> model;
+	FixedStack<mat4, MATRIX_STACK_DEPTH> model;
 	model.push(mat4(1.0f));
 
 	// Send our uniforms variables to the currently bound shader,
-	glUniform1i(bw->colourmodeID[0], bw->colourmode);
-	glUniformMatrix4fv(bw->viewID[0], 1, GL_FALSE, &(view[0][0]));
+	glUniform1i(bw->colourmodeID[0], frame.colourmode);
+	glUniformMatrix4fv(bw->viewID[0], 1, GL_FALSE, &(frame.view[0][0]));
 	glUniformMatrix4fv(bw->projectionID[0], 1, GL_FALSE, &(projection[0][0]));
-	glUniformMatrix4fv(bw->lightviewID[0], 1, GL_FALSE, &(lightview[0][0]));
+	glUniformMatrix4fv(bw->lightviewID[0], 1, GL_FALSE, &(frame.lightview[0][0]));
+	glUniform1f(bw->heightmodID, (float)frame.heightmod);
 
 	model.top() = scale(model.top(), vec3(2.0f, 2.0f, 2.0f));//scale equally in all axis
 
-	//Check if camera position is approaching megachunks bounds, if so- then regenerate for the new camera position
-	//X Bounds
-	if (bw->cam_x > 32 + bw->megaChunk[5].x)
-	{
-		generateMegaChunk(false, glm::vec3(16, 0, 0), bw);
-	}
-	else if (bw->cam_x < bw->megaChunk[5].x + 16)
-	{
-		generateMegaChunk(false, glm::vec3(-16, 0, 0), bw);
-	}
-	//Z Bounds
-	if (bw->cam_z > bw->megaChunk[5].z + 16)
-	{
-		generateMegaChunk(false, glm::vec3(0, 0, 16), bw);
-	}
-	else if (bw->cam_z < bw->megaChunk[5].z -16)
-	{
-		generateMegaChunk(false, glm::vec3(0, 0, -16), bw);
-	}
+	//Bind block face texture array, every block type is in it
+	glBindTexture(GL_TEXTURE_2D_ARRAY, bw->BlockTextureID);
 
-	//Bind Grass Block texture
-	glBindTexture(GL_TEXTURE_CUBE_MAP, bw->GrassTextureID);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	//Chunks not generated yet, or loaded whole for another terrain height, are generated at most chunkBudget a frame,
+	//nearest first. Until its turn a new chunk isn't drawn and an outdated one is drawn as it was. Every other chunk is
+	//brought to the terrain height without being generated, heightmod is applied by the shader
+	int budget = frame.chunkBudget;
+	bw->chunkCache.rescale(bw->chunkblock, frame.heightmod);
+
+	//Trees are drawn after all the terrain so their program and texture are only bound once
+	vec3* props = bw->frameMemory.allocate<vec3>(frame.visibleChunks * frame.propDensity);
+	int numProps = 0;
 
-	//9 as in 9 locations defined in megachunk 
-	for (int i = 0; i < 9; i++)
+	//Edited chunks are rebuilt before they're drawn, so an edit shows in the frame it arrives in when it's in budget
+	bw->editor.apply(bw->chunkCache, bw->chunkblock, frame.edits, frame.editCount);
+	bw->editor.remesh(bw->chunkCache, bw->chunkblock);
+
+	GpuTimer::begin(GPU_PASS_TERRAIN);
+	for (int i = 0; i < frame.visibleChunks; i++)
 	{
+		CachedChunk* chunk = bw->chunkCache.find(frame.chunks[i]);
+		if ((chunk == NULL || chunk->heightmod != frame.heightmod) && budget > 0)
+		{
+			chunk = bw->chunkCache.generate(bw->chunkblock, frame.chunks[i], frame.heightmod); //Build a Chunk at position set out in megachunk
+			budget--;
+		}
+		if (chunk == NULL)
+		{
+			continue;
+		}
+		bw->chunkCache.use(chunk);
+
+		for (int p = 0; p < frame.propDensity; p++)
+		{
+			props[numProps++] = chunk->props[p];
+		}
+
 		model.push(model.top());
 		{
 			model.top() = translate(model.top(), vec3(bw->x, bw->y, bw->z));
 			glUniformMatrix4fv(bw->modelID[0], 1, GL_FALSE, &(model.top()[0][0]));
 
-			bw->chunkblock.buildInstanceData(bw->megaChunk[i], bw->heightmod); //Build a Chunk at position set out in megachunk
-			bw->chunkblock.drawChunkBlock(bw->drawmode); //Draw that chunk
-
-			display_Trees(view, lightview, projection, bw->tree1, bw->tree2, bw); //Render tree's for that chunk
-
-			glUseProgram(bw->program[0]); //After tree rendering is done, prepare to render next chunk
+			bw->chunkblock.drawChunkBlock(frame.drawmode, chunk->instanceData, chunk->instanceCount); //Draw that chunk
 		}
 		model.pop();
 	}
+	GpuTimer::end();
+
+	GpuTimer::begin(GPU_PASS_PROPS);
+	display_Trees(frame.view, frame.lightview, projection, props, numProps, frame, bw); //Render tree's for every chunk drawn
+	GpuTimer::end();
+
+	//Chunks out of view are evicted once the cache is over its memory budget
+	bw->chunkCache.endFrame(frame.camPos);
 }
 
 /*
 	Display subfunction that handles rendering the skybox (program 1)
 */
-void display_SkyBox(vec3 up, vec3 camPos, vec3 camDirection, mat4 projection, BlockWorld* bw)
+void display_SkyBox(const FrameSnapshot& frame, mat4 projection, BlockWorld* bw)
 {
+	PROFILE_SCOPE("display_SkyBox");
+
 	/* Make the compiled shader program current */
 	glUseProgram(bw->program[1]);
 
 	// Define our model transformation in a stack and 
 	// push the identity matrix onto the stack
-	stack<mat4> model;
+	FixedStack<mat4, MATRIX_STACK_DEPTH> model;
 	model.push(mat4(1.0f));
 
 	//Don't Cull Faces
@@ -542,12 +431,12 @@ void display_SkyBox(vec3 up, vec3 camPos, vec3 camDirection, mat4 projection, Bl
 	// Camera matrix - This one is locked to always be at 0, 0, 0 and ignore camera movement 
 	mat4 view = lookAt(
 		vec3(0, 0, 0), //locked position 
-		vec3(0, 0, 0) + camDirection,
-		up
+		vec3(0, 0, 0) + frame.camDirection,
+		frame.up
 	);//
 
 	// Send our uniforms variables to the currently bound shader,
-	glUniform1ui(bw->colourmodeID[1], bw->colourmode);
+	glUniform1ui(bw->colourmodeID[1], frame.colourmode);
 	glUniformMatrix4fv(bw->viewID[1], 1, GL_FALSE, &(view[0][0]));
 	glUniformMatrix4fv(bw->projectionID[1], 1, GL_FALSE, &(projection[0][0]));
 
@@ -561,7 +450,7 @@ void display_SkyBox(vec3 up, vec3 camPos, vec3 camDirection, mat4 projection, Bl
 		model.top() = translate(model.top(), vec3(0, 0, 0));
 		glUniformMatrix4fv(bw->modelID[1], 1, GL_FALSE, &(model.top()[0][0]));
 
-		bw->cube.drawCube(bw->drawmode);
+		bw->cube.drawCube(frame.drawmode);
 	}
 	model.pop();
 
@@ -569,24 +458,161 @@ void display_SkyBox(vec3 up, vec3 camPos, vec3 camDirection, mat4 projection, Bl
 }
 
 
-/* Called to update the display. Note that this function is called in the event loop in the wrapper
-   class because we registered display as a callback function */
-static void display(void* rawbw)
+/*
+	Switch to the governor's quality level
+*/
+static void applyQuality(BlockWorld* bw)
+{
+	const QualityLevel& quality = bw->governor.settings();
+	bw->chunkBudget = quality.chunkBudget;
+	bw->propDensity = quality.propDensity;
+	bw->msaaSamples = std::min(quality.msaaSamples, bw->msaaLimit);
+	if (quality.viewRadius != bw->viewRadius)
+	{
+		bw->viewRadius = quality.viewRadius;
+		placeMegaChunk(bw);
+	}
+}
+
+static void printMemory(BlockWorld* bw)
+{
+	MemoryTracker::print();
+	cout << "Chunk cache: " << bw->chunkCache.count() << " chunks resident, " << bw->chunkCache.residentBytes() / 1024 << " KB of "
+		<< bw->chunkCache.budgetBytes() / 1024 << " KB budget, " << bw->chunkCache.evictions << " evicted, "
+		<< bw->chunkCache.rescales << " rescaled to a new heightmod" << endl;
+}
+
+static BenchmarkCounters benchmarkCounters(BlockWorld* bw)
+{
+	BenchmarkCounters counters = { bw->chunkBuilds, bw->megaChunkMoves, bw->uploadBytes };
+	return counters;
+}
+
+/*
+	One fixed simulation tick: input state, automatic movement and benchmark playback. Nothing here may depend on
+	how long frames take, that's what makes movement the same at any frame rate
+*/
+static void simulate(BlockWorld* bw, bool benchmarkTick)
+{
+	bw->previousCamera = bw->currentCamera;
+
+	//Camera path playback takes over the camera and keys, so every run renders the same frames
+	if (benchmarkTick)
+	{
+		//Paths were recorded in the flat world, they're raised to the surface layer the camera starts over like it is
+		Benchmark* b = bw->benchmark;
+		vec3 position = b->position + vec3(0.0f, bw->startHeight, 0.0f);
+		bw->currentCamera.position = position;
+		bw->currentCamera.horizontal = b->horizontal;
+		bw->currentCamera.vertical = b->vertical;
+		GLOBAL_cam_x = position.x;
+		GLOBAL_cam_y = position.y;
+		GLOBAL_cam_z = position.z;
+		GLOBAL_horizontalCam = b->horizontal;
+		GLOBAL_verticalCam = b->vertical;
+		for (size_t i = 0; i < b->keys.size(); i++)
+		{
+			keyCallback(bw->glw->getWindow(), toupper(b->keys[i]), 0, GLFW_PRESS, 0);
+			keyCallback(bw->glw->getWindow(), toupper(b->keys[i]), 0, GLFW_RELEASE, 0);
+		}
+	}
+	else
+	{
+		bw->currentCamera.horizontal = GLOBAL_horizontalCam;
+		bw->currentCamera.vertical = GLOBAL_verticalCam;
+		bw->currentCamera.position.x = GLOBAL_cam_x;
+		bw->currentCamera.position.y = GLOBAL_cam_y;
+		bw->currentCamera.position.z += GLOBAL_automove; //automove is per tick, 60 ticks a second
+	}
+
+	bw->heightmod = GLOBAL_heightmod;
+	bw->colourmode = GLOBAL_colourmode;
+	bw->drawmode = GLOBAL_drawmode;
+}
+
+/*
+	Simulation half of a frame, on the main thread: spend the real time since the last frame on fixed ticks, follow the
+	camera with the visible chunks and apply the governor, then publish what the renderer needs as a snapshot.
+	Called by the event loop before render(), or while the render thread draws the previous frame
+*/
+static void update(void* rawbw)
 {
+	PROFILE_SCOPE("update");
 	BlockWorld* bw = static_cast<BlockWorld*>(rawbw);
-	//glfwSetTime(0);
-	
-	/* Define the background colour */
-	glClearColor(102.0f/255.0f, 153.0f/255.0f, 255.0f/255.0f, 1.0f);
 
-	/* Clear the colour and frame buffers */
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	//Once warmed up, nothing in a frame may touch the heap (--alloc-check)
+	bool loaded = bw->assetsLoaded;
+	bool checkAllocations = bw->allocCheckWarmup >= 0 && bw->loadedFrames > (uint64_t)bw->allocCheckWarmup;
+	NoAllocationScope noAllocations(checkAllocations);
+	if (loaded)
+	{
+		bw->loadedFrames++;
+	}
+
+	//Benchmarks play back once loading is done, one tick per frame (the clock is in lockstep)
+	bool benchmarkFrame = bw->benchmark && loaded;
+	if (benchmarkFrame && !bw->benchmark->beginFrame(benchmarkCounters(bw)))
+	{
+		bw->glw->stop();
+		return;
+	}
+
+	//Spend the real time since the last frame on fixed simulation ticks
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	double frameSeconds = bw->simulationStarted ? chrono::duration<double>(now - bw->lastFrameTime).count() : 0.0;
+	bw->lastFrameTime = now;
+	bw->simulationStarted = true;
+
+	int ticks = bw->simulation.advance(frameSeconds);
+	for (int i = 0; i < ticks; i++)
+	{
+		simulate(bw, benchmarkFrame);
+	}
+
+	//Quality for this frame from what the last one drawn cost
+	double costMs = bw->frameCostMs.exchange(-1.0);
+	if (loaded && costMs >= 0.0 && bw->governor.update(costMs))
+	{
+		applyQuality(bw);
+	}
+
+	//Render the camera between the last two ticks
+	float alpha = (float)bw->simulation.alpha();
+	vec3 renderPosition = mix(bw->previousCamera.position, bw->currentCamera.position, alpha);
+	bw->cam_x = renderPosition.x;
+	bw->cam_y = renderPosition.y;
+	bw->cam_z = renderPosition.z;
+	bw->horizontalCam = mix(bw->previousCamera.horizontal, bw->currentCamera.horizontal, (double)alpha);
+	bw->verticalCam = mix(bw->previousCamera.vertical, bw->currentCamera.vertical, (double)alpha);
+
+	//Check if camera position is approaching megachunks bounds, if so- then regenerate for the new camera position
+	//X Bounds
+	if (bw->cam_x > bw->chunkOrigin.x + 16)
+	{
+		generateMegaChunk(false, glm::vec3(16, 0, 0), bw);
+	}
+	else if (bw->cam_x < bw->chunkOrigin.x)
+	{
+		generateMegaChunk(false, glm::vec3(-16, 0, 0), bw);
+	}
+	//Z Bounds
+	if (bw->cam_z > bw->chunkOrigin.z + 16)
+	{
+		generateMegaChunk(false, glm::vec3(0, 0, 16), bw);
+	}
+	else if (bw->cam_z < bw->chunkOrigin.z - 16)
+	{
+		generateMegaChunk(false, glm::vec3(0, 0, -16), bw);
+	}
+
+	FrameSnapshot& frame = bw->snapshots.back();
+	frame.frame = bw->framesPublished++;
 
 	//Create vec3 from camera position components 
-	vec3 camPos = vec3(bw->cam_x, bw->cam_y, bw->cam_z);
+	frame.camPos = vec3(bw->cam_x, bw->cam_y, bw->cam_z);
 
 	//Camera Direction
-	vec3 camDirection = vec3(cos(bw->verticalCam) * sin(bw->horizontalCam), sin(bw->verticalCam), cos(bw->verticalCam) * cos(bw->horizontalCam));
+	frame.camDirection = vec3(cos(bw->verticalCam) * sin(bw->horizontalCam), sin(bw->verticalCam), cos(bw->verticalCam) * cos(bw->horizontalCam));
 
 	//Used to calculate the correct Head up position
 	vec3 right = vec3(
@@ -596,50 +622,181 @@ static void display(void* rawbw)
 	);
 
 	//Get which way is up 
-	vec3 up = glm::cross(right, camDirection);
+	frame.up = glm::cross(right, frame.camDirection);
 
 	// Camera matrix
-	mat4 view = lookAt(
-		camPos,
-		camPos + camDirection,
-		up
+	frame.view = lookAt(
+		frame.camPos,
+		frame.camPos + frame.camDirection,
+		frame.up
 	);
 
 	//Used to calculate light 
-	mat4 lightview = lookAt(
+	frame.lightview = lookAt(
 		vec3(20, GLOBAL_LightMode, GLOBAL_LightMode),
 		vec3(1, 0, 1),
 		vec3(1, 1, 1)
 	);
 
-	bw->horizontalCam = GLOBAL_horizontalCam;
-	bw->verticalCam = GLOBAL_verticalCam;
-	bw->cam_x = GLOBAL_cam_x;
-	bw->cam_y = GLOBAL_cam_y;
-	bw->cam_z += GLOBAL_automove;
+	frame.visibleChunks = bw->visibleChunks;
+	for (int i = 0; i < bw->visibleChunks; i++)
+	{
+		frame.chunks[i] = bw->megaChunk[i];
+	}
+
+	frame.heightmod = bw->heightmod;
+	frame.colourmode = bw->colourmode;
+	frame.drawmode = bw->drawmode;
+	frame.chunkBudget = bw->chunkBudget;
+	frame.propDensity = bw->propDensity;
+	frame.msaaSamples = bw->msaaSamples;
+	bw->glw->getFramebufferSize(&frame.width, &frame.height);
+	//Edits are picked by a ray from the camera, in block space. The terrain's model matrix doubles its size but the
+	//shader halves the block positions, so it's world space less the doubled terrain translation
+	frame.editCount = (int)GLOBAL_editRequests.size();
+	for (int i = 0; i < frame.editCount; i++)
+	{
+		frame.edits[i] = GLOBAL_editRequests[i];
+		frame.edits[i].origin = frame.camPos - 2.0f * vec3(bw->x, bw->y, bw->z);
+		frame.edits[i].direction = frame.camDirection;
+	}
+	GLOBAL_editRequests.clear();
+
+	frame.printMemory = GLOBAL_printMemory;
+	frame.printGpuTimes = GLOBAL_printGpuTimes;
+	frame.checkAllocations = checkAllocations;
+	GLOBAL_printMemory = false;
+	GLOBAL_printGpuTimes = false;
+
 	GLOBAL_cam_x_mod = bw->cam_x_mod;
 	GLOBAL_cam_y_mod = bw->cam_y_mod;
 	GLOBAL_cam_z_mod = bw->cam_z_mod;
-	bw->heightmod = GLOBAL_heightmod;
-	bw->colourmode = GLOBAL_colourmode;
-	bw->drawmode = GLOBAL_drawmode;
+
+	//Which way the camera is looking becomes the vector towards which the camera moves forward
+	bw->cam_x_mod = frame.camDirection.x;
+	bw->cam_y_mod = frame.camDirection.y;
+	bw->cam_z_mod = frame.camDirection.z;
+
+	//Waits while the renderer is still to pick up the previous frame
+	bw->snapshots.publish();
+}
+
+/*
+	Render half of a frame, on whichever thread has the GL context: draw the latest snapshot. With wait it blocks until
+	update() publishes one, false once there are no more
+*/
+static bool render(BlockWorld* bw, bool wait)
+{
+	if (!bw->snapshots.acquire(wait))
+	{
+		return false;
+	}
+	const FrameSnapshot& frame = bw->snapshots.front();
+
+	PROFILE_SCOPE("render");
+	chrono::steady_clock::time_point frameStart = chrono::steady_clock::now();
+	//glfwSetTime(0);
+
+	//Last frame's scratch memory is free again
+	bw->frameMemory.reset();
+
+	NoAllocationScope noAllocations(frame.checkAllocations);
+
+	//Reads back pass times from a few frames ago
+	GpuTimer::beginFrame();
+
+	//Upload whatever the loader threads have finished since the last frame
+	if (!bw->assetsLoaded)
+	{
+		bw->loader->pump();
+		if (bw->loader->idle())
+		{
+			bw->assetsLoaded = true;
+			cout << "All assets loaded after " << chrono::duration<double, milli>(chrono::steady_clock::now() - bw->startTime).count() << " ms" << endl;
+		}
+	}
+
+	//Draw into the multisampled target, it's resolved to the window at the end of the frame
+	bw->msaa.begin(frame.width, frame.height, frame.msaaSamples);
+	
+	/* Define the background colour */
+	glClearColor(102.0f/255.0f, 153.0f/255.0f, 255.0f/255.0f, 1.0f);
+
+	/* Clear the colour and frame buffers */
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	//Call display subfunctions that render each part of the scene with different shader programs and other variations
 
-	display_SkyBox(up, camPos, camDirection, bw->projection, bw);
+	GpuTimer::begin(GPU_PASS_SKYBOX);
+	display_SkyBox(frame, bw->projection, bw);
+	GpuTimer::end();
+
 
+	display_Terrain(frame, bw->projection, bw);
 
-	display_Terrain(view, lightview, camPos, camDirection, bw->projection, bw);
+	bw->msaa.resolve();
+	bw->editor.frameDrawn();
 
 	// Disable everything
 	//glBindTexture(GL_TEXTURE_2D, 0);
 	//glDisableVertexAttribArray(0);
 	//glUseProgram(0); 
 
-	//Which way the camera is looking becomes the vector towards which the camera moves forward
-	bw->cam_x_mod = camDirection.x;
-	bw->cam_y_mod = camDirection.y;
-	bw->cam_z_mod = camDirection.z;
+	if (!bw->firstFrameShown)
+	{
+		bw->firstFrameShown = true;
+		cout << "First frame after " << chrono::duration<double, milli>(chrono::steady_clock::now() - bw->startTime).count() << " ms" << endl;
+	}
+
+	MemoryTracker::recordCounters();
+	if (frame.printMemory)
+	{
+		printMemory(bw);
+	}
+	if (frame.printGpuTimes)
+	{
+		GpuTimer::printStats();
+	}
+
+	bw->chunkBuilds = bw->chunkblock.builds;
+	bw->uploadBytes = bw->chunkblock.uploadedBytes;
+
+	//What the frame cost for the governor: its CPU time or, when the GPU can be timed and took longer, the GPU time of
+	//its passes (from a few frames ago). Without GPU times it's the whole frame interval, waiting for vsync included
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	double frameMs = chrono::duration<double, milli>(now - bw->lastRenderTime).count();
+	bw->lastRenderTime = now;
+	if (GpuTimer::supported())
+	{
+		const GpuPassTimes& gpu = GpuTimer::latest();
+		double gpuMs = 0.0;
+		for (int i = 0; i < NUM_GPU_PASSES; i++)
+		{
+			gpuMs += gpu.gpuMs[i];
+		}
+		frameMs = std::max(chrono::duration<double, milli>(now - frameStart).count(), gpuMs);
+	}
+	bw->frameCostMs = frameMs;
+	return true;
+}
+
+/* Called to update the display. Note that this function is called in the event loop in the wrapper
+   class because we registered display as a callback function */
+static void display(void* rawbw)
+{
+	render(static_cast<BlockWorld*>(rawbw), false);
+}
+
+/* The same on the render thread, it waits for each frame update() publishes */
+static bool displayThread(void* rawbw)
+{
+	return render(static_cast<BlockWorld*>(rawbw), true);
+}
+
+/* The loop has ended, a render thread waiting for another frame stops once it has drawn what's published */
+static void stopRendering(void* rawbw)
+{
+	static_cast<BlockWorld*>(rawbw)->snapshots.close();
 }
 
 /*
@@ -731,24 +888,232 @@ static void keyCallback(GLFWwindow* window, int key, int s, int action, int mods
 		}
 	}
 
+	/* Remove the block the camera is looking at, or place one against it */
+	if ((key == 'R' || key == 'F') && action == GLFW_PRESS && GLOBAL_editRequests.size() < GLOBAL_editRequests.capacity())
+	{
+		BlockEditRequest request;
+		request.type = key == 'R' ? EDIT_REMOVE : EDIT_PLACE;
+		request.requested = chrono::steady_clock::now();
+		GLOBAL_editRequests.push_back(request);
+	}
+
+	/* Live GPU/CPU memory by category and the chunk cache */
+	if (key == 'U' && action == GLFW_PRESS)
+	{
+		GLOBAL_printMemory = true;
+	}
+
+	/* Start recording profile scopes, the second press writes everything recorded as a trace */
+	if (key == 'T' && action == GLFW_PRESS)
+	{
+		if (Profiler::enabled())
+		{
+			Profiler::setEnabled(false);
+			Profiler::writeTrace(GLOBAL_tracePath);
+			GLOBAL_printGpuTimes = true;
+		}
+		else
+		{
+			Profiler::setEnabled(true);
+			cout << "Profiling, press T again to write " << GLOBAL_tracePath << endl;
+		}
+	}
+
 }
 
 /* Entry point of program */
+/*
+	Native builds accept:
+	--headless            render offscreen with EGL (works on Mesa llvmpipe with no GPU or display), runs 600 frames by default
+	--null-renderer       run the frame logic with every GL call counted and discarded (CPU-only cost of a frame), 5000 frames by default
+	--frames <n>          stop after n frames
+	--screenshot <file>   save the last frame as a PPM image
+	--profile [file]      record profile scopes from the start and write them as a Chrome trace on exit (BlockWorld.trace.json)
+	--benchmark <file>    play back a camera path at a fixed timestep and report frame time percentiles (Benchmark.h)
+	--benchmark-out <file> where the benchmark JSON report is written (benchmark.json)
+	--timestep <ms>       simulated time per benchmark frame (16.667)
+	--quality <level>     fixed quality level, 0 (lowest) to 9 (QualityGovernor.h), 6 by default
+	--governor            adjust the quality level to hold the frame time target, on by default in a window
+	--target-ms <ms>      frame time the governor aims for (16.667)
+	--msaa <samples>      most MSAA samples any quality level uses, 8 in a window and 0 headless (it always rendered without)
+	--chunk-memory <MB>   memory chunks may keep resident before the least recently drawn are evicted (8)
+	--alloc-check [n]     report every heap allocation made by a frame, starting n frames after loading (60), fails if any
+	--no-render-thread    simulate and render each frame in turn on the main thread, as the web build does
+	--world <dir>         save chunks to region files in dir and load them from there instead of generating them again
+	--world-edits         with --world, only save the blocks changed from the generated terrain (RegionStore.h)
+	--world-height <n>    chunk layers the terrain surface can be in, 1 (flat) to 64 (ChunkBlock.h)
+	--noise <name>        terrain noise, perlin (the default) or simplex (ChunkBlock.h)
+*/
 int main(int argc, char* argv[])
 {
 	cout << "[Program Starting!]" << endl;
+
+	RenderMode mode = RENDER_WINDOW;
+	int frames = 0;
+	const char* screenshot = NULL;
+	bool profile = false;
+	const char* benchmarkPath = NULL;
+	const char* benchmarkOut = "benchmark.json";
+	double timestep = 1.0 / 60.0;
+	int quality = -1;
+	int governor = -1;
+	double targetMs = 1000.0 / 60.0;
+	int msaa = -1;
+	double chunkMemory = CHUNK_MEMORY_BUDGET_MB;
+	int allocCheck = -1;
+	bool renderThread = true;
+	const char* world = NULL;
+	RegionMode worldMode = REGION_WHOLE_CHUNKS;
+	int worldLayers = 1;
+	NoiseBackend noise = NOISE_PERLIN;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--headless") == 0) mode = RENDER_HEADLESS;
+		else if (strcmp(argv[i], "--null-renderer") == 0) mode = RENDER_NULL;
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--screenshot") == 0 && i + 1 < argc) screenshot = argv[++i];
+		else if (strcmp(argv[i], "--benchmark") == 0 && i + 1 < argc) benchmarkPath = argv[++i];
+		else if (strcmp(argv[i], "--benchmark-out") == 0 && i + 1 < argc) benchmarkOut = argv[++i];
+		else if (strcmp(argv[i], "--timestep") == 0 && i + 1 < argc) timestep = atof(argv[++i]) / 1000.0;
+		else if (strcmp(argv[i], "--quality") == 0 && i + 1 < argc) { quality = atoi(argv[++i]); governor = 0; }
+		else if (strcmp(argv[i], "--governor") == 0) governor = 1;
+		else if (strcmp(argv[i], "--target-ms") == 0 && i + 1 < argc) targetMs = atof(argv[++i]);
+		else if (strcmp(argv[i], "--msaa") == 0 && i + 1 < argc) msaa = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--chunk-memory") == 0 && i + 1 < argc) chunkMemory = atof(argv[++i]);
+		else if (strcmp(argv[i], "--no-render-thread") == 0) renderThread = false;
+		else if (strcmp(argv[i], "--world") == 0 && i + 1 < argc) world = argv[++i];
+		else if (strcmp(argv[i], "--world-edits") == 0) worldMode = REGION_EDITS;
+		else if (strcmp(argv[i], "--world-height") == 0 && i + 1 < argc) worldLayers = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--noise") == 0 && i + 1 < argc)
+		{
+			const char* name = argv[++i];
+			if (strcmp(name, "simplex") == 0) noise = NOISE_SIMPLEX;
+			else if (strcmp(name, "perlin") != 0) cout << "Unknown noise " << name << ", using perlin" << endl;
+		}
+		else if (strcmp(argv[i], "--alloc-check") == 0)
+		{
+			allocCheck = ALLOC_CHECK_WARMUP_FRAMES;
+			if (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0) allocCheck = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--profile") == 0)
+		{
+			profile = true;
+			if (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0) GLOBAL_tracePath = argv[++i];
+		}
+		else cout << "Unknown argument " << argv[i] << endl;
+	}
+
+	//Nothing can close a headless or null run, so they always end (a benchmark stops at the end of its path)
+	if (mode != RENDER_WINDOW && frames == 0 && !benchmarkPath)
+	{
+		frames = mode == RENDER_NULL ? 5000 : 600;
+	}
+
+	//All assets are read from the pack when one is available, otherwise from loose files in the working directory
+	if (!AssetPack::instance().open("BlockWorld.pack"))
+	{
+		cout << "No asset pack found, reading loose asset files" << endl;
+	}
+
+	Profiler::setThreadName("main");
+	Profiler::setEnabled(profile);
+
 	BlockWorld* bw = new BlockWorld();
-	GLWrapper* glw = new GLWrapper(1024, 768, "BlockWorld", (void*)bw);
+	GLWrapper* glw = new GLWrapper(1024, 768, "BlockWorld", (void*)bw, mode);
+	glw->setFrameLimit(frames);
 
 	//glw->setMouseCallback(mouseCallback);
+	glw->setUpdater(update);
 	glw->setRenderer(display);
+	if (renderThread)
+	{
+		glw->setRenderThread(displayThread, stopRendering);
+	}
 	glw->setKeyCallback(keyCallback);
 	//glw->setReshapeCallback(reshape);
 
+	//The visible chunks are laid out by init
+	bw->chunkblock.layers = std::min(std::max(worldLayers, 1), MAX_WORLD_LAYERS);
+	bw->chunkblock.backend = noise;
 	init(glw, bw);
 
+	if (benchmarkPath)
+	{
+		bw->benchmark = new Benchmark(benchmarkPath, timestep);
+		if (timestep <= 0.0 || !bw->benchmark->load())
+		{
+			exit(EXIT_FAILURE);
+		}
+		GLOBAL_automove = 0;
+		bw->simulation.setTickSeconds(timestep);
+		bw->simulation.setLockstep(true);
+	}
+
+	//Headless, null and benchmark runs keep a fixed quality unless asked, so their results stay comparable
+	if (quality >= 0)
+	{
+		bw->governor.setLevel(quality);
+	}
+	if (msaa >= 0 || mode == RENDER_HEADLESS)
+	{
+		bw->msaaLimit = msaa >= 0 ? msaa : 0;
+	}
+	bw->chunkCache.setBudget((size_t)(chunkMemory * 1024 * 1024));
+	if (world && bw->regions.open(world, bw->chunkblock.size, worldMode))
+	{
+		bw->chunkCache.setStore(&bw->regions);
+	}
+	bw->governor.setTarget(targetMs);
+	bw->governor.setEnabled(governor == 1 || (governor < 0 && mode == RENDER_WINDOW && !benchmarkPath));
+	applyQuality(bw);
+	bw->allocCheckWarmup = allocCheck;
+
 	glw->eventLoop();
 
+	//Chunks still resident haven't been saved yet
+	bw->chunkCache.flush();
+	bw->regions.close();
+	bw->regions.printStats();
+
+	bw->simulation.printStats();
+	bw->governor.printStats();
+	bw->editor.printStats();
+	printMemory(bw);
+
+	if (bw->benchmark)
+	{
+		bw->benchmark->editLatencyMs = bw->editor.latencyMs;
+		const char* modeNames[] = { "window", "headless", "null" };
+		bw->benchmark->finish(benchmarkCounters(bw), benchmarkOut, modeNames[mode]);
+	}
+
+	//Only reached on native builds, the web event loop never returns
+	if (screenshot)
+	{
+		glw->saveScreenshot(screenshot);
+	}
+
+	if (Profiler::enabled())
+	{
+		Profiler::writeTrace(GLOBAL_tracePath);
+	}
+
+	cout << "Frame memory: " << bw->frameMemory.highWater << " of " << bw->frameMemory.capacity() << " bytes used at most";
+	if (bw->frameMemory.overflows)
+	{
+		cout << ", " << bw->frameMemory.overflows << " allocations overflowed to the heap";
+	}
+	cout << endl;
+
+	if (allocCheck >= 0)
+	{
+		uint64_t checked = bw->loadedFrames > (uint64_t)allocCheck ? bw->loadedFrames - allocCheck : 0;
+		cout << "Allocation check: " << forbiddenAllocations() << " heap allocations in " << checked << " frames" << endl;
+		if (forbiddenAllocations() > 0 || checked == 0)
+		{
+			return EXIT_FAILURE;
+		}
+	}
 
 	//delete(glw);
 	//delete(bw)
@@ -3,9 +3,84 @@
 #include "ChunkBlock.h"
 #include "cube_tex.h"
 #include "ModelLoader/tiny_loader_texture.h"
+#include "AssetLoader.h"
+#include "Benchmark.h"
+#include "FixedTimestep.h"
+#include "ChunkCache.h"
+#include "MultisampleTarget.h"
+#include "QualityGovernor.h"
+#include "FrameAllocator.h"
+#include "TripleBuffer.h"
+#include "RegionStore.h"
+#include "BlockEditor.h"
 #include <vector>
+#include <chrono>
+#include <atomic>
 
 
+//Chunks drawn around the camera are (2 * viewRadius + 1)^2, viewRadius is set by the quality level
+const int MAX_VIEW_RADIUS = 2;
+const int MAX_VISIBLE_CHUNKS = (2 * MAX_VIEW_RADIUS + 1) * (2 * MAX_VIEW_RADIUS + 1);
+
+//Memory chunks may keep resident (--chunk-memory), about 100 16^3 chunks. Chunks left behind stay until it's full,
+//so moving back and forth doesn't regenerate them
+const int CHUNK_MEMORY_BUDGET_MB = 8;
+
+//Per-frame scratch memory, a frame at the highest quality uses about 2 KB of it
+const size_t FRAME_MEMORY_BYTES = 64 * 1024;
+
+//Model transformations pushed at once while drawing a part of the scene
+const int MATRIX_STACK_DEPTH = 4;
+
+//Frames after loading before --alloc-check starts, caches and buffers grow to their working size in these
+const int ALLOC_CHECK_WARMUP_FRAMES = 60;
+
+//Camera as simulated at one tick, rendering interpolates between two of these
+struct CameraState
+{
+    glm::vec3 position;
+    double horizontal;
+    double vertical;
+};
+
+//Everything the renderer needs from the simulation to draw one frame. The main thread fills one in and publishes it,
+//the render thread only reads it, so neither touches what the other is working on
+struct FrameSnapshot
+{
+    uint64_t frame;
+
+    //Camera interpolated between the last two ticks
+    glm::vec3 camPos;
+    glm::vec3 camDirection;
+    glm::vec3 up;
+    glm::mat4 view;
+    glm::mat4 lightview;
+
+    //Chunks to draw, nearest first
+    glm::vec3 chunks[MAX_VISIBLE_CHUNKS];
+    int visibleChunks;
+
+    //Settings from input and the quality level
+    int heightmod;
+    int colourmode;
+    GLuint drawmode;
+    int chunkBudget;
+    int propDensity;
+    int msaaSamples;
+
+    //Framebuffer size, GLFW only allows it to be read on the main thread
+    int width;
+    int height;
+
+    //Blocks removed (R) and placed (F) since the last frame
+    BlockEditRequest edits[MAX_EDITS_PER_FRAME];
+    int editCount;
+
+    bool printMemory; //U was pressed
+    bool printGpuTimes; //T stopped profiling, the render thread owns GpuTimer's totals
+    bool checkAllocations; //The frame mustn't allocate (--alloc-check)
+};
+
 class BlockWorld {
 public:
     BlockWorld();
@@ -27,10 +102,17 @@ public:
     GLfloat cam_x;
     GLfloat cam_y;
     GLfloat cam_z;
+    GLfloat startHeight; //Camera height at the start, above the surface layer there. Benchmark paths are relative to it
 
     //Perlin Settings controllable by user 
     int heightmod; //height of terrain
 
+    //Fixed rate simulation, the camera above is what's rendered: interpolated between the last two ticks
+    FixedTimestep simulation;
+    CameraState previousCamera, currentCamera;
+    std::chrono::steady_clock::time_point lastFrameTime;
+    bool simulationStarted;
+
     //Camera Position Incrementals 
     GLfloat cam_x_mod;
     GLfloat cam_y_mod;
@@ -40,21 +122,62 @@ public:
     GLuint modelID[numOfPrograms], viewID[numOfPrograms], projectionID[numOfPrograms];
     int colourmodeID[numOfPrograms];
     GLuint lightviewID[2];
+    GLuint heightmodID;			// Terrain only, see program_v_0.vert
     GLuint drawmode;			// Defines drawing mode as points, lines or filled polygons
     GLfloat aspect_ratio;		/* Aspect ratio of the window defined in the reshape callback*/
     GLuint normalMatrixID;
 
     //Texture IDs
-    GLuint AtlasID, GrassTextureID, SkyTextureID;
+    GLuint AtlasID, BlockTextureID, SkyTextureID;
 
     //Tree Models to render and skybox cube
     TinyObjLoader tree1, tree2;
     Cube cube;
 
-    ChunkBlock chunkblock; //Single 16x16x16 Chunk Block
-    glm::vec3 megaChunk[9]; //Positions of all visible Chunks around a player
+    //Background texture/model loading and startup timings
+    AssetLoader* loader;
+    std::chrono::steady_clock::time_point startTime;
+    bool firstFrameShown;
+    std::atomic<bool> assetsLoaded; //Set by the renderer, read by the simulation
+
+    //Frames from the simulation (main thread) to the renderer, which may be on its own thread
+    TripleBuffer<FrameSnapshot> snapshots;
+    uint64_t framesPublished;
+
+    //Renderer results the simulation reads: the cost of the last frame drawn for the governor (-1 once it's been
+    //used) and the chunk work for benchmark reports
+    std::atomic<double> frameCostMs;
+    std::atomic<uint64_t> chunkBuilds;
+    std::atomic<uint64_t> uploadBytes;
+    std::chrono::steady_clock::time_point lastRenderTime;
+
+    //Camera path playback (--benchmark), NULL otherwise
+    Benchmark* benchmark;
+    GLWrapper* glw;
+    uint64_t megaChunkMoves; //Times generateMegaChunk moved the visible chunks
+
+    ChunkBlock chunkblock; //Single 16x16x16 Chunk Block, generates the instance data of every chunk
+    ChunkCache chunkCache; //Instance data of the resident chunks
+    RegionStore regions; //Chunks saved to disk with --world
+    BlockEditor editor; //Makes the edits in snapshots to the chunk cache, on the renderer
+    glm::vec3 megaChunk[MAX_VISIBLE_CHUNKS]; //Positions of all visible Chunks around a player, nearest first
+    int visibleChunks;
     glm::vec3 chunkOrigin; //Origin Point of first chunk where player starts
 
+    //Quality settings, changed by the governor to hold the frame time target
+    QualityGovernor governor;
+    int viewRadius;
+    int chunkBudget; //Chunks that may be generated per frame
+    int propDensity; //Trees per chunk
+    int msaaSamples;
+    int msaaLimit; //Most samples any quality level may use (--msaa)
+    MultisampleTarget msaa;
+
+    //Scratch memory for the current frame, reset when the next one starts
+    FrameAllocator frameMemory;
+    int allocCheckWarmup; //Frames to skip before frames must not allocate (--alloc-check), -1 when not checking
+    uint64_t loadedFrames; //Frames drawn since every asset finished loading
+
     // Define the normal matrix used by Trees lightning
     glm::mat3 normalmatrix;
 
@@ -66,4 +189,10 @@ public:
     vec3 up;
 
 
-};
\ No newline at end of file
+};
+
+//Place the visible chunks around the camera (origin) or move them all one step towards direction, World.cpp
+void generateMegaChunk(bool origin, glm::vec3 direction, BlockWorld *bw);
+
+//Lay out the visible chunks around chunkOrigin for the current viewRadius
+void placeMegaChunk(BlockWorld *bw);
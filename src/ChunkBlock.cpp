@@ -7,6 +7,11 @@
 
 #include "ChunkBlock.h"
 #include "PerlinNoise.hpp"
+#include "Profiler.h"
+#include "MemoryTracker.h"
+#include <cstddef>
+#include <algorithm>
+#include <cmath>
  
 
 /*
@@ -15,24 +20,36 @@
 ChunkBlock::ChunkBlock()
 {
 	/*
-		Can increase for bigger world (Heavy effect on fps) or decrease it to a minimum of 13.
-		Tree generation is also optimized to 16 and may not always render on the correct y axis with different values 
+		Can increase for bigger world (Heavy effect on fps) or decrease it. Tree slots are scaled with it, and
+		generation is fastest at 16 and 32 which have loops compiled for them (CHUNK_SIZE_ANY)
 	*/
 	size = 16; 
+	layers = 1;
+	backend = NOISE_PERLIN;
+	specialised = true;
 
 	attribute_v_coord = 0;
 	attribute_v_colours = 1;
 	attribute_v_normal = 2;
 	attribute_v_instance = 3;
+	attribute_v_facelayers = 4;
+	attribute_v_lift = 5;
 
 	positionBufferObject = 0;//
 	colourObject = 0;
 	normalsBufferObject = 0;
 	texCoordsObject = 0;
-	instanceData = 0;
 
 	drawmode = 0;
 
+	builds = 0;
+	uploadedBytes = 0;
+
+	//Room for the columns of the largest chunks benchmarked, so they're never allocated mid-frame
+	columns.reserve(32 * 32);
+	noiseRow.reserve(32);
+	columnsSize = 0;
+
 	//Single Small Cube 
 	numvertices = 12;
 
@@ -191,25 +208,300 @@ void ChunkBlock::makeChunkBlock()
 	glBufferData(GL_ARRAY_BUFFER, 36 * sizeof(glm::vec3), normals, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-	glGenBuffers(1, &instanceData);
-	//Add to buffer later when building instance data
+	MemoryTracker::buffer(positionBufferObject, MEMORY_TERRAIN, sizeof(vertexPositions));
+	MemoryTracker::buffer(colourObject, MEMORY_TERRAIN, sizeof(vertexColours));
+	MemoryTracker::buffer(normalsBufferObject, MEMORY_TERRAIN, 36 * sizeof(glm::vec3));
 
+	//Instance data lives in a buffer per chunk, see ChunkCache
+}
+
+int ChunkBlock::surfaceLayer(float x, float z) const
+{
+	if (layers <= 1)
+	{
+		return 0;
+	}
+
+	//Stretched with the world height so the surface still only changes a layer every SURFACE_LAYER_SCALE chunks
+	double scale = size * SURFACE_LAYER_SCALE * (layers - 1);
+	double height = backend == NOISE_SIMPLEX ? simplex.octave2D_01(x / scale, z / scale, 1) : perlin.octave2D_01(x / scale, z / scale, 1);
+	int layer = (int)(height * layers);
+	return std::min(std::max(layer, 0), layers - 1);
+}
+
+ChunkFill ChunkBlock::chunkFill(glm::vec3 position) const
+{
+	int layer = (int)floor((position.y - WORLD_BASE_Y) / size + 0.5f);
+	int surface = surfaceLayer(position.x, position.z);
+	if (layer > surface)
+	{
+		return CHUNK_AIR;
+	}
+	return layer < surface ? CHUNK_SOLID : CHUNK_SURFACE;
 }
 
 //Get the positions of a single small block in a chunk 
 glm::vec3 ChunkBlock::getTranslations(int i)
 {
-	return translations[i];
+	return translations[i].position;
+}
+
+glm::vec3 ChunkBlock::getPropPosition(int slot)
+{
+	return props[slot];
 }
 
 /*
-	Create the positions of each small cube that will build the chunk and apply perlin noise 
+	Create the positions of each small cube that will build the chunk and apply perlin noise, then upload them to instanceData
 */
-void ChunkBlock::buildInstanceData(glm::vec3 position, int heightmod)
+void ChunkBlock::buildInstanceData(glm::vec3 position, int heightmod, GLuint instanceData)
 {
-	GLint blockCount = size * size * size;
-	
-	translations.clear();
+	PROFILE_SCOPE("buildInstanceData");
+
+	generateInstances(position, heightmod);
+	uploadInstances(instanceData);
+	builds++;
+}
+
+void ChunkBlock::buildInstanceData(glm::vec3 position, int heightmod, GLuint instanceData, int8_t* offsets, int8_t* noise, const ChunkEdit* edits, size_t editCount)
+{
+	PROFILE_SCOPE("buildInstanceData");
+
+	generateNoise(position, noise);
+	for (size_t i = 0; i < editCount; i++)
+	{
+		noise[edits[i].index] = NOISE_EDITED;
+		offsets[edits[i].index] = edits[i].offset;
+	}
+	applyHeightmod(position, noise, heightmod, offsets);
+	buildInstances(position, offsets, noise);
+	uploadInstances(instanceData);
+	builds++;
+}
+
+void ChunkBlock::rebuildInstanceData(glm::vec3 position, int heightmod, GLuint instanceData, int8_t* offsets, int8_t* noise, int storedHeightmod)
+{
+	PROFILE_SCOPE("buildInstanceData");
+
+	generateNoise(position, noise);
+	sampleColumns(position);
+	for (int i = 0; i < size; i++)
+	{
+		for (int j = 0; j < size; j++)
+		{
+			for (int k = 0; k < size; k++)
+			{
+				const int index = blockIndex(i, j, k);
+				const ColumnBiome& column = columns[i * size + k];
+				if (offsets[index] != blockOffset(column.base, blockShape(column, noise[index]), storedHeightmod))
+				{
+					noise[index] = NOISE_EDITED;
+				}
+			}
+		}
+	}
+	applyHeightmod(position, noise, heightmod, offsets);
+	buildInstances(position, offsets, noise);
+	uploadInstances(instanceData);
+	builds++;
+}
+
+void ChunkBlock::uploadInstances(GLuint instanceData)
+{
+	//Fewer than size^3 when blocks were removed
+	size_t bytes = sizeof(BlockInstance) * translations.size();
+
+	//Bind Instance data generated 
+	glBindBuffer(GL_ARRAY_BUFFER, instanceData);
+	glBufferData(GL_ARRAY_BUFFER, bytes, translations.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	MemoryTracker::buffer(instanceData, MEMORY_TERRAIN, bytes);
+
+	uploadedBytes += bytes;
+}
+
+/*
+	CPU half of buildInstanceData, fills translations without touching GL (benchmarks run it without a context)
+*/
+void ChunkBlock::generateInstances(glm::vec3 position, int heightmod)
+{
+	size_t capacity = offsets.capacity() + noise.capacity();
+	offsets.resize(size * size * size);
+	noise.resize(size * size * size);
+	generateNoise(position, noise.data());
+	applyHeightmod(position, noise.data(), heightmod, offsets.data());
+	buildInstances(position, offsets.data(), noise.data());
+
+	//Scratch space shared by every chunk, it only grows with the chunk size
+	MemoryTracker::cpu(MEMORY_TERRAIN, (int64_t)(offsets.capacity() + noise.capacity() - capacity));
+}
+
+void ChunkBlock::sampleColumns(glm::vec3 position)
+{
+	if (columnsSize == size && columnsPosition.x == position.x && columnsPosition.z == position.z)
+	{
+		return;
+	}
+
+	columns.resize(size * size);
+	for (int i = 0; i < size; i++)
+	{
+		for (int k = 0; k < size; k++)
+		{
+			columns[i * size + k] = climate.column(i + position.x, k + position.z);
+		}
+	}
+	columnsPosition = position;
+	columnsSize = size;
+}
+
+void ChunkBlock::generateOffsets(glm::vec3 position, int heightmod, int8_t* offsets)
+{
+	size_t capacity = noise.capacity();
+	noise.resize(size * size * size);
+	generateNoise(position, noise.data());
+	applyHeightmod(position, noise.data(), heightmod, offsets);
+	MemoryTracker::cpu(MEMORY_TERRAIN, (int64_t)(noise.capacity() - capacity));
+}
+
+/*
+	Noise for every block, in the same order as translations. It's all the chunk needs from the noise functions,
+	heightmod and the column's biome are applied over it (applyHeightmod, and the vertex shader)
+*/
+void ChunkBlock::generateNoise(glm::vec3 position, int8_t* noise)
+{
+	switch (specialised ? size : CHUNK_SIZE_ANY)
+	{
+	case 16:
+		generateNoiseSized<16>(position, noise);
+		break;
+	case 32:
+		generateNoiseSized<32>(position, noise);
+		break;
+	default:
+		generateNoiseSized<CHUNK_SIZE_ANY>(position, noise);
+		break;
+	}
+}
+
+/*
+	Noise scaled and raised by the column's biome. Offsets are whole blocks and kept within MAX_BLOCK_OFFSET, so they
+	fit in a byte
+*/
+void ChunkBlock::applyHeightmod(glm::vec3 position, const int8_t* noise, int heightmod, int8_t* offsets)
+{
+	switch (specialised ? size : CHUNK_SIZE_ANY)
+	{
+	case 16:
+		applyHeightmodSized<16>(position, noise, heightmod, offsets);
+		break;
+	case 32:
+		applyHeightmodSized<32>(position, noise, heightmod, offsets);
+		break;
+	default:
+		applyHeightmodSized<CHUNK_SIZE_ANY>(position, noise, heightmod, offsets);
+		break;
+	}
+}
+
+void ChunkBlock::buildInstances(glm::vec3 position, const int8_t* offsets, const int8_t* noise)
+{
+	switch (specialised ? size : CHUNK_SIZE_ANY)
+	{
+	case 16:
+		buildInstancesSized<16>(position, offsets, noise);
+		break;
+	case 32:
+		buildInstancesSized<32>(position, offsets, noise);
+		break;
+	default:
+		buildInstancesSized<CHUNK_SIZE_ANY>(position, offsets, noise);
+		break;
+	}
+}
+
+template <int SIZE>
+void ChunkBlock::generateNoiseSized(glm::vec3 position, int8_t* noise)
+{
+	//A constant unless SIZE is CHUNK_SIZE_ANY
+	const int n = SIZE != CHUNK_SIZE_ANY ? SIZE : size;
+
+	noiseRow.resize(n);
+	double* row = noiseRow.data();
+
+	for (int i = 0; i < n; i++)
+	{
+		for (int j = 0; j < n; j++)
+		{
+			//Blocks along k share the first two noise coordinates, simplex noise samples them as a row
+			if (backend == NOISE_SIMPLEX)
+			{
+				simplex.octave3DRow((j * 0.1 + position.z), (i * 0.1 + position.x), 0.0, 0.1, n, row, 1);
+			}
+			else
+			{
+				for (int k = 0; k < n; k++)
+				{
+					row[k] = perlin.octave3D((j * 0.1 + position.z), (i * 0.1 + position.x), (k*0.1), 1);
+				}
+			}
+
+			//One octave is within -1 to 1, never NOISE_EDITED
+			int8_t* out = noise + (i * n + j) * n;
+			for (int k = 0; k < n; k++)
+			{
+				out[k] = (int8_t)lround(std::min(std::max(row[k], -1.0), 1.0) * NOISE_STEPS);
+			}
+		}
+	}
+}
+
+template <int SIZE>
+void ChunkBlock::applyHeightmodSized(glm::vec3 position, const int8_t* noise, int heightmod, int8_t* offsets)
+{
+	const int n = SIZE != CHUNK_SIZE_ANY ? SIZE : size;
+
+	sampleColumns(position);
+	const ColumnBiome* biomes = columns.data();
+
+	for (int i = 0; i < n; i++)
+	{
+		for (int j = 0; j < n; j++)
+		{
+			const int8_t* in = noise + (i * n + j) * n;
+			int8_t* out = offsets + (i * n + j) * n;
+			for (int k = 0; k < n; k++)
+			{
+				//Apply noise only to the y component, edited blocks stay where they were put
+				if (in[k] != NOISE_EDITED)
+				{
+					const ColumnBiome& column = biomes[i * n + k];
+					out[k] = blockOffset(column.base, blockShape(column, in[k]), heightmod);
+				}
+			}
+		}
+	}
+}
+
+template <int SIZE>
+void ChunkBlock::buildInstancesSized(glm::vec3 position, const int8_t* offsets, const int8_t* noise)
+{
+	const int n = SIZE != CHUNK_SIZE_ANY ? SIZE : size;
+
+	size_t capacity = translations.capacity();
+
+	//Room for every block, cut down to the ones that weren't removed at the end. Written through a pointer rather than
+	//pushed back so the loop has no capacity checks
+	translations.resize((size_t)n * n * n);
+	BlockInstance* out = translations.data();
+
+	//Top layer of the chunk is the top block of the column's biome, everything below it the biome's fill
+	sampleColumns(position);
+	BlockInstance types[NUM_BLOCK_TYPES];
+	for (int t = 0; t < NUM_BLOCK_TYPES; t++)
+	{
+		blockTypeFaceLayers((BlockType)t, types[t].faceLayers);
+	}
 
 
 	/*
@@ -222,30 +514,70 @@ void ChunkBlock::buildInstanceData(glm::vec3 position, int heightmod)
 		|		 |/
 		X________X
 	*/
-	for (int i = 0; i < size; i++)
+	const int8_t* block = offsets;
+	for (int i = 0; i < n; i++)
 	{
-		for (int j = 0; j < size; j++)
+		for (int j = 0; j < n; j++)
 		{
-			for (int k = 0; k < size; k++)
+			for (int k = 0; k < n; k++)
 			{
-					//Apply perlin noise only to the y component 
-					const double noise = (int)(heightmod * perlin.octave3D((j * 0.1 + position.z), (i * 0.1 + position.x), (k*0.1), 1));
-					translations.push_back(glm::vec3(i + position.x, j + position.y + noise, k + position.z));
+					const int8_t blockNoise = noise != NULL ? noise[block - offsets] : NOISE_EDITED;
+					const int8_t offset = *block++;
+					if (offset == BLOCK_REMOVED)
+					{
+						continue;
+					}
+					const ColumnBiome& column = columns[i * n + k];
+					const BiomeRules& biome = BIOME_RULES[column.material];
+					*out = types[(j == n - 1) ? biome.top : biome.fill];
+					out->position = glm::vec3(i + position.x, j + position.y, k + position.z);
+
+					//The shader raises the block by its offset at the current heightmod, or by offset whatever it is
+					if (blockNoise == NOISE_EDITED)
+					{
+						out->lift = glm::vec2((float)offset, 0.0f);
+					}
+					else
+					{
+						out->lift = glm::vec2(column.base, blockShape(column, blockNoise));
+					}
+					out++;
 			}
 		}
 	}
+	translations.resize(out - translations.data());
 
+	findProps(position, offsets);
 
-	//Bind Instance data generated 
-	glBindBuffer(GL_ARRAY_BUFFER, instanceData);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * blockCount, &translations[0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	//Scratch space shared by every chunk, it only grows with the chunk size
+	MemoryTracker::cpu(MEMORY_TERRAIN, (int64_t)((translations.capacity() - capacity) * sizeof(BlockInstance)));
 
 
 }
 
-void ChunkBlock::drawChunkBlock(int drawmode)
+/*
+	Props stand on the top layer block of their column, or the one under it that's left when it was removed
+*/
+void ChunkBlock::findProps(glm::vec3 position, const int8_t* offsets)
 {
+	const int n = size;
+	for (int slot = 0; slot < MAX_PROPS_PER_CHUNK; slot++)
+	{
+		int x = PROP_SLOTS[slot][0] * n / PROP_SLOT_SIZE;
+		int z = PROP_SLOTS[slot][1] * n / PROP_SLOT_SIZE;
+		int j = n - 1;
+		while (j > 0 && offsets[(x * n + j) * n + z] == BLOCK_REMOVED)
+		{
+			j--;
+		}
+		props[slot] = glm::vec3(x + position.x, j + position.y + offsets[(x * n + j) * n + z], z + position.z);
+	}
+}
+
+void ChunkBlock::drawChunkBlock(int drawmode, GLuint instanceData, GLsizei instanceCount)
+{
+	PROFILE_SCOPE("drawChunkBlock");
+
 	/* Bind cube vertices. Note that this is in attribute index 0 */
 	glBindBuffer(GL_ARRAY_BUFFER, positionBufferObject);
 	glEnableVertexAttribArray(attribute_v_coord);
@@ -261,9 +593,17 @@ void ChunkBlock::drawChunkBlock(int drawmode)
 	/* Bind Instance data */ 
 	glEnableVertexAttribArray(attribute_v_instance);
 	glBindBuffer(GL_ARRAY_BUFFER, instanceData);
-	glVertexAttribPointer(attribute_v_instance, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glVertexAttribPointer(attribute_v_instance, 3, GL_FLOAT, GL_FALSE, sizeof(BlockInstance), (void*)offsetof(BlockInstance, position));
 	glVertexAttribDivisor(attribute_v_instance, 1);
+	/* Texture array layer of each face, integer attribute in index 4 */
+	glEnableVertexAttribArray(attribute_v_facelayers);
+	glVertexAttribIPointer(attribute_v_facelayers, 2, GL_UNSIGNED_INT, sizeof(BlockInstance), (void*)offsetof(BlockInstance, faceLayers));
+	glVertexAttribDivisor(attribute_v_facelayers, 1);
+	/* Base and shape of the height offset, index 5 */
+	glEnableVertexAttribArray(attribute_v_lift);
+	glVertexAttribPointer(attribute_v_lift, 2, GL_FLOAT, GL_FALSE, sizeof(BlockInstance), (void*)offsetof(BlockInstance, lift));
+	glVertexAttribDivisor(attribute_v_lift, 1);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glFrontFace(GL_CW);
 	//glPointSize(1.f);
 	glBindVertexArray(positionBufferObject);
@@ -271,15 +611,15 @@ void ChunkBlock::drawChunkBlock(int drawmode)
 	
 	if (drawmode == 0)
 	{
-		glDrawArraysInstanced(GL_TRIANGLES, 0, 36, (size * size * size));
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 36, instanceCount);
 	}
 	else if (drawmode == 1)
 	{
-		glDrawArraysInstanced(GL_LINES, 0, 36, (size * size * size));
+		glDrawArraysInstanced(GL_LINES, 0, 36, instanceCount);
 	}
 	else
 	{
-		glDrawArraysInstanced(GL_POINTS, 0, 36, (size * size * size));
+		glDrawArraysInstanced(GL_POINTS, 0, 36, instanceCount);
 	}
 }
 
@@ -8,7 +8,11 @@
 
 #include "wrapper_glfw.h"
 #include "cube_tex.h"
+#include "BlockTypes.h"
+#include "Biomes.h"
 #include <vector>
+#include <cstdint>
+#include <algorithm>
 
 /* Include GLM core and matrix extensions*/
 #include <glm/glm.hpp>
@@ -16,6 +20,97 @@
 
 //Include Noise Function
 # include "PerlinNoise.hpp"
+#include "SimplexNoise.h"
+
+//Per instance data of one small cube, attributes 3 (position), 4 (face texture layers) and 5 (lift)
+struct BlockInstance
+{
+	glm::vec3 position; //Before it's raised by its height offset
+	GLuint faceLayers[2];
+	glm::vec2 lift; //Base and shape of its height offset (blockOffset), the vertex shader raises it by
+};
+
+//One block changed from the generated terrain, what RegionStore saves of an edited chunk
+struct ChunkEdit
+{
+	uint16_t index; //Into the chunk's offsets, in the same order as translations
+	int8_t offset; //Block height offset it was set to
+	uint8_t reserved;
+};
+
+//Offset of a removed block, it has no instance. Generated offsets are never below -MAX_BLOCK_OFFSET
+const int8_t BLOCK_REMOVED = INT8_MIN;
+
+//Furthest noise and biome height rules move a block up or down
+const int MAX_BLOCK_OFFSET = 30;
+
+/*
+	The terrain height (heightmod) is applied by the vertex shader, so chunks keep what their blocks' heights are made
+	of rather than the heights: the noise of every block, quantised to a byte from -NOISE_STEPS to NOISE_STEPS. A
+	block's height offset is its column's base plus heightmod times its shape (its column's amplitude times its noise),
+	truncated to a whole block and kept within MAX_BLOCK_OFFSET. Changing heightmod only changes a uniform: no chunk is
+	generated or uploaded again, the offsets raycasts, props and region files use are worked out again from the noise.
+	An edited block's noise is NOISE_EDITED, it stays at the offset it was put at whatever the heightmod.
+*/
+const float NOISE_STEPS = 127.0f;
+const int8_t NOISE_EDITED = INT8_MIN;
+
+//What heightmod is multiplied by to raise a block
+inline float blockShape(const ColumnBiome& column, int8_t noise)
+{
+	return column.amplitude * (noise / NOISE_STEPS);
+}
+
+//In float like program_v_0.vert, which works out the same offset from a block's lift
+inline int8_t blockOffset(float base, float shape, int heightmod)
+{
+	int offset = (int)(base + shape * (float)heightmod);
+	return (int8_t)std::min(std::max(offset, -MAX_BLOCK_OFFSET), MAX_BLOCK_OFFSET);
+}
+
+//Top layer columns (x, z) trees can be placed on, used in this order as the prop density goes up.
+//The first two are where the two trees of every chunk have always been. They're columns of a PROP_SLOT_SIZE chunk,
+//scaled to the size of the others
+const int MAX_PROPS_PER_CHUNK = 6;
+const int PROP_SLOTS[MAX_PROPS_PER_CHUNK][2] = { { 1, 12 }, { 3, 8 }, { 12, 13 }, { 9, 3 }, { 6, 6 }, { 13, 1 } };
+const int PROP_SLOT_SIZE = 16;
+
+/*
+	Generating a chunk is a loop over its size^3 blocks. For the sizes chunks are usually (16, and 32 the benchmarks
+	also run) the loops are compiled with the size as a constant, the *Sized<SIZE> functions, so their bounds and
+	block indices are known and the compiler can unroll and vectorise them. Any other size runs the same loops with
+	the size only known at run time (SIZE CHUNK_SIZE_ANY).
+*/
+const int CHUNK_SIZE_ANY = 0;
+
+/*
+	Chunks are cubes stacked in layers, layer 0 starting at WORLD_BASE_Y and each one size blocks above the last. The
+	terrain surface of a column of chunks is in one of its layers (surfaceLayer), that chunk is the only one of the
+	column generated, meshed and drawn. Chunks above it are all air and below it all solid, they're known from their
+	ChunkFill alone and never have offsets, instance data or a buffer, so a world of any height costs what one layer does.
+	With a single layer (the default) the surface is always in layer 0, the flat world there's always been.
+*/
+const int WORLD_BASE_Y = -20;
+const int MAX_WORLD_LAYERS = 64;
+
+//Chunks the surface noise is stretched over per layer of world height. Gentle enough that neighbouring columns'
+//surfaces are never more than a layer apart, further apart the side of a solid chunk would face the air
+const double SURFACE_LAYER_SCALE = 5.0;
+
+//Noise block heights and surface layers are sampled from. Both are seeded the same but make different terrain, a world
+//saved to region files should be opened with the one it was made with
+enum NoiseBackend
+{
+	NOISE_PERLIN, //siv::PerlinNoise, what the terrain has always been
+	NOISE_SIMPLEX //SimplexNoise, 4 corners a sample rather than 8 and 4 samples at a time with SSE2
+};
+
+enum ChunkFill
+{
+	CHUNK_AIR, //Above the surface
+	CHUNK_SOLID, //Below it
+	CHUNK_SURFACE //Holds the surface
+};
 
 class ChunkBlock
 {
@@ -24,34 +119,105 @@ class ChunkBlock
 		~ChunkBlock();
 
 		void makeChunkBlock();
-		void drawChunkBlock(int drawmode);
+		void drawChunkBlock(int drawmode, GLuint instanceData, GLsizei instanceCount);
 		int getChunkSize();
-		void buildInstanceData(glm::vec3 position, int heightmod);
+		void buildInstanceData(glm::vec3 position, int heightmod, GLuint instanceData);
+		//Same, sampling into noise and offsets (both size^3) rather than the shared scratch space and applying edits over them
+		void buildInstanceData(glm::vec3 position, int heightmod, GLuint instanceData, int8_t* offsets, int8_t* noise, const ChunkEdit* edits, size_t editCount);
+		//Same, for offsets read back whole at storedHeightmod: blocks that aren't where the noise puts them there were
+		//edited and stay as they are, the rest are brought to heightmod
+		void rebuildInstanceData(glm::vec3 position, int heightmod, GLuint instanceData, int8_t* offsets, int8_t* noise, int storedHeightmod);
+		void generateInstances(glm::vec3 position, int heightmod);
+
+		//The parts of generateInstances: sample the noise of every block (size^3), work out their height offsets at
+		//heightmod from it (what region files store, edited blocks are left as they are), then lay the blocks out into
+		//translations, leaving removed ones out. Without noise (a chunk read back whole) blocks are laid out to stay
+		//at their offsets
+		void generateNoise(glm::vec3 position, int8_t* noise);
+		void applyHeightmod(glm::vec3 position, const int8_t* noise, int heightmod, int8_t* offsets);
+		void buildInstances(glm::vec3 position, const int8_t* offsets, const int8_t* noise = NULL);
+
+		//generateNoise then applyHeightmod, through the scratch space for the noise
+		void generateOffsets(glm::vec3 position, int heightmod, int8_t* offsets);
+
+		//Find the top block of every prop slot, buildInstances does too
+		void findProps(glm::vec3 position, const int8_t* offsets);
+
+		//Upload translations into instanceData
+		void uploadInstances(GLuint instanceData);
 
 		glm::vec3 getTranslations(int i);
 
+		//Position of the top block in a prop slot (PROP_SLOTS) of the chunk last generated
+		glm::vec3 getPropPosition(int slot);
+
+		//Index into offsets of block (i, j, k), i along x, j along y and k along z
+		int blockIndex(int i, int j, int k) const { return (i * size + j) * size + k; }
+
+		//Layer of the column of chunks at (x, z) the surface is in, from 2D noise
+		int surfaceLayer(float x, float z) const;
+
+		//y of the chunks in a layer
+		float layerY(int layer) const { return (float)(WORLD_BASE_Y + layer * size); }
+
+		//Whether the chunk at position is above, below or holds the surface
+		ChunkFill chunkFill(glm::vec3 position) const;
+
+		//Work done so far, for benchmarks: chunks generated from noise and instance data uploaded
+		uint64_t builds;
+		uint64_t uploadedBytes;
+
 		// Define vertex buffer object names (e.g as globals)
 		GLuint positionBufferObject;
 		GLuint colourObject;
 		GLuint normalsBufferObject;
 		GLuint texCoordsObject;
-		GLuint instanceData;
 
 		GLuint attribute_v_coord; 
 		GLuint attribute_v_normal;
 		GLuint attribute_v_colours;
 		GLuint attribute_v_instance;
+		GLuint attribute_v_facelayers;
+		GLuint attribute_v_lift;
 
 		Cube instanceCube;
 
 		int numvertices;
 		int drawmode;
 		int size; // size * size * size gives number of blocks
+		int layers; //World height in chunks, 1 to MAX_WORLD_LAYERS
+		NoiseBackend backend;
+		bool specialised; //Generate with the loops compiled for size when there are some, benchmarks compare without
+
+		//Positions at which each instance/small cube is draw in the larger chunk and the texture layers of its faces
+		std::vector<BlockInstance> translations;
 
-		//Positions at which each instance/small cube is draw in the larger chunk 
-		std::vector<glm::vec3> translations;
+		//Highest block left in each prop slot's column, found by buildInstances
+		glm::vec3 props[MAX_PROPS_PER_CHUNK];
+
+		//Block noise and height offsets generateInstances samples into
+		std::vector<int8_t> noise;
+		std::vector<int8_t> offsets;
 
 		//Set seed for terrain generation 
 		const siv::PerlinNoise::seed_type seed = 78948u;
 		const siv::PerlinNoise perlin{ seed };
+		const SimplexNoise simplex{ seed };
+
+		//Biome of every column of a chunk, only used from the thread that generates chunks
+		ClimateMap climate{ seed };
+
+	private:
+		//Fill columns for the chunk at position, unless they already are (generateInstances needs them twice)
+		void sampleColumns(glm::vec3 position);
+
+		//generateNoise, applyHeightmod and buildInstances for chunks of SIZE blocks, or size when it's CHUNK_SIZE_ANY
+		template <int SIZE> void generateNoiseSized(glm::vec3 position, int8_t* noise);
+		template <int SIZE> void applyHeightmodSized(glm::vec3 position, const int8_t* noise, int heightmod, int8_t* offsets);
+		template <int SIZE> void buildInstancesSized(glm::vec3 position, const int8_t* offsets, const int8_t* noise);
+
+		std::vector<ColumnBiome> columns; //size^2, x major
+		std::vector<double> noiseRow; //Noise of a column's blocks, size
+		glm::vec3 columnsPosition;
+		int columnsSize;
 };
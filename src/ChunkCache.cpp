@@ -0,0 +1,368 @@
+/*
+	Cache of generated chunks, see ChunkCache.h
+	Sameer Al Harbi 2022
+*/
+
+#include "ChunkCache.h"
+#include "MemoryTracker.h"
+#include "RegionStore.h"
+#include "Profiler.h"
+#include <iostream>
+#include <algorithm>
+
+using namespace std;
+
+ChunkCache::ChunkCache(size_t budgetBytes)
+{
+	budget = budgetBytes;
+	bytes = 0;
+	frame = 0;
+	evictions = 0;
+	loads = 0;
+	remeshes = 0;
+	rescales = 0;
+	store = NULL;
+	overBudgetLogged = false;
+}
+
+//Few enough chunks that a linear search is quicker than hashing positions
+CachedChunk* ChunkCache::find(glm::vec3 position)
+{
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		if (chunks[i].position == position)
+		{
+			return &chunks[i];
+		}
+	}
+	return NULL;
+}
+
+CachedChunk* ChunkCache::findContaining(glm::vec3 point, int chunkSize)
+{
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		glm::vec3 p = chunks[i].position;
+		if (point.x >= p.x && point.x < p.x + chunkSize && point.z >= p.z && point.z < p.z + chunkSize)
+		{
+			return &chunks[i];
+		}
+	}
+	return NULL;
+}
+
+CachedChunk* ChunkCache::generate(ChunkBlock& generator, glm::vec3 position, int heightmod)
+{
+	//All air or all solid, nothing is kept for it
+	if (generator.chunkFill(position) != CHUNK_SURFACE)
+	{
+		return NULL;
+	}
+
+	CachedChunk* chunk = find(position);
+
+	//Edits not saved yet would be lost when the chunk is generated again. Unedited chunks aren't saved here, a chunk's
+	//entry only holds one heightmod and the one it's being generated with is likely stored already
+	if (chunk && !chunk->saved && (!chunk->edits.empty() || chunk->compacted))
+	{
+		save(*chunk, false);
+	}
+
+	if (chunk == NULL)
+	{
+		//Make room for as many chunks as the budget can hold at once, with their buffers, rather than growing a step
+		//at a time mid-frame
+		if (chunks.size() == chunks.capacity())
+		{
+			size_t blocks = (size_t)generator.size * generator.size * generator.size;
+			ChunkOccupancy occupancy;
+			occupancy.reserve(generator.size);
+			size_t chunkBytes = sizeof(CachedChunk) + 2 * blocks + occupancy.storageBytes() + sizeof(BlockInstance) * blocks;
+			chunks.reserve(std::max(chunks.size() + 1, budget / chunkBytes + CHUNK_CACHE_HEADROOM));
+			spareBuffers.reserve(chunks.capacity());
+			spareOffsets.reserve(chunks.capacity());
+			spareOffsets.resize(chunks.capacity() - chunks.size(), std::vector<int8_t>(blocks));
+			spareNoise.reserve(chunks.capacity());
+			spareNoise.resize(spareOffsets.size(), std::vector<int8_t>(blocks));
+			spareEdits.reserve(chunks.capacity());
+			while (spareEdits.size() < spareOffsets.size())
+			{
+				spareEdits.push_back(std::vector<ChunkEdit>());
+				spareEdits.back().reserve(REGION_COMPACT_EDITS);
+			}
+			spareOccupancy.reserve(chunks.capacity());
+			spareOccupancy.resize(spareOffsets.size(), occupancy);
+
+			size_t first = spareBuffers.size();
+			spareBuffers.resize(chunks.capacity() - chunks.size());
+			glGenBuffers((GLsizei)(spareBuffers.size() - first), &spareBuffers[first]);
+			for (size_t i = first; i < spareBuffers.size(); i++)
+			{
+				MemoryTracker::buffer(spareBuffers[i], MEMORY_TERRAIN, 0);
+			}
+		}
+
+		CachedChunk added;
+		added.instanceData = spareBuffers.back();
+		spareBuffers.pop_back();
+		added.offsets = std::move(spareOffsets.back());
+		spareOffsets.pop_back();
+		added.noise = std::move(spareNoise.back());
+		spareNoise.pop_back();
+		added.edits = std::move(spareEdits.back());
+		spareEdits.pop_back();
+		added.occupancy = std::move(spareOccupancy.back());
+		spareOccupancy.pop_back();
+		added.instanceBytes = 0;
+		chunks.push_back(std::move(added));
+		chunk = &chunks.back();
+
+		size_t storageBytes = chunk->offsets.size() + chunk->noise.size() + REGION_COMPACT_EDITS * sizeof(ChunkEdit) + chunk->occupancy.storageBytes();
+		bytes += sizeof(CachedChunk) + storageBytes;
+		MemoryTracker::cpu(MEMORY_TERRAIN, sizeof(CachedChunk) + storageBytes);
+	}
+
+	//No-op unless the chunk size changed
+	chunk->offsets.resize((size_t)generator.size * generator.size * generator.size);
+	chunk->noise.resize(chunk->offsets.size());
+
+	//A chunk stored whole at this heightmod only has to be laid out from its offsets (its blocks stay at them whatever
+	//heightmod is). Stored at another, it's generated from noise with the blocks that differ from it kept as edits.
+	//Anything else is generated from noise and has its edits replayed over it
+	chunk->edits.clear();
+	int storedHeightmod = heightmod;
+	StoredChunk stored = store ? store->load(position, heightmod, chunk->offsets.data(), chunk->edits, &storedHeightmod) : STORED_NONE;
+	bool rebuilt = stored == STORED_WHOLE && storedHeightmod != heightmod;
+	if (rebuilt)
+	{
+		generator.rebuildInstanceData(position, heightmod, chunk->instanceData, chunk->offsets.data(), chunk->noise.data(), storedHeightmod);
+	}
+	else if (stored == STORED_WHOLE)
+	{
+		generator.buildInstances(position, chunk->offsets.data());
+		generator.uploadInstances(chunk->instanceData);
+	}
+	else
+	{
+		generator.buildInstanceData(position, heightmod, chunk->instanceData, chunk->offsets.data(), chunk->noise.data(), chunk->edits.data(), chunk->edits.size());
+	}
+	loads += stored != STORED_NONE ? 1 : 0;
+	chunk->shaped = stored != STORED_WHOLE || rebuilt;
+
+	//Generated chunks with no edits are already what an edit store would have. One rebuilt from another heightmod is
+	//saved again at this one. An edit store only keeps a chunk whole once it's been compacted, a whole chunk store
+	//keeps every chunk whole and they're no more edited than generated ones are
+	chunk->compacted = stored == STORED_WHOLE && store->getMode() == REGION_EDITS;
+	chunk->saved = (stored != STORED_NONE && !rebuilt) || (stored == STORED_NONE && store && store->getMode() == REGION_EDITS);
+
+	for (int i = 0; i < MAX_PROPS_PER_CHUNK; i++)
+	{
+		chunk->props[i] = generator.getPropPosition(i);
+	}
+
+	//The chunk size can change between generations
+	size_t instanceBytes = sizeof(BlockInstance) * generator.translations.size();
+	bytes += instanceBytes - chunk->instanceBytes;
+	chunk->instanceBytes = instanceBytes;
+	chunk->instanceCount = (GLsizei)generator.translations.size();
+	chunk->occupancy.build(chunk->offsets.data(), generator.size, position);
+
+	chunk->position = position;
+	chunk->heightmod = heightmod;
+	chunk->lastUsed = frame;
+	return chunk;
+}
+
+void ChunkCache::remesh(ChunkBlock& generator, CachedChunk* chunk)
+{
+	PROFILE_SCOPE("ChunkCache::remesh");
+
+	generator.buildInstances(chunk->position, chunk->offsets.data(), chunk->shaped ? chunk->noise.data() : NULL);
+	generator.uploadInstances(chunk->instanceData);
+	for (int i = 0; i < MAX_PROPS_PER_CHUNK; i++)
+	{
+		chunk->props[i] = generator.getPropPosition(i);
+	}
+
+	size_t instanceBytes = sizeof(BlockInstance) * generator.translations.size();
+	bytes += instanceBytes - chunk->instanceBytes;
+	chunk->instanceBytes = instanceBytes;
+	chunk->instanceCount = (GLsizei)generator.translations.size();
+	remeshes++;
+}
+
+void ChunkCache::rescale(ChunkBlock& generator, int heightmod)
+{
+	PROFILE_SCOPE("ChunkCache::rescale");
+
+	for (size_t c = 0; c < chunks.size(); c++)
+	{
+		CachedChunk& chunk = chunks[c];
+		if (!chunk.shaped || chunk.heightmod == heightmod)
+		{
+			continue;
+		}
+
+		generator.applyHeightmod(chunk.position, chunk.noise.data(), heightmod, chunk.offsets.data());
+		generator.findProps(chunk.position, chunk.offsets.data());
+		for (int i = 0; i < MAX_PROPS_PER_CHUNK; i++)
+		{
+			chunk.props[i] = generator.getPropPosition(i);
+		}
+		chunk.occupancy.build(chunk.offsets.data(), generator.size, chunk.position);
+		chunk.heightmod = heightmod;
+
+		//A whole chunk's entry is for one heightmod, it's saved again at this one. Edit lists don't depend on heightmod
+		if (chunk.compacted || (store && store->getMode() == REGION_WHOLE_CHUNKS))
+		{
+			chunk.saved = false;
+		}
+		rescales++;
+	}
+}
+
+void ChunkCache::fillScene(VoxelScene& scene, int chunkSize) const
+{
+	scene.chunkSize = chunkSize;
+	scene.chunks.clear();
+	for (size_t i = 0; i < chunks.size() && scene.chunks.size() < scene.chunks.capacity(); i++)
+	{
+		scene.chunks.push_back(&chunks[i].occupancy);
+	}
+}
+
+void ChunkCache::use(CachedChunk* chunk)
+{
+	chunk->lastUsed = frame;
+}
+
+void ChunkCache::endFrame(glm::vec3 camera)
+{
+	while (bytes > budget)
+	{
+		//Least recently drawn, then farthest from the camera
+		size_t victim = chunks.size();
+		float victimDistance = 0.0f;
+		for (size_t i = 0; i < chunks.size(); i++)
+		{
+			if (chunks[i].lastUsed == frame)
+			{
+				continue;
+			}
+
+			float distance = glm::distance(glm::vec2(chunks[i].position.x, chunks[i].position.z), glm::vec2(camera.x, camera.z));
+			if (victim == chunks.size() || chunks[i].lastUsed < chunks[victim].lastUsed
+				|| (chunks[i].lastUsed == chunks[victim].lastUsed && distance > victimDistance))
+			{
+				victim = i;
+				victimDistance = distance;
+			}
+		}
+
+		if (victim == chunks.size())
+		{
+			if (!overBudgetLogged)
+			{
+				overBudgetLogged = true;
+				cout << "Chunks in view need " << bytes / 1024 << " KB, more than the chunk memory budget of " << budget / 1024 << " KB" << endl;
+			}
+			break;
+		}
+
+		evict(victim);
+	}
+
+	frame++;
+}
+
+void ChunkCache::evict(size_t index)
+{
+	CachedChunk& chunk = chunks[index];
+
+	save(chunk, false);
+	spareOffsets.push_back(std::move(chunk.offsets));
+	spareNoise.push_back(std::move(chunk.noise));
+	spareEdits.push_back(std::move(chunk.edits));
+	spareOccupancy.push_back(std::move(chunk.occupancy));
+
+	//Release the buffer's storage but keep it for the next chunk generated
+	glBindBuffer(GL_ARRAY_BUFFER, chunk.instanceData);
+	glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	spareBuffers.push_back(chunk.instanceData);
+	MemoryTracker::buffer(chunk.instanceData, MEMORY_TERRAIN, 0);
+	size_t storageBytes = spareOffsets.back().size() + spareNoise.back().size() + REGION_COMPACT_EDITS * sizeof(ChunkEdit) + spareOccupancy.back().storageBytes();
+	MemoryTracker::cpu(MEMORY_TERRAIN, -(int64_t)(sizeof(CachedChunk) + storageBytes));
+	bytes -= chunk.instanceBytes + sizeof(CachedChunk) + storageBytes;
+	evictions++;
+
+	//Order doesn't matter, move the last chunk into the gap
+	if (index + 1 < chunks.size())
+	{
+		chunks[index] = std::move(chunks.back());
+	}
+	chunks.pop_back();
+}
+
+void ChunkCache::flush()
+{
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		save(chunks[i], true);
+	}
+}
+
+//Written by the store's thread, only the offsets or edits are copied here. An unedited chunk can be generated again
+//when the queue is full and its save is dropped, edits can't so they wait for room
+void ChunkCache::save(CachedChunk& chunk, bool wait)
+{
+	if (store == NULL || chunk.saved)
+	{
+		return;
+	}
+
+	bool edited = !chunk.edits.empty() || chunk.compacted;
+	bool whole = chunk.compacted || store->getMode() == REGION_WHOLE_CHUNKS;
+	chunk.saved = store->save(chunk.position, chunk.heightmod, chunk.offsets.data(), whole ? NULL : &chunk.edits, wait || edited);
+}
+
+void ChunkCache::edit(CachedChunk* chunk, int index, int8_t offset)
+{
+	chunk->offsets[index] = offset;
+	if (chunk->shaped)
+	{
+		chunk->noise[index] = NOISE_EDITED;
+	}
+	chunk->occupancy.build(chunk->offsets.data(), chunk->occupancy.cells.x, chunk->position);
+	chunk->saved = false;
+	if (chunk->compacted)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < chunk->edits.size(); i++)
+	{
+		if (chunk->edits[i].index == index)
+		{
+			chunk->edits[i].offset = offset;
+			return;
+		}
+	}
+
+	if (chunk->edits.size() < REGION_COMPACT_EDITS)
+	{
+		ChunkEdit added = { (uint16_t)index, offset, 0 };
+		chunk->edits.push_back(added);
+	}
+	else
+	{
+		//The whole chunk is smaller to store (and quicker to load) than a list this long
+		chunk->compacted = true;
+		chunk->edits.clear();
+	}
+}
+
+int ChunkCache::count() const
+{
+	return (int)chunks.size();
+}
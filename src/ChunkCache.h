@@ -0,0 +1,113 @@
+/*
+	Generated chunks kept on the GPU. Each chunk's instance data has its own buffer, so a chunk is only generated and
+	uploaded when it comes into view, not every frame it's drawn. Chunks keep the noise of their blocks, so when the
+	terrain height changes their offsets are worked out again from it (rescale) and the shader draws them at the new
+	height, only a chunk loaded whole from a store has no noise and is generated again.
+	Chunks stay resident after they leave view until the cache's memory (instance buffers and the CPU side of each entry)
+	is over its budget, then the ones drawn least recently are evicted, farthest from the camera first among those
+	last drawn in the same frame. Chunks drawn this frame are never evicted, so the budget can only be exceeded when the
+	chunks in view alone need more than it.
+	With a RegionStore, evicted chunks are saved and chunks coming into view are loaded from it when they're stored.
+	Edits to a chunk are kept as a list of changed blocks, which is all a REGION_EDITS store saves until the chunk
+	has more than REGION_COMPACT_EDITS of them and is compacted: saved whole, with no list kept from then on.
+	Sameer Al Harbi 2022
+*/
+#pragma once
+
+#include "ChunkBlock.h"
+#include "RegionStore.h"
+#include "VoxelRaycast.h"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+//Room for chunks generated in a frame beyond the budget, they're only evicted when it ends
+const int CHUNK_CACHE_HEADROOM = 32;
+
+struct CachedChunk
+{
+	glm::vec3 position;
+	int heightmod; //Terrain height the offsets are at
+	GLuint instanceData;
+	size_t instanceBytes;
+	GLsizei instanceCount; //Blocks drawn, fewer than size^3 when some were removed
+	glm::vec3 props[MAX_PROPS_PER_CHUNK]; //Top blocks of the prop slots
+	uint64_t lastUsed; //Frame the chunk was last drawn in
+	std::vector<int8_t> offsets; //Block height offsets the instance data was built from
+	std::vector<int8_t> noise; //Block noise, NOISE_EDITED where a block was edited
+	bool shaped; //Has noise, false when it was loaded whole and the offsets are all there is
+	std::vector<ChunkEdit> edits; //Blocks changed from the generated terrain, one entry per block
+	bool compacted; //Had too many edits to list (or was loaded so from an edit store), the chunk is stored whole
+	ChunkOccupancy occupancy; //Cells its blocks fill, for raycasts
+	bool saved; //The region files have this version of the chunk
+};
+
+class ChunkCache
+{
+public:
+	ChunkCache(size_t budgetBytes);
+
+	//Chunk generated at position, NULL if it isn't resident
+	CachedChunk* find(glm::vec3 position);
+
+	//Resident chunk of chunkSize blocks whose columns hold point (x and z), NULL if there isn't one
+	CachedChunk* findContaining(glm::vec3 point, int chunkSize);
+
+	//Generate (or load, when it's stored) the chunk at position with generator and upload it, into its old buffer if
+	//it's resident. NULL for a chunk above or below the surface, there's nothing to generate
+	CachedChunk* generate(ChunkBlock& generator, glm::vec3 position, int heightmod);
+
+	//Set the height offset of block index (into offsets) in a resident chunk. Its occupancy is updated straight away so
+	//the next raycast sees the edit, its instance data isn't rebuilt here
+	void edit(CachedChunk* chunk, int index, int8_t offset);
+
+	//Rebuild a resident chunk's instance data from its offsets, after edits
+	void remesh(ChunkBlock& generator, CachedChunk* chunk);
+
+	//Bring the offsets, props and occupancy of every resident chunk with noise to heightmod. Their instance data
+	//doesn't change, the shader applies heightmod to it
+	void rescale(ChunkBlock& generator, int heightmod);
+
+	//Point scene at the occupancy of every resident chunk, valid until the next endFrame
+	void fillScene(VoxelScene& scene, int chunkSize) const;
+
+	//Mark a chunk as drawn this frame
+	void use(CachedChunk* chunk);
+
+	//Evict chunks until the cache is within budget, then start a new frame. Pointers from find/generate are invalid after
+	void endFrame(glm::vec3 camera);
+
+	//Save evicted chunks to store and load chunks from it, NULL to always generate them
+	void setStore(RegionStore* store) { this->store = store; }
+
+	//Save every resident chunk that isn't stored yet, waiting for room in the write queue
+	void flush();
+
+	void setBudget(size_t bytes) { budget = bytes; }
+	size_t budgetBytes() const { return budget; }
+
+	//GPU and CPU memory of the resident chunks
+	size_t residentBytes() const { return bytes; }
+	int count() const;
+
+	uint64_t evictions;
+	uint64_t loads; //Chunks read from the store instead of generated
+	uint64_t remeshes; //Instance data rebuilt after edits
+	uint64_t rescales; //Chunks brought to a new heightmod without generating them
+
+private:
+	void evict(size_t index);
+	void save(CachedChunk& chunk, bool wait);
+
+	std::vector<CachedChunk> chunks;
+	std::vector<GLuint> spareBuffers; //Empty buffers, made ahead or left by evicted chunks
+	std::vector<std::vector<int8_t>> spareOffsets; //Offset arrays for new chunks, the same way
+	std::vector<std::vector<int8_t>> spareNoise; //Noise arrays, the same way
+	std::vector<std::vector<ChunkEdit>> spareEdits; //Edit lists with room for REGION_COMPACT_EDITS, the same way
+	std::vector<ChunkOccupancy> spareOccupancy; //And occupancy
+	RegionStore* store;
+	size_t budget;
+	size_t bytes;
+	uint64_t frame;
+	bool overBudgetLogged;
+};
@@ -0,0 +1,63 @@
+/*
+	Containers with their storage inline and a capacity fixed at compile time, for transient per-frame data that would
+	otherwise hit the heap every frame (a std::stack is a deque, it allocates as soon as it's constructed).
+	They have the std interfaces the engine uses. Going over capacity is a bug, it's reported and the program aborts.
+	Sameer Al Harbi 2022
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+
+template <typename T, size_t N>
+class FixedVector
+{
+public:
+	FixedVector() : count(0) {}
+
+	void push_back(const T& value)
+	{
+		if (count == N)
+		{
+			std::cerr << "FixedVector of " << N << " elements is full" << std::endl;
+			std::abort();
+		}
+		items[count++] = value;
+	}
+
+	void pop_back() { count--; }
+	void clear() { count = 0; }
+
+	T& operator[](size_t i) { return items[i]; }
+	const T& operator[](size_t i) const { return items[i]; }
+	T& back() { return items[count - 1]; }
+	const T& back() const { return items[count - 1]; }
+
+	T* begin() { return items; }
+	T* end() { return items + count; }
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	static size_t capacity() { return N; }
+
+private:
+	T items[N];
+	size_t count;
+};
+
+//Drop-in for std::stack
+template <typename T, size_t N>
+class FixedStack
+{
+public:
+	void push(const T& value) { items.push_back(value); }
+	void pop() { items.pop_back(); }
+	T& top() { return items.back(); }
+	const T& top() const { return items.back(); }
+	size_t size() const { return items.size(); }
+	bool empty() const { return items.empty(); }
+
+private:
+	FixedVector<T, N> items;
+};
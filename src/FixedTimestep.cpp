@@ -0,0 +1,80 @@
+/*
+	Fixed timestep accumulator, see FixedTimestep.h
+	Sameer Al Harbi 2022
+*/
+
+#include "FixedTimestep.h"
+#include <iostream>
+
+using namespace std;
+
+FixedTimestep::FixedTimestep(double tickSeconds, int maxTicksPerFrame)
+{
+	tick = tickSeconds;
+	this->maxTicksPerFrame = maxTicksPerFrame;
+	accumulator = 0.0;
+	lockstep = false;
+	ticks = 0;
+	frames = 0;
+	cappedFrames = 0;
+	droppedSeconds = 0.0;
+}
+
+int FixedTimestep::advance(double frameSeconds)
+{
+	frames++;
+
+	if (lockstep)
+	{
+		ticks++;
+		return 1;
+	}
+
+	accumulator += frameSeconds;
+	int steps = (int)(accumulator / tick);
+
+	if (steps > maxTicksPerFrame)
+	{
+		//First time only, the totals are in printStats
+		if (cappedFrames == 0)
+		{
+			cout << "Frame took " << frameSeconds * 1000.0 << " ms, simulation limited to " << maxTicksPerFrame << " ticks per frame" << endl;
+		}
+		cappedFrames++;
+		droppedSeconds += (steps - maxTicksPerFrame) * tick;
+		accumulator -= (steps - maxTicksPerFrame) * tick;
+		steps = maxTicksPerFrame;
+	}
+
+	//What's left is the part of a tick that hasn't been simulated yet
+	accumulator -= steps * tick;
+	ticks += steps;
+	return steps;
+}
+
+double FixedTimestep::alpha() const
+{
+	return lockstep ? 1.0 : accumulator / tick;
+}
+
+void FixedTimestep::setLockstep(bool lockstep)
+{
+	this->lockstep = lockstep;
+	accumulator = 0.0;
+}
+
+void FixedTimestep::setTickSeconds(double seconds)
+{
+	tick = seconds;
+	accumulator = 0.0;
+}
+
+void FixedTimestep::printStats() const
+{
+	cout << "Simulation: " << ticks << " ticks of " << tick * 1000.0 << " ms over " << frames << " frames";
+	if (cappedFrames)
+	{
+		cout << ", " << cappedFrames << " frames over the catch-up limit (" << droppedSeconds * 1000.0 << " ms dropped)";
+	}
+	cout << endl;
+}
@@ -0,0 +1,41 @@
+/*
+	Fixed timestep clock for the simulation. Real frame time is added to an accumulator and spent in whole ticks, so
+	movement is the same at 30 or 144 fps, and rendering interpolates between the last two ticks with alpha().
+	A slow frame runs several ticks before drawing once (it drops rendering, not simulation), up to maxTicksPerFrame.
+	Time beyond that is thrown away so a long stall (loading, a breakpoint, a background tab) can't make every
+	following frame slower by trying to catch up.
+	In lockstep mode every frame is exactly one tick regardless of real time, for deterministic benchmarks.
+	Sameer Al Harbi 2022
+*/
+#pragma once
+
+#include <cstdint>
+
+class FixedTimestep
+{
+public:
+	FixedTimestep(double tickSeconds = 1.0 / 60.0, int maxTicksPerFrame = 5);
+
+	//Add a frame's real duration, returns how many ticks to simulate this frame
+	int advance(double frameSeconds);
+
+	//How far between the previous and current tick to render, 0..1 (always 1 in lockstep)
+	double alpha() const;
+
+	void setLockstep(bool lockstep);
+	void setTickSeconds(double seconds);
+	double tickSeconds() const { return tick; }
+
+	void printStats() const;
+
+	uint64_t ticks; //Simulated so far
+	uint64_t frames;
+	uint64_t cappedFrames; //Frames that hit maxTicksPerFrame
+	double droppedSeconds; //Real time the simulation skipped because of the cap
+
+private:
+	double tick;
+	int maxTicksPerFrame;
+	double accumulator;
+	bool lockstep;
+};
@@ -0,0 +1,56 @@
+/*
+	Per-frame linear allocator, see FrameAllocator.h
+	Sameer Al Harbi 2022
+*/
+
+#include "FrameAllocator.h"
+#include <iostream>
+#include <new>
+
+using namespace std;
+
+FrameAllocator::FrameAllocator(size_t capacity)
+{
+	size = capacity;
+	offset = 0;
+	highWater = 0;
+	overflows = 0;
+	memory = static_cast<unsigned char*>(::operator new(capacity));
+	overflowBlocks.reserve(16);
+}
+
+FrameAllocator::~FrameAllocator()
+{
+	reset();
+	::operator delete(memory);
+}
+
+void* FrameAllocator::allocate(size_t bytes, size_t alignment)
+{
+	size_t start = (offset + alignment - 1) & ~(alignment - 1);
+	if (start + bytes <= size)
+	{
+		offset = start + bytes;
+		highWater = offset > highWater ? offset : highWater;
+		return memory + start;
+	}
+
+	if (overflows == 0)
+	{
+		cout << "Frame allocator full (" << size << " bytes), " << bytes << " bytes taken from the heap" << endl;
+	}
+	overflows++;
+	void* block = ::operator new(bytes);
+	overflowBlocks.push_back(block);
+	return block;
+}
+
+void FrameAllocator::reset()
+{
+	for (size_t i = 0; i < overflowBlocks.size(); i++)
+	{
+		::operator delete(overflowBlocks[i]);
+	}
+	overflowBlocks.clear();
+	offset = 0;
+}
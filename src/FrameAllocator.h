@@ -0,0 +1,42 @@
+/*
+	Linear (bump) allocator for data that only lives for one frame. Allocating is moving an offset through one block
+	reserved up front, and everything is freed at once by reset() at the start of the next frame, so transient arrays
+	cost no heap allocations and no frees. Nothing allocated here has its destructor run.
+	If a frame needs more than the capacity the rest comes from the heap (and is reported), raise the capacity then.
+	Sameer Al Harbi 2022
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class FrameAllocator
+{
+public:
+	FrameAllocator(size_t capacity);
+	~FrameAllocator();
+
+	void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+	//Uninitialised space for count objects of T
+	template <typename T>
+	T* allocate(size_t count)
+	{
+		return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+	}
+
+	//Free everything allocated since the last reset
+	void reset();
+
+	size_t used() const { return offset; }
+	size_t capacity() const { return size; }
+	size_t highWater; //Most used in one frame
+	uint64_t overflows; //Allocations that didn't fit and came from the heap
+
+private:
+	unsigned char* memory;
+	size_t size;
+	size_t offset;
+	std::vector<void*> overflowBlocks;
+};
@@ -0,0 +1,249 @@
+/*
+	Per pass GPU timer queries, see GpuTimer.h
+	Sameer Al Harbi 2022
+*/
+
+#include "GpuTimer.h"
+#include "Profiler.h"
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstring>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten/html5.h>
+#endif
+
+using namespace std;
+
+static const char* PASS_NAMES[NUM_GPU_PASSES] = { "skybox", "terrain", "props" };
+
+//Counter tracks in the profiler trace
+static const char* PASS_COUNTERS[NUM_GPU_PASSES] = { "GPU skybox", "GPU terrain", "GPU props" };
+
+struct GpuTimerQuery
+{
+	GLuint query;
+	GpuPass pass;
+};
+
+//Everything timed during one frame, read back when the slot comes round again
+struct GpuTimerFrame
+{
+	vector<GpuTimerQuery> queries;
+	double cpuMs[NUM_GPU_PASSES];
+	bool issued;
+};
+
+static GpuTimerFrame frames[GPU_TIMER_LATENCY + 1];
+static int currentFrame = 0;
+
+//Query objects are reused once read, a frame never creates new ones after the first few
+static vector<GLuint> freeQueries;
+
+static bool timerSupported = false;
+static int activePass = -1;
+static chrono::steady_clock::time_point passStart;
+
+static GpuPassTimes latestTimes;
+static GpuPassTimes totalTimes;
+static int cpuFrames = 0;
+static int gpuFrames = 0;
+static int droppedFrames = 0;
+
+bool GpuTimer::init()
+{
+#ifdef __EMSCRIPTEN__
+	//WebGL extensions have to be enabled before use, and glad doesn't know the _webgl2 name so loads nothing for it
+	EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context = emscripten_webgl_get_current_context();
+	if (context && emscripten_webgl_enable_extension(context, "EXT_disjoint_timer_query_webgl2"))
+	{
+		glad_glGetQueryObjectui64vEXT = (PFNGLGETQUERYOBJECTUI64VEXTPROC)glfwGetProcAddress("glGetQueryObjectui64vEXT");
+		timerSupported = glad_glGetQueryObjectui64vEXT != NULL;
+	}
+#else
+	timerSupported = GLAD_GL_EXT_disjoint_timer_query && glad_glGetQueryObjectui64vEXT && glad_glBeginQuery;
+	if (timerSupported)
+	{
+		//Implementations may expose the extension with a 0 bit counter, meaning no timer
+		GLint bits = 0;
+		glGetQueryiv(GL_TIME_ELAPSED_EXT, GL_QUERY_COUNTER_BITS_EXT, &bits);
+		timerSupported = bits > 0;
+	}
+#endif
+
+	cout << (timerSupported ? "GPU timer queries available" : "GPU timer queries unavailable, timing CPU only") << endl;
+	return timerSupported;
+}
+
+bool GpuTimer::supported()
+{
+	return timerSupported;
+}
+
+static void collect(GpuTimerFrame& frame)
+{
+	GpuPassTimes times;
+	memset(&times, 0, sizeof(times));
+	memcpy(times.cpuMs, frame.cpuMs, sizeof(times.cpuMs));
+
+	bool gpuValid = timerSupported && !frame.queries.empty();
+	if (gpuValid)
+	{
+		//A disjoint event (clock change, context switch...) makes every query in flight meaningless
+		GLint disjoint = 0;
+		glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+
+		//Queries finish in order, the last one being ready means they all are
+		GLuint available = 0;
+		glGetQueryObjectuiv(frame.queries.back().query, GL_QUERY_RESULT_AVAILABLE, &available);
+
+		gpuValid = !disjoint && available;
+		if (!gpuValid)
+		{
+			droppedFrames++;
+		}
+	}
+
+	for (size_t i = 0; i < frame.queries.size(); i++)
+	{
+		if (gpuValid)
+		{
+			GLuint64 ns = 0;
+			glGetQueryObjectui64vEXT(frame.queries[i].query, GL_QUERY_RESULT, &ns);
+			times.gpuMs[frame.queries[i].pass] += ns / 1000000.0;
+		}
+		freeQueries.push_back(frame.queries[i].query);
+	}
+
+	cpuFrames++;
+	for (int p = 0; p < NUM_GPU_PASSES; p++)
+	{
+		totalTimes.cpuMs[p] += times.cpuMs[p];
+		latestTimes.cpuMs[p] = times.cpuMs[p];
+	}
+
+	if (gpuValid)
+	{
+		gpuFrames++;
+		for (int p = 0; p < NUM_GPU_PASSES; p++)
+		{
+			totalTimes.gpuMs[p] += times.gpuMs[p];
+			latestTimes.gpuMs[p] = times.gpuMs[p];
+			Profiler::counter(PASS_COUNTERS[p], times.gpuMs[p]);
+		}
+	}
+}
+
+void GpuTimer::beginFrame()
+{
+	end();
+
+	currentFrame = (currentFrame + 1) % (GPU_TIMER_LATENCY + 1);
+	GpuTimerFrame& frame = frames[currentFrame];
+	if (frame.issued)
+	{
+		collect(frame);
+	}
+
+	frame.queries.clear();
+	memset(frame.cpuMs, 0, sizeof(frame.cpuMs));
+	frame.issued = true;
+}
+
+void GpuTimer::begin(GpuPass pass)
+{
+	end();
+
+	activePass = pass;
+	passStart = chrono::steady_clock::now();
+
+	if (timerSupported)
+	{
+		GLuint query;
+		if (freeQueries.empty())
+		{
+			glGenQueries(1, &query);
+		}
+		else
+		{
+			query = freeQueries.back();
+			freeQueries.pop_back();
+		}
+
+		glBeginQuery(GL_TIME_ELAPSED_EXT, query);
+		GpuTimerQuery timed = { query, pass };
+		frames[currentFrame].queries.push_back(timed);
+	}
+}
+
+void GpuTimer::end()
+{
+	if (activePass < 0)
+	{
+		return;
+	}
+
+	if (timerSupported)
+	{
+		glEndQuery(GL_TIME_ELAPSED_EXT);
+	}
+
+	frames[currentFrame].cpuMs[activePass] += chrono::duration<double, milli>(chrono::steady_clock::now() - passStart).count();
+	activePass = -1;
+}
+
+const GpuPassTimes& GpuTimer::latest()
+{
+	return latestTimes;
+}
+
+GpuPassTimes GpuTimer::average()
+{
+	GpuPassTimes times;
+	for (int p = 0; p < NUM_GPU_PASSES; p++)
+	{
+		times.cpuMs[p] = cpuFrames ? totalTimes.cpuMs[p] / cpuFrames : 0.0;
+		times.gpuMs[p] = gpuFrames ? totalTimes.gpuMs[p] / gpuFrames : 0.0;
+	}
+	return times;
+}
+
+void GpuTimer::resetStats()
+{
+	memset(&totalTimes, 0, sizeof(totalTimes));
+	cpuFrames = 0;
+	gpuFrames = 0;
+	droppedFrames = 0;
+}
+
+void GpuTimer::printStats()
+{
+	GpuPassTimes times = average();
+
+	cout << "Pass times per frame (CPU / GPU ms):";
+	for (int p = 0; p < NUM_GPU_PASSES; p++)
+	{
+		cout << (p ? ", " : " ") << PASS_NAMES[p] << " " << times.cpuMs[p] << " / ";
+		if (gpuFrames)
+		{
+			cout << times.gpuMs[p];
+		}
+		else
+		{
+			cout << "n/a";
+		}
+	}
+	cout << endl;
+
+	if (timerSupported)
+	{
+		cout << "GPU times from " << gpuFrames << " frames (" << droppedFrames << " dropped, read " << GPU_TIMER_LATENCY << " frames late)" << endl;
+	}
+}
+
+const char* GpuTimer::passName(GpuPass pass)
+{
+	return PASS_NAMES[pass];
+}
@@ -0,0 +1,54 @@
+/*
+	GPU time per render pass. Each begin()/end() pair is timed with a GL_TIME_ELAPSED query (EXT_disjoint_timer_query
+	natively, EXT_disjoint_timer_query_webgl2 on the web) and the CPU time between the same two calls is measured
+	alongside it. A pass can be entered several times a frame (terrain and props alternate per chunk), its times add up.
+	Queries are only read back GPU_TIMER_LATENCY frames after they were issued, by which point the GPU has finished
+	them, so timing never makes the CPU wait. Without the extension (or with the null renderer) only CPU times are kept.
+	Per-pass results are added to the profiler trace as counters and printed with the CPU times.
+	Sameer Al Harbi 2022
+*/
+#pragma once
+
+#include "wrapper_glfw.h"
+
+enum GpuPass
+{
+	GPU_PASS_SKYBOX,
+	GPU_PASS_TERRAIN,
+	GPU_PASS_PROPS,
+	NUM_GPU_PASSES
+};
+
+//Frames between issuing a frame's queries and reading them
+const int GPU_TIMER_LATENCY = 3;
+
+//Times for one frame, or averages over many
+struct GpuPassTimes
+{
+	double gpuMs[NUM_GPU_PASSES];
+	double cpuMs[NUM_GPU_PASSES];
+};
+
+namespace GpuTimer
+{
+	//Call once the context is current. Returns whether GPU times are available
+	bool init();
+	bool supported();
+
+	//Start of every frame, reads back the frame issued GPU_TIMER_LATENCY frames ago
+	void beginFrame();
+
+	//Time a pass until end(), passes can't nest
+	void begin(GpuPass pass);
+	void end();
+
+	//Newest frame read back
+	const GpuPassTimes& latest();
+
+	//Average per frame since the last reset
+	GpuPassTimes average();
+	void resetStats();
+	void printStats();
+
+	const char* passName(GpuPass pass);
+}
@@ -0,0 +1,135 @@
+/*
+	Offscreen EGL context, see HeadlessContext.h
+	Sameer Al Harbi 2022
+*/
+
+#ifndef __EMSCRIPTEN__
+
+#include "HeadlessContext.h"
+#include <EGL/eglext.h>
+#include <glad/glad.h>
+#include <iostream>
+#include <cstring>
+
+using namespace std;
+
+HeadlessContext::HeadlessContext()
+{
+	display = EGL_NO_DISPLAY;
+	context = EGL_NO_CONTEXT;
+	surface = EGL_NO_SURFACE;
+}
+
+HeadlessContext::~HeadlessContext()
+{
+	destroy();
+}
+
+//The surfaceless platform needs no X/Wayland connection or GPU device
+static EGLDisplay getDisplay()
+{
+	const char* extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	if (extensions && strstr(extensions, "EGL_MESA_platform_surfaceless"))
+	{
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay)
+		{
+			EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+			if (display != EGL_NO_DISPLAY)
+			{
+				return display;
+			}
+		}
+	}
+	return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+bool HeadlessContext::create(int width, int height)
+{
+	display = getDisplay();
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL))
+	{
+		cout << "Could not initialise an EGL display" << endl;
+		return false;
+	}
+
+	if (!eglBindAPI(EGL_OPENGL_ES_API))
+	{
+		cout << "EGL has no OpenGL ES support" << endl;
+		return false;
+	}
+
+	const EGLint configAttributes[] =
+	{
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_DEPTH_SIZE, 24,
+		EGL_NONE
+	};
+
+	EGLConfig config;
+	EGLint numConfigs = 0;
+	if (!eglChooseConfig(display, configAttributes, &config, 1, &numConfigs) || numConfigs == 0)
+	{
+		cout << "No EGL config with OpenGL ES 3 and pbuffer support" << endl;
+		return false;
+	}
+
+	const EGLint surfaceAttributes[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+	surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+	if (surface == EGL_NO_SURFACE)
+	{
+		cout << "Could not create a " << width << "x" << height << " pbuffer" << endl;
+		return false;
+	}
+
+	//Same version the web build gets through WebGL 2
+	const EGLint contextAttributes[] = { EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 0, EGL_NONE };
+	context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+	if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, surface, surface, context))
+	{
+		cout << "Could not create an OpenGL ES 3.0 context" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool HeadlessContext::makeCurrent(bool current)
+{
+	bool done = current ? eglMakeCurrent(display, surface, surface, context)
+		: eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (!done)
+	{
+		cout << "eglMakeCurrent failed (" << hex << eglGetError() << dec << ")" << endl;
+	}
+	return done;
+}
+
+void HeadlessContext::destroy()
+{
+	if (display == EGL_NO_DISPLAY)
+	{
+		return;
+	}
+
+	eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (context != EGL_NO_CONTEXT) eglDestroyContext(display, context);
+	if (surface != EGL_NO_SURFACE) eglDestroySurface(display, surface);
+	eglTerminate(display);
+
+	display = EGL_NO_DISPLAY;
+	context = EGL_NO_CONTEXT;
+	surface = EGL_NO_SURFACE;
+}
+
+void HeadlessContext::swapBuffers()
+{
+	//Pbuffers aren't presented, finishing keeps frame timings honest instead of measuring how fast commands queue up
+	glFinish();
+}
+
+#endif
@@ -0,0 +1,35 @@
+/*
+	Offscreen OpenGL ES 3 context for running without a window (native builds only).
+	Uses EGL with Mesa's surfaceless platform when it's there, so it works on a Linux box with no GPU or display
+	server through llvmpipe, otherwise the default EGL display. Frames render into a pbuffer the size of the
+	would-be window, so the default framebuffer behaves the same as it does with a GLFW window.
+	Sameer Al Harbi 2022
+*/
+#pragma once
+
+#ifndef __EMSCRIPTEN__
+
+#include <EGL/egl.h>
+
+class HeadlessContext
+{
+public:
+	HeadlessContext();
+	~HeadlessContext();
+
+	//Create the context and pbuffer and make them current. False if EGL or an ES 3 config isn't available
+	bool create(int width, int height);
+	void destroy();
+
+	//Nothing is presented, this only makes sure the frame has finished
+	void swapBuffers();
+
+	//Bind the context and pbuffer to the calling thread, or release them from it
+	bool makeCurrent(bool current);
+
+	EGLDisplay display;
+	EGLContext context;
+	EGLSurface surface;
+};
+
+#endif
@@ -0,0 +1,174 @@
+/*
+	Loader for GPU compressed textures stored in KTX 1.1 containers, see KTXTexture.h
+	Sameer Al Harbi 2022
+*/
+
+#include "KTXTexture.h"
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten/html5.h>
+#endif
+
+using namespace std;
+
+KTXTexture::KTXTexture()
+{
+	internalFormat = 0;
+	width = 0;
+	height = 0;
+	numFaces = 0;
+	numLayers = 0;
+}
+
+bool KTXTexture::parse(const AssetData& file)
+{
+	levels.clear();
+
+	const unsigned char* data = file.data();
+	size_t size = file.size();
+
+	KTXHeader header;
+	if (size < sizeof(header))
+	{
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+
+	//Only little endian, compressed 2D textures, cube maps and 2D arrays are produced by the converter
+	if (memcmp(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0 || header.endianness != KTX_ENDIANNESS ||
+		header.glType != 0 || header.pixelDepth > 1 || (header.numberOfFaces != 1 && header.numberOfFaces != 6) ||
+		(header.numberOfArrayElements > 0 && header.numberOfFaces != 1))
+	{
+		return false;
+	}
+
+	internalFormat = header.glInternalFormat;
+	width = header.pixelWidth;
+	height = header.pixelHeight;
+	numFaces = header.numberOfFaces;
+	numLayers = header.numberOfArrayElements;
+
+	uint32_t numLevels = header.numberOfMipmapLevels > 0 ? header.numberOfMipmapLevels : 1;
+
+	//No more levels than it takes to halve the larger side down to 1, floor(log2(max(width, height))) + 1
+	uint32_t maxLevels = 1;
+	for (uint32_t side = max(width, height); side > 1; side >>= 1)
+	{
+		maxLevels++;
+	}
+	if (numLevels > maxLevels)
+	{
+		return false;
+	}
+	size_t offset = sizeof(header) + header.bytesOfKeyValueData;
+
+	for (uint32_t i = 0; i < numLevels; i++)
+	{
+		if (offset + 4 > size)
+		{
+			return false;
+		}
+
+		Level level;
+		memcpy(&level.imageSize, data + offset, 4);
+		offset += 4;
+		level.width = max(width >> i, 1u);
+		level.height = max(height >> i, 1u);
+
+		for (uint32_t f = 0; f < numFaces; f++)
+		{
+			if (offset + level.imageSize > size)
+			{
+				return false;
+			}
+			level.faces[f] = data + offset;
+
+			//Each face (and so each level) is padded to 4 bytes
+			offset += (level.imageSize + 3) & ~3u;
+		}
+
+		levels.push_back(level);
+	}
+
+	return true;
+}
+
+bool KTXTexture::isSupported()
+{
+	return compressedFormatSupported(internalFormat);
+}
+
+bool KTXTexture::isCubeMap()
+{
+	return numFaces == 6;
+}
+
+bool KTXTexture::isArray()
+{
+	return numLayers > 0;
+}
+
+void KTXTexture::upload()
+{
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		const Level& level = levels[i];
+		if (isArray())
+		{
+			glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, (GLint)i, internalFormat, level.width, level.height, numLayers, 0, level.imageSize, level.faces[0]);
+			continue;
+		}
+
+		for (uint32_t f = 0; f < numFaces; f++)
+		{
+			GLenum target = isCubeMap() ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + f : GL_TEXTURE_2D;
+			glCompressedTexImage2D(target, (GLint)i, internalFormat, level.width, level.height, 0, level.imageSize, level.faces[f]);
+		}
+	}
+}
+
+size_t KTXTexture::dataSize()
+{
+	size_t bytes = 0;
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		bytes += (size_t)levels[i].imageSize * (isArray() ? 1 : numFaces);
+	}
+	return bytes;
+}
+
+bool compressedFormatSupported(GLenum format)
+{
+	static vector<GLint> formats;
+	static bool queried = false;
+
+	if (!queried)
+	{
+		queried = true;
+
+#ifdef __EMSCRIPTEN__
+		//WebGL only exposes ETC2 formats once the extension has been enabled
+		emscripten_webgl_enable_extension(emscripten_webgl_get_current_context(), "WEBGL_compressed_texture_etc");
+#endif
+
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+		if (count > 0)
+		{
+			formats.resize(count);
+			glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, &formats[0]);
+		}
+	}
+
+	for (size_t i = 0; i < formats.size(); i++)
+	{
+		if ((GLenum)formats[i] == format)
+		{
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,76 @@
+/*
+	Loader for GPU compressed textures stored in KTX 1.1 containers (https://registry.khronos.org/KTX/specs/1.0/ktxspec.v1.html).
+	The files are produced offline by tools/etc2_converter with ETC2/EAC data and a full pre-built mip chain, so the
+	runtime only has to hand each level to glCompressedTexImage2D - no image decoding and 4-6x less VRAM than RGB(A)8.
+	Plain 2D textures, cube maps (6 faces) and 2D array textures are supported.
+	Sameer Al Harbi 2022
+*/
+#pragma once
+
+#include "wrapper_glfw.h"
+#include "AssetPack.h"
+#include <vector>
+#include <cstdint>
+
+const unsigned char KTX_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+const uint32_t KTX_ENDIANNESS = 0x04030201;
+
+struct KTXHeader
+{
+	unsigned char identifier[12];
+	uint32_t endianness;
+	uint32_t glType;
+	uint32_t glTypeSize;
+	uint32_t glFormat;
+	uint32_t glInternalFormat;
+	uint32_t glBaseInternalFormat;
+	uint32_t pixelWidth;
+	uint32_t pixelHeight;
+	uint32_t pixelDepth;
+	uint32_t numberOfArrayElements;
+	uint32_t numberOfFaces;
+	uint32_t numberOfMipmapLevels;
+	uint32_t bytesOfKeyValueData;
+};
+
+/*
+	Parsed view of a KTX file. Image pointers point into the AssetData the file was parsed from,
+	so that must outlive this object
+*/
+class KTXTexture
+{
+public:
+	struct Level
+	{
+		uint32_t width;
+		uint32_t height;
+		uint32_t imageSize; //Bytes of one face, or of all layers for array textures
+		const unsigned char* faces[6]; //Array textures only use faces[0], layers are stored one after another
+	};
+
+	KTXTexture();
+
+	bool parse(const AssetData& file);
+
+	//True if the current context can sample this texture's format
+	bool isSupported();
+
+	//Upload every level into the currently bound GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP or GL_TEXTURE_2D_ARRAY
+	void upload();
+
+	//Bytes upload() sends, every level, face and layer
+	size_t dataSize();
+
+	bool isCubeMap();
+	bool isArray();
+
+	GLenum internalFormat;
+	uint32_t width;
+	uint32_t height;
+	uint32_t numFaces;
+	uint32_t numLayers; //0 when not an array texture
+	std::vector<Level> levels;
+};
+
+//Returns true if the context lists format among its supported compressed texture formats
+bool compressedFormatSupported(GLenum format);
@@ -0,0 +1,193 @@
+/*
+	Minimal LZ4 block format codec used by the asset pack.
+	The compressor is a straightforward greedy matcher with a single hash table, it is only run offline by
+	tools/asset_packer so it favours simplicity over speed. The decompressor is what runs at startup.
+	Sameer Al Harbi 2022
+*/
+
+#include "LZ4Block.h"
+#include <cstring>
+#include <cstdint>
+
+namespace
+{
+	const size_t MINMATCH = 4;
+	const size_t LASTLITERALS = 5; // Last 5 bytes of a block are always literals
+	const size_t MFLIMIT = 12; // Last match must start at least 12 bytes before the end of a block
+	const size_t MAX_DISTANCE = 65535;
+	const int HASH_LOG = 16;
+
+	uint32_t read32(const unsigned char* p)
+	{
+		uint32_t v;
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	uint32_t hash4(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HASH_LOG);
+	}
+
+	// Lengths of 15 or more spill over into extra bytes of 255 terminated by a smaller byte
+	void writeLength(std::vector<unsigned char>& dst, size_t length)
+	{
+		while (length >= 255)
+		{
+			dst.push_back(255);
+			length -= 255;
+		}
+		dst.push_back((unsigned char)length);
+	}
+
+	void writeSequence(std::vector<unsigned char>& dst, const unsigned char* literals, size_t literalLength, size_t offset, size_t matchLength)
+	{
+		size_t tokenPos = dst.size();
+		dst.push_back(0);
+
+		unsigned char token = 0;
+		if (literalLength >= 15)
+		{
+			token = 15 << 4;
+			writeLength(dst, literalLength - 15);
+		}
+		else
+		{
+			token = (unsigned char)(literalLength << 4);
+		}
+		dst.insert(dst.end(), literals, literals + literalLength);
+
+		//Final sequence of a block only has literals
+		if (matchLength > 0)
+		{
+			dst.push_back((unsigned char)(offset & 0xFF));
+			dst.push_back((unsigned char)(offset >> 8));
+
+			size_t ml = matchLength - MINMATCH;
+			if (ml >= 15)
+			{
+				token |= 15;
+				writeLength(dst, ml - 15);
+			}
+			else
+			{
+				token |= (unsigned char)ml;
+			}
+		}
+
+		dst[tokenPos] = token;
+	}
+}
+
+size_t LZ4Block::compressBound(size_t inputSize)
+{
+	return inputSize + (inputSize / 255) + 16;
+}
+
+bool LZ4Block::compress(const unsigned char* src, size_t srcSize, std::vector<unsigned char>& dst)
+{
+	dst.clear();
+	dst.reserve(compressBound(srcSize));
+
+	size_t anchor = 0;
+
+	if (srcSize > MFLIMIT)
+	{
+		//Positions are stored +1 so that 0 means empty slot
+		std::vector<uint32_t> table((size_t)1 << HASH_LOG, 0);
+
+		const size_t matchLimit = srcSize - MFLIMIT;
+		const size_t matchEnd = srcSize - LASTLITERALS;
+
+		size_t ip = 0;
+		while (ip < matchLimit)
+		{
+			uint32_t sequence = read32(src + ip);
+			uint32_t h = hash4(sequence);
+			size_t ref = table[h];
+			table[h] = (uint32_t)(ip + 1);
+
+			if (ref == 0 || ip - (ref - 1) > MAX_DISTANCE || read32(src + ref - 1) != sequence)
+			{
+				ip++;
+				continue;
+			}
+			ref--;
+
+			size_t length = MINMATCH;
+			while (ip + length < matchEnd && src[ref + length] == src[ip + length])
+			{
+				length++;
+			}
+
+			writeSequence(dst, src + anchor, ip - anchor, ip - ref, length);
+			ip += length;
+			anchor = ip;
+		}
+	}
+
+	writeSequence(dst, src + anchor, srcSize - anchor, 0, 0);
+
+	return dst.size() < srcSize;
+}
+
+bool LZ4Block::decompress(const unsigned char* src, size_t srcSize, unsigned char* dst, size_t dstSize)
+{
+	size_t ip = 0;
+	size_t op = 0;
+
+	while (ip < srcSize)
+	{
+		unsigned char token = src[ip++];
+
+		size_t literalLength = token >> 4;
+		if (literalLength == 15)
+		{
+			unsigned char b;
+			do
+			{
+				if (ip >= srcSize) return false;
+				b = src[ip++];
+				literalLength += b;
+			} while (b == 255);
+		}
+
+		if (ip + literalLength > srcSize || op + literalLength > dstSize) return false;
+		memcpy(dst + op, src + ip, literalLength);
+		ip += literalLength;
+		op += literalLength;
+
+		//Last sequence has no match part
+		if (ip == srcSize) break;
+
+		if (ip + 2 > srcSize) return false;
+		size_t offset = src[ip] | (src[ip + 1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > op) return false;
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15)
+		{
+			unsigned char b;
+			do
+			{
+				if (ip >= srcSize) return false;
+				b = src[ip++];
+				matchLength += b;
+			} while (b == 255);
+		}
+		matchLength += MINMATCH;
+
+		if (op + matchLength > dstSize) return false;
+
+		//Matches can overlap the bytes being written so copy forwards one byte at a time
+		const unsigned char* match = dst + op - offset;
+		for (size_t i = 0; i < matchLength; i++)
+		{
+			dst[op + i] = match[i];
+		}
+		op += matchLength;
+	}
+
+	return op == dstSize;
+}
@@ -0,0 +1,23 @@
+/*
+	Minimal LZ4 block format codec used by the asset pack.
+	Only the raw block format is implemented (no frame header / checksums), which is all the pack needs
+	since every entry stores its own compressed and uncompressed sizes in the table of contents.
+	Format reference: https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+	Sameer Al Harbi 2022
+*/
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace LZ4Block
+{
+	// Worst case size of a compressed block for an input of inputSize bytes
+	size_t compressBound(size_t inputSize);
+
+	// Greedy single pass compressor, output is a valid LZ4 block. Returns false if input could not be compressed
+	bool compress(const unsigned char* src, size_t srcSize, std::vector<unsigned char>& dst);
+
+	// Bounds checked decompressor. dstSize must be the exact uncompressed size. Returns false on malformed input
+	bool decompress(const unsigned char* src, size_t srcSize, unsigned char* dst, size_t dstSize);
+}
@@ -0,0 +1,132 @@
+/*
+	Memory accounting, see MemoryTracker.h
+	Sameer Al Harbi 2022
+*/
+
+#include "MemoryTracker.h"
+#include "Profiler.h"
+#include <unordered_map>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+//Buffers, textures and renderbuffers have separate names, the kind goes in the top bits of the key
+enum GLObjectKind { GL_OBJECT_BUFFER, GL_OBJECT_TEXTURE, GL_OBJECT_RENDERBUFFER };
+
+struct TrackedObject
+{
+	MemoryCategory category;
+	size_t bytes;
+};
+
+static unordered_map<uint64_t, TrackedObject> objects;
+static uint64_t gpu[NUM_MEMORY_CATEGORIES];
+static uint64_t cpuMemory[NUM_MEMORY_CATEGORIES];
+
+static const char* categoryNames[NUM_MEMORY_CATEGORIES] = { "terrain", "props", "textures", "skybox", "render targets" };
+
+//Counter names for the profiler, which keeps the pointers
+static const char* gpuCounterNames[NUM_MEMORY_CATEGORIES] = { "GPU MB terrain", "GPU MB props", "GPU MB textures", "GPU MB skybox", "GPU MB render targets" };
+static const char* cpuCounterNames[NUM_MEMORY_CATEGORIES] = { "CPU MB terrain", "CPU MB props", "CPU MB textures", "CPU MB skybox", "CPU MB render targets" };
+
+static void track(GLObjectKind kind, GLuint name, MemoryCategory category, size_t bytes)
+{
+	uint64_t key = ((uint64_t)kind << 32) | name;
+	unordered_map<uint64_t, TrackedObject>::iterator it = objects.find(key);
+	if (it != objects.end())
+	{
+		//Empty objects keep their entry at 0 bytes, filling them later (a chunk reusing a buffer) mustn't allocate
+		gpu[it->second.category] -= it->second.bytes;
+		it->second.category = category;
+		it->second.bytes = bytes;
+	}
+	else
+	{
+		TrackedObject object = { category, bytes };
+		objects[key] = object;
+	}
+	gpu[category] += bytes;
+}
+
+void MemoryTracker::buffer(GLuint name, MemoryCategory category, size_t bytes)
+{
+	track(GL_OBJECT_BUFFER, name, category, bytes);
+}
+
+void MemoryTracker::texture(GLuint name, MemoryCategory category, size_t bytes)
+{
+	track(GL_OBJECT_TEXTURE, name, category, bytes);
+}
+
+void MemoryTracker::renderbuffer(GLuint name, MemoryCategory category, size_t bytes)
+{
+	track(GL_OBJECT_RENDERBUFFER, name, category, bytes);
+}
+
+void MemoryTracker::cpu(MemoryCategory category, int64_t bytes)
+{
+	cpuMemory[category] += bytes;
+}
+
+uint64_t MemoryTracker::gpuBytes(MemoryCategory category)
+{
+	return gpu[category];
+}
+
+uint64_t MemoryTracker::cpuBytes(MemoryCategory category)
+{
+	return cpuMemory[category];
+}
+
+uint64_t MemoryTracker::totalGpuBytes()
+{
+	uint64_t total = 0;
+	for (int i = 0; i < NUM_MEMORY_CATEGORIES; i++)
+	{
+		total += gpu[i];
+	}
+	return total;
+}
+
+uint64_t MemoryTracker::totalCpuBytes()
+{
+	uint64_t total = 0;
+	for (int i = 0; i < NUM_MEMORY_CATEGORIES; i++)
+	{
+		total += cpuMemory[i];
+	}
+	return total;
+}
+
+void MemoryTracker::recordCounters()
+{
+	if (!Profiler::enabled())
+	{
+		return;
+	}
+
+	for (int i = 0; i < NUM_MEMORY_CATEGORIES; i++)
+	{
+		Profiler::counter(gpuCounterNames[i], gpu[i] / (1024.0 * 1024.0));
+		if (cpuMemory[i])
+		{
+			Profiler::counter(cpuCounterNames[i], cpuMemory[i] / (1024.0 * 1024.0));
+		}
+	}
+}
+
+void MemoryTracker::print()
+{
+	cout << "Memory (KB)          GPU        CPU" << endl;
+	for (int i = 0; i < NUM_MEMORY_CATEGORIES; i++)
+	{
+		cout << left << setw(16) << categoryNames[i] << right << setw(10) << gpu[i] / 1024 << " " << setw(10) << cpuMemory[i] / 1024 << endl;
+	}
+	cout << left << setw(16) << "total" << right << setw(10) << totalGpuBytes() / 1024 << " " << setw(10) << totalCpuBytes() / 1024 << endl;
+}
+
+const char* MemoryTracker::categoryName(MemoryCategory category)
+{
+	return categoryNames[category];
+}
@@ -0,0 +1,45 @@
+/*
+	Live GPU and CPU memory by category. Every GL buffer, texture and renderbuffer allocation reports its size here
+	(by object name, so re-uploading replaces the old size and deleting with 0 bytes frees it), and CPU-side chunk data
+	reports changes in bytes. GPU sizes are what was asked for, drivers may pad or keep extra copies.
+	Totals can be printed at any time (U while running, and on exit) and are added to profiler traces as counters.
+	Only call it from the thread the GL context is current on.
+	Sameer Al Harbi 2022
+*/
+#pragma once
+
+#include "wrapper_glfw.h"
+#include <cstdint>
+#include <cstddef>
+
+enum MemoryCategory
+{
+	MEMORY_TERRAIN, //Chunk instance data and the block mesh
+	MEMORY_PROPS, //Tree models
+	MEMORY_TEXTURES, //Block texture array and the model atlas
+	MEMORY_SKYBOX, //Cube mesh and cube map
+	MEMORY_RENDER_TARGETS, //MSAA framebuffer
+	NUM_MEMORY_CATEGORIES
+};
+
+namespace MemoryTracker
+{
+	//Size of a GL object's storage, replacing what was recorded for it before. 0 bytes when it's deleted
+	void buffer(GLuint name, MemoryCategory category, size_t bytes);
+	void texture(GLuint name, MemoryCategory category, size_t bytes);
+	void renderbuffer(GLuint name, MemoryCategory category, size_t bytes);
+
+	//CPU memory allocated (positive) or freed (negative)
+	void cpu(MemoryCategory category, int64_t bytes);
+
+	uint64_t gpuBytes(MemoryCategory category);
+	uint64_t cpuBytes(MemoryCategory category);
+	uint64_t totalGpuBytes();
+	uint64_t totalCpuBytes();
+
+	//Add every category to the profiler trace, once a frame
+	void recordCounters();
+
+	void print();
+	const char* categoryName(MemoryCategory category);
+}
@@ -13,8 +13,11 @@ Iain Martin November 2018
 */
 
 #include "tiny_loader_texture.h"
+#include "../AssetPack.h"
+#include "../MemoryTracker.h"
 #include <iostream>
 #include <stdio.h>
+#include <streambuf>
 
 //Tinyobjloader library used to import models
 #ifndef TINYOBJLOADER_IMPLEMENTATION
@@ -30,6 +33,16 @@ static  void PrintInfo(const tinyobj::attrib_t& attrib,
 	const vector<tinyobj::shape_t>& shapes,
 	const vector<tinyobj::material_t>& materials); 
 
+// Read only stream buffer over an asset already in memory so tinyobj can parse it without a copy
+struct AssetStreamBuf : public std::streambuf
+{
+	AssetStreamBuf(const AssetData& asset)
+	{
+		char* begin = (char*)asset.data();
+		setg(begin, begin, begin + asset.size());
+	}
+};
+
 TinyObjLoader::TinyObjLoader()
 {
 	attribute_v_coord = 0;
@@ -52,6 +65,16 @@ TinyObjLoader::~TinyObjLoader()
 
 
 void TinyObjLoader::load_obj(string inputfile, bool debugPrint)
+{
+	ObjMeshData mesh;
+	if (!parse_obj(inputfile, mesh, debugPrint)) {
+		cout << "Something went work, EXIT 1" << endl;
+		exit(1);
+	}
+	upload(mesh);
+}
+
+bool TinyObjLoader::parse_obj(const string& inputfile, ObjMeshData& mesh, bool debugPrint)
 {
 	tinyobj::attrib_t attrib;
 	vector<tinyobj::shape_t> shapes;
@@ -59,7 +82,19 @@ void TinyObjLoader::load_obj(string inputfile, bool debugPrint)
 
 
 	string err, warn;
-	bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &err, &warn, inputfile.c_str());
+	bool ret = false;
+
+	AssetData file;
+	if (AssetPack::instance().read(inputfile, file))
+	{
+		AssetStreamBuf buffer(file);
+		istream stream(&buffer);
+		ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, &stream);
+	}
+	else
+	{
+		err = "Could not read " + inputfile;
+	}
 
 	if (!err.empty()) { // `err` may contain error messages.
 		cerr << err << endl;
@@ -70,22 +105,26 @@ void TinyObjLoader::load_obj(string inputfile, bool debugPrint)
 	}
 
 	if (!ret) {
-		cout << "Something went work, EXIT 1" << endl;
-		exit(1);
+		return false;
+	}
+
+	if (debugPrint) {
+		PrintInfo(attrib, shapes, materials);
 	}
 
 	// Calculate the number of vertices from the shapes
-	numVertices = 0;
+	size_t numVertices = 0;
 	for (size_t s = 0; s < shapes.size(); s++) {
 		numVertices += shapes[s].mesh.num_face_vertices.size() * 3;//3 vertexes for each face
 	}
 
-	numNormals = numTexCoords = numVertices;
-
 	//have to duplicate vertices (glDrawElements not possible) because of texture
-	std::vector<tinyobj::real_t> pVertices(numVertices * 3);
-	std::vector<tinyobj::real_t> pTextureCoords(numVertices * 2);
-	std::vector<tinyobj::real_t> pNormals(numVertices * 3);
+	std::vector<tinyobj::real_t>& pVertices = mesh.vertices;
+	std::vector<tinyobj::real_t>& pTextureCoords = mesh.texCoords;
+	std::vector<tinyobj::real_t>& pNormals = mesh.normals;
+	pVertices.assign(numVertices * 3, 0);
+	pTextureCoords.assign(numVertices * 2, 0);
+	pNormals.assign(numVertices * 3, 0);
 
 	GLuint ind = 0;
 	for (size_t s = 0; s < shapes.size(); s++) {
@@ -121,26 +160,46 @@ void TinyObjLoader::load_obj(string inputfile, bool debugPrint)
 		}
 	}
 
+	return true;
+}
+
+void TinyObjLoader::upload(const ObjMeshData& mesh)
+{
+	numVertices = (GLuint)(mesh.vertices.size() / 3);
+	numNormals = numTexCoords = numVertices;
+
+	if (numVertices == 0) {
+		return;
+	}
+
 	// Copy the vertix, normal and textcoord data into OpenGL buffers
 	glGenBuffers(1, &positionBufferObject);
 	glBindBuffer(GL_ARRAY_BUFFER, positionBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, pVertices.size() * sizeof(tinyobj::real_t), &pVertices.front(), GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(float), &mesh.vertices.front(), GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
 	glGenBuffers(1, &normalBufferObject);
 	glBindBuffer(GL_ARRAY_BUFFER, normalBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, pNormals.size() * sizeof(tinyobj::real_t), &pNormals.front(), GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, mesh.normals.size() * sizeof(float), &mesh.normals.front(), GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
 	glGenBuffers(1, &texCoordsObject);
 	glBindBuffer(GL_ARRAY_BUFFER, texCoordsObject);
-	glBufferData(GL_ARRAY_BUFFER, pTextureCoords.size() * sizeof(tinyobj::real_t), &pTextureCoords.front(), GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, mesh.texCoords.size() * sizeof(float), &mesh.texCoords.front(), GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	MemoryTracker::buffer(positionBufferObject, MEMORY_PROPS, mesh.vertices.size() * sizeof(float));
+	MemoryTracker::buffer(normalBufferObject, MEMORY_PROPS, mesh.normals.size() * sizeof(float));
+	MemoryTracker::buffer(texCoordsObject, MEMORY_PROPS, mesh.texCoords.size() * sizeof(float));
 }
 
 
 void TinyObjLoader::drawObject(int drawmode)
 {
+	// Nothing to draw until the model has finished loading
+	if (numVertices == 0) {
+		return;
+	}
 
 	/* Draw the object as GL_POINTS */
 	glBindBuffer(GL_ARRAY_BUFFER, positionBufferObject);
@@ -11,6 +11,14 @@ Iain Martin November 2018
 #include <vector>
 #include <glm/glm.hpp>
 
+// CPU side copy of an obj with vertices duplicated per face, ready to be copied into buffers
+struct ObjMeshData
+{
+	std::vector<float> vertices;
+	std::vector<float> normals;
+	std::vector<float> texCoords;
+};
+
 class TinyObjLoader
 {
 public:
@@ -20,6 +28,10 @@ public:
 	void load_obj(std::string inputfile, bool debugPrint = false);
 	void drawObject(int drawmode);
 
+	// Parsing doesn't touch GL so it can run on any thread, upload must run on the GL thread
+	static bool parse_obj(const std::string& inputfile, ObjMeshData& mesh, bool debugPrint = false);
+	void upload(const ObjMeshData& mesh);
+
 private:
 	// Define vertex buffer object names (e.g as globals)
 	GLuint positionBufferObject;
@@ -0,0 +1,157 @@
+/*
+	Multisampled render target, see MultisampleTarget.h
+	Sameer Al Harbi 2022
+*/
+
+#include "MultisampleTarget.h"
+#include "MemoryTracker.h"
+#include <iostream>
+
+using namespace std;
+
+MultisampleTarget::MultisampleTarget()
+{
+	framebuffer = 0;
+	colour = 0;
+	depth = 0;
+	width = 0;
+	height = 0;
+	requestedSamples = 0;
+	activeSamples = 0;
+	maxSamples = -1;
+	colourFormat = GL_RGBA8;
+	resolveFramebuffer = 0;
+	resolveColour = 0;
+	resolveChecked = false;
+}
+
+void MultisampleTarget::begin(int width, int height, int samples)
+{
+	if (maxSamples < 0)
+	{
+		glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+
+		//Resolving straight into the window needs the same colour format it has
+		GLint redBits = 0, alphaBits = 0;
+		glGetIntegerv(GL_RED_BITS, &redBits);
+		glGetIntegerv(GL_ALPHA_BITS, &alphaBits);
+		colourFormat = redBits < 8 ? GL_RGB565 : (alphaBits > 0 ? GL_RGBA8 : GL_RGB8);
+	}
+
+	if (samples > maxSamples)
+	{
+		samples = maxSamples;
+	}
+
+	if (width != this->width || height != this->height || samples != requestedSamples)
+	{
+		release();
+		this->width = width;
+		this->height = height;
+		requestedSamples = samples;
+		if (samples > 1 && !allocate())
+		{
+			cout << "Could not create a " << samples << "x multisampled framebuffer, rendering without MSAA" << endl;
+			release();
+		}
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, width, height);
+}
+
+void MultisampleTarget::resolve()
+{
+	if (framebuffer == 0)
+	{
+		return;
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+
+	if (resolveFramebuffer)
+	{
+		//Resolve into a single sampled copy first, blits between those can convert formats
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolveFramebuffer);
+		glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, resolveFramebuffer);
+	}
+	else if (!resolveChecked)
+	{
+		//Only checked once per allocation, glGetError waits for the GPU on some platforms
+		while (glGetError() != GL_NO_ERROR);
+	}
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+	//Some windows have a format no renderbuffer matches (e.g. an EGL pbuffer without alpha that's really RGBX)
+	if (!resolveChecked)
+	{
+		resolveChecked = true;
+		if (glGetError() == GL_INVALID_OPERATION && resolveFramebuffer == 0)
+		{
+			cout << "Window framebuffer format can't be resolved into directly, resolving MSAA through a copy" << endl;
+			glGenRenderbuffers(1, &resolveColour);
+			glBindRenderbuffer(GL_RENDERBUFFER, resolveColour);
+			glRenderbufferStorage(GL_RENDERBUFFER, colourFormat, width, height);
+			glBindRenderbuffer(GL_RENDERBUFFER, 0);
+			MemoryTracker::renderbuffer(resolveColour, MEMORY_RENDER_TARGETS, (size_t)width * height * pixelBytes());
+
+			glGenFramebuffers(1, &resolveFramebuffer);
+			glBindFramebuffer(GL_FRAMEBUFFER, resolveFramebuffer);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, resolveColour);
+			resolveChecked = false;
+		}
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+bool MultisampleTarget::allocate()
+{
+	glGenRenderbuffers(1, &colour);
+	glBindRenderbuffer(GL_RENDERBUFFER, colour);
+	glRenderbufferStorageMultisample(GL_RENDERBUFFER, requestedSamples, colourFormat, width, height);
+
+	glGenRenderbuffers(1, &depth);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth);
+	glRenderbufferStorageMultisample(GL_RENDERBUFFER, requestedSamples, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	size_t samplesBytes = (size_t)width * height * requestedSamples;
+	MemoryTracker::renderbuffer(colour, MEMORY_RENDER_TARGETS, samplesBytes * pixelBytes());
+	MemoryTracker::renderbuffer(depth, MEMORY_RENDER_TARGETS, samplesBytes * 4);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colour);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+	bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	activeSamples = complete ? requestedSamples : 0;
+	return complete;
+}
+
+//Drivers store 24 bit colour padded to 32
+int MultisampleTarget::pixelBytes() const
+{
+	return colourFormat == GL_RGB565 ? 2 : 4;
+}
+
+void MultisampleTarget::release()
+{
+	MemoryTracker::renderbuffer(colour, MEMORY_RENDER_TARGETS, 0);
+	MemoryTracker::renderbuffer(depth, MEMORY_RENDER_TARGETS, 0);
+	MemoryTracker::renderbuffer(resolveColour, MEMORY_RENDER_TARGETS, 0);
+
+	if (framebuffer) glDeleteFramebuffers(1, &framebuffer);
+	if (colour) glDeleteRenderbuffers(1, &colour);
+	if (depth) glDeleteRenderbuffers(1, &depth);
+	if (resolveFramebuffer) glDeleteFramebuffers(1, &resolveFramebuffer);
+	if (resolveColour) glDeleteRenderbuffers(1, &resolveColour);
+	framebuffer = colour = depth = resolveFramebuffer = resolveColour = 0;
+	activeSamples = 0;
+	resolveChecked = false;
+}
@@ -0,0 +1,45 @@
+/*
+	Multisampled offscreen framebuffer the scene is drawn into and then resolved (glBlitFramebuffer) to the window.
+	A window's own sample count is fixed when it's created (GLFW_SAMPLES), rendering through this instead lets the MSAA
+	level change while running. With 0 samples nothing is allocated and frames are drawn straight to the window.
+	The sample count is clamped to GL_MAX_SAMPLES, so it's also 0 with the null renderer.
+	Sameer Al Harbi 2022
+*/
+#pragma once
+
+#include "wrapper_glfw.h"
+
+class MultisampleTarget
+{
+public:
+	MultisampleTarget();
+
+	//Bind the framebuffer the frame is drawn into, (re)allocated whenever the size or sample count changes
+	void begin(int width, int height, int samples);
+
+	//Copy the frame to the window's framebuffer, which is left bound
+	void resolve();
+
+	//Samples actually in use, after clamping or a failed allocation
+	int samples() const { return activeSamples; }
+
+private:
+	bool allocate();
+	void release();
+	int pixelBytes() const;
+
+	GLuint framebuffer;
+	GLuint colour;
+	GLuint depth;
+
+	//Single sampled copy for windows that can't be resolved into directly, 0 when it isn't needed
+	GLuint resolveFramebuffer;
+	GLuint resolveColour;
+	bool resolveChecked; //Whether resolving has been tried since the last allocation
+	int width;
+	int height;
+	int requestedSamples;
+	int activeSamples;
+	int maxSamples; //-1 until queried
+	GLenum colourFormat; //Matches the window's
+};
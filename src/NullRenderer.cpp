@@ -0,0 +1,247 @@
+/*
+	Counting no-op GL functions, see NullRenderer.h
+	Functions the engine doesn't use are left NULL, so a new GL call crashes in null mode until a stub is added here.
+	Sameer Al Harbi 2022
+*/
+
+#include "NullRenderer.h"
+#include <iostream>
+
+using namespace std;
+
+static RenderCallCounts renderCalls;
+static bool nullInstalled = false;
+
+//Names handed out by glGen*/glCreate*, never reused
+static GLuint nextName = 1;
+
+static void genNames(GLsizei n, GLuint* names)
+{
+	renderCalls.calls++;
+	for (GLsizei i = 0; i < n; i++)
+	{
+		names[i] = nextName++;
+	}
+}
+
+static uint64_t pixelBytes(GLsizei width, GLsizei height, GLsizei depth, GLenum format)
+{
+	return (uint64_t)width * height * depth * (format == GL_RGB ? 3 : 4);
+}
+
+/* Draws */
+static void APIENTRY nullDrawArrays(GLenum mode, GLint first, GLsizei count) { renderCalls.calls++; renderCalls.draws++; renderCalls.instances++; renderCalls.vertices += count; }
+static void APIENTRY nullDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount) { renderCalls.calls++; renderCalls.draws++; renderCalls.instances += instancecount; renderCalls.vertices += (uint64_t)count * instancecount; }
+static void APIENTRY nullClear(GLbitfield mask) { renderCalls.calls++; renderCalls.stateChanges++; }
+static void APIENTRY nullClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) { renderCalls.calls++; renderCalls.stateChanges++; }
+
+/* Buffers and vertex arrays */
+static void APIENTRY nullGenBuffers(GLsizei n, GLuint* buffers) { genNames(n, buffers); }
+static void APIENTRY nullGenVertexArrays(GLsizei n, GLuint* arrays) { genNames(n, arrays); }
+static void APIENTRY nullDeleteBuffers(GLsizei n, const GLuint* buffers) { renderCalls.calls++; }
+static void APIENTRY nullBindBuffer(GLenum target, GLuint buffer) { renderCalls.calls++; renderCalls.bufferBinds++; }
+static void APIENTRY nullBindVertexArray(GLuint array) { renderCalls.calls++; renderCalls.bufferBinds++; }
+static void APIENTRY nullBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) { renderCalls.calls++; renderCalls.bufferUploads++; renderCalls.bufferBytes += size; }
+static void APIENTRY nullBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) { renderCalls.calls++; renderCalls.bufferUploads++; renderCalls.bufferBytes += size; }
+static void APIENTRY nullEnableVertexAttribArray(GLuint index) { renderCalls.calls++; renderCalls.vertexAttribs++; }
+static void APIENTRY nullDisableVertexAttribArray(GLuint index) { renderCalls.calls++; renderCalls.vertexAttribs++; }
+static void APIENTRY nullVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer) { renderCalls.calls++; renderCalls.vertexAttribs++; }
+static void APIENTRY nullVertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, const void* pointer) { renderCalls.calls++; renderCalls.vertexAttribs++; }
+static void APIENTRY nullVertexAttribDivisor(GLuint index, GLuint divisor) { renderCalls.calls++; renderCalls.vertexAttribs++; }
+
+/* Textures */
+static void APIENTRY nullGenTextures(GLsizei n, GLuint* textures) { genNames(n, textures); }
+static void APIENTRY nullDeleteTextures(GLsizei n, const GLuint* textures) { renderCalls.calls++; }
+static void APIENTRY nullBindTexture(GLenum target, GLuint texture) { renderCalls.calls++; renderCalls.textureBinds++; }
+static void APIENTRY nullTexParameteri(GLenum target, GLenum pname, GLint param) { renderCalls.calls++; renderCalls.stateChanges++; }
+static void APIENTRY nullPixelStorei(GLenum pname, GLint param) { renderCalls.calls++; renderCalls.stateChanges++; }
+static void APIENTRY nullGenerateMipmap(GLenum target) { renderCalls.calls++; }
+static void APIENTRY nullTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels) { renderCalls.calls++; renderCalls.textureUploads++; renderCalls.textureBytes += pixelBytes(width, height, 1, format); }
+static void APIENTRY nullTexImage3D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const void* pixels) { renderCalls.calls++; renderCalls.textureUploads++; renderCalls.textureBytes += pixels ? pixelBytes(width, height, depth, format) : 0; }
+static void APIENTRY nullTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels) { renderCalls.calls++; renderCalls.textureUploads++; renderCalls.textureBytes += pixelBytes(width, height, depth, format); }
+static void APIENTRY nullCompressedTexImage2D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const void* data) { renderCalls.calls++; renderCalls.textureUploads++; renderCalls.textureBytes += imageSize; }
+static void APIENTRY nullCompressedTexImage3D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLsizei imageSize, const void* data) { renderCalls.calls++; renderCalls.textureUploads++; renderCalls.textureBytes += imageSize; }
+
+/* Shaders and programs, everything compiles and links */
+static GLuint APIENTRY nullCreateShader(GLenum type) { renderCalls.calls++; return nextName++; }
+static GLuint APIENTRY nullCreateProgram() { renderCalls.calls++; return nextName++; }
+static void APIENTRY nullDeleteShader(GLuint shader) { renderCalls.calls++; }
+static void APIENTRY nullDeleteProgram(GLuint program) { renderCalls.calls++; }
+static void APIENTRY nullShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length) { renderCalls.calls++; }
+static void APIENTRY nullCompileShader(GLuint shader) { renderCalls.calls++; }
+static void APIENTRY nullAttachShader(GLuint program, GLuint shader) { renderCalls.calls++; }
+static void APIENTRY nullLinkProgram(GLuint program) { renderCalls.calls++; }
+static void APIENTRY nullProgramParameteri(GLuint program, GLenum pname, GLint value) { renderCalls.calls++; }
+static void APIENTRY nullUseProgram(GLuint program) { renderCalls.calls++; renderCalls.programBinds++; }
+
+static void APIENTRY nullGetShaderiv(GLuint shader, GLenum pname, GLint* params)
+{
+	renderCalls.calls++;
+	*params = pname == GL_COMPILE_STATUS ? GL_TRUE : 0;
+}
+
+static void APIENTRY nullGetProgramiv(GLuint program, GLenum pname, GLint* params)
+{
+	renderCalls.calls++;
+	*params = pname == GL_LINK_STATUS ? GL_TRUE : 0;
+}
+
+static void APIENTRY nullGetInfoLog(GLuint object, GLsizei bufSize, GLsizei* length, GLchar* infoLog)
+{
+	renderCalls.calls++;
+	if (length) *length = 0;
+	if (bufSize > 0) infoLog[0] = '\0';
+}
+
+//Every uniform exists so the engine takes the same paths it does on a real context
+static GLint APIENTRY nullGetUniformLocation(GLuint program, const GLchar* name) { renderCalls.calls++; return 0; }
+
+/* Uniforms */
+static void APIENTRY nullUniform1i(GLint location, GLint v0) { renderCalls.calls++; renderCalls.uniforms++; }
+static void APIENTRY nullUniform1ui(GLint location, GLuint v0) { renderCalls.calls++; renderCalls.uniforms++; }
+static void APIENTRY nullUniform1f(GLint location, GLfloat v0) { renderCalls.calls++; renderCalls.uniforms++; }
+static void APIENTRY nullUniform3fv(GLint location, GLsizei count, const GLfloat* value) { renderCalls.calls++; renderCalls.uniforms++; }
+static void APIENTRY nullUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) { renderCalls.calls++; renderCalls.uniforms++; }
+static void APIENTRY nullUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) { renderCalls.calls++; renderCalls.uniforms++; }
+
+/* Fixed function state */
+static void APIENTRY nullEnable(GLenum cap) { renderCalls.calls++; renderCalls.stateChanges++; }
+static void APIENTRY nullDisable(GLenum cap) { renderCalls.calls++; renderCalls.stateChanges++; }
+static void APIENTRY nullCullFace(GLenum mode) { renderCalls.calls++; renderCalls.stateChanges++; }
+static void APIENTRY nullFrontFace(GLenum mode) { renderCalls.calls++; renderCalls.stateChanges++; }
+static void APIENTRY nullDepthMask(GLboolean flag) { renderCalls.calls++; renderCalls.stateChanges++; }
+static void APIENTRY nullViewport(GLint x, GLint y, GLsizei width, GLsizei height) { renderCalls.calls++; renderCalls.stateChanges++; }
+static void APIENTRY nullFinish() { renderCalls.calls++; }
+static void APIENTRY nullFlush() { renderCalls.calls++; }
+
+/* Framebuffers, GL_MAX_SAMPLES is 0 so MultisampleTarget only ever binds the default one */
+static void APIENTRY nullGenFramebuffers(GLsizei n, GLuint* framebuffers) { genNames(n, framebuffers); }
+static void APIENTRY nullDeleteFramebuffers(GLsizei n, const GLuint* framebuffers) { renderCalls.calls++; }
+static void APIENTRY nullBindFramebuffer(GLenum target, GLuint framebuffer) { renderCalls.calls++; renderCalls.stateChanges++; }
+static void APIENTRY nullGenRenderbuffers(GLsizei n, GLuint* renderbuffers) { genNames(n, renderbuffers); }
+static void APIENTRY nullDeleteRenderbuffers(GLsizei n, const GLuint* renderbuffers) { renderCalls.calls++; }
+static void APIENTRY nullBindRenderbuffer(GLenum target, GLuint renderbuffer) { renderCalls.calls++; }
+static void APIENTRY nullRenderbufferStorageMultisample(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height) { renderCalls.calls++; }
+static void APIENTRY nullFramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer) { renderCalls.calls++; }
+static GLenum APIENTRY nullCheckFramebufferStatus(GLenum target) { renderCalls.calls++; return GL_FRAMEBUFFER_COMPLETE; }
+static void APIENTRY nullBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter) { renderCalls.calls++; }
+
+/* Queries, no compressed formats or program binaries so those paths are skipped */
+static GLenum APIENTRY nullGetError() { renderCalls.calls++; return GL_NO_ERROR; }
+static void APIENTRY nullGetIntegerv(GLenum pname, GLint* data) { renderCalls.calls++; *data = 0; }
+static const GLubyte* APIENTRY nullGetString(GLenum name) { renderCalls.calls++; return (const GLubyte*)"Null renderer"; }
+static void APIENTRY nullReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels) { renderCalls.calls++; }
+
+void NullRenderer::install()
+{
+	glad_glDrawArrays = nullDrawArrays;
+	glad_glDrawArraysInstanced = nullDrawArraysInstanced;
+	glad_glClear = nullClear;
+	glad_glClearColor = nullClearColor;
+
+	glad_glGenBuffers = nullGenBuffers;
+	glad_glGenVertexArrays = nullGenVertexArrays;
+	glad_glDeleteBuffers = nullDeleteBuffers;
+	glad_glBindBuffer = nullBindBuffer;
+	glad_glBindVertexArray = nullBindVertexArray;
+	glad_glBufferData = nullBufferData;
+	glad_glBufferSubData = nullBufferSubData;
+	glad_glEnableVertexAttribArray = nullEnableVertexAttribArray;
+	glad_glDisableVertexAttribArray = nullDisableVertexAttribArray;
+	glad_glVertexAttribPointer = nullVertexAttribPointer;
+	glad_glVertexAttribIPointer = nullVertexAttribIPointer;
+	glad_glVertexAttribDivisor = nullVertexAttribDivisor;
+
+	glad_glGenTextures = nullGenTextures;
+	glad_glDeleteTextures = nullDeleteTextures;
+	glad_glBindTexture = nullBindTexture;
+	glad_glTexParameteri = nullTexParameteri;
+	glad_glPixelStorei = nullPixelStorei;
+	glad_glGenerateMipmap = nullGenerateMipmap;
+	glad_glTexImage2D = nullTexImage2D;
+	glad_glTexImage3D = nullTexImage3D;
+	glad_glTexSubImage3D = nullTexSubImage3D;
+	glad_glCompressedTexImage2D = nullCompressedTexImage2D;
+	glad_glCompressedTexImage3D = nullCompressedTexImage3D;
+
+	glad_glCreateShader = nullCreateShader;
+	glad_glCreateProgram = nullCreateProgram;
+	glad_glDeleteShader = nullDeleteShader;
+	glad_glDeleteProgram = nullDeleteProgram;
+	glad_glShaderSource = nullShaderSource;
+	glad_glCompileShader = nullCompileShader;
+	glad_glAttachShader = nullAttachShader;
+	glad_glLinkProgram = nullLinkProgram;
+	glad_glProgramParameteri = nullProgramParameteri;
+	glad_glUseProgram = nullUseProgram;
+	glad_glGetShaderiv = nullGetShaderiv;
+	glad_glGetProgramiv = nullGetProgramiv;
+	glad_glGetShaderInfoLog = nullGetInfoLog;
+	glad_glGetProgramInfoLog = nullGetInfoLog;
+	glad_glGetUniformLocation = nullGetUniformLocation;
+
+	glad_glUniform1i = nullUniform1i;
+	glad_glUniform1ui = nullUniform1ui;
+	glad_glUniform1f = nullUniform1f;
+	glad_glUniform3fv = nullUniform3fv;
+	glad_glUniformMatrix3fv = nullUniformMatrix3fv;
+	glad_glUniformMatrix4fv = nullUniformMatrix4fv;
+
+	glad_glEnable = nullEnable;
+	glad_glDisable = nullDisable;
+	glad_glCullFace = nullCullFace;
+	glad_glFrontFace = nullFrontFace;
+	glad_glDepthMask = nullDepthMask;
+	glad_glViewport = nullViewport;
+	glad_glFinish = nullFinish;
+	glad_glFlush = nullFlush;
+
+	glad_glGenFramebuffers = nullGenFramebuffers;
+	glad_glDeleteFramebuffers = nullDeleteFramebuffers;
+	glad_glBindFramebuffer = nullBindFramebuffer;
+	glad_glGenRenderbuffers = nullGenRenderbuffers;
+	glad_glDeleteRenderbuffers = nullDeleteRenderbuffers;
+	glad_glBindRenderbuffer = nullBindRenderbuffer;
+	glad_glRenderbufferStorageMultisample = nullRenderbufferStorageMultisample;
+	glad_glFramebufferRenderbuffer = nullFramebufferRenderbuffer;
+	glad_glCheckFramebufferStatus = nullCheckFramebufferStatus;
+	glad_glBlitFramebuffer = nullBlitFramebuffer;
+
+	glad_glGetError = nullGetError;
+	glad_glGetIntegerv = nullGetIntegerv;
+	glad_glGetString = nullGetString;
+	glad_glReadPixels = nullReadPixels;
+
+	nullInstalled = true;
+}
+
+bool NullRenderer::installed()
+{
+	return nullInstalled;
+}
+
+RenderCallCounts& NullRenderer::counts()
+{
+	return renderCalls;
+}
+
+void NullRenderer::resetCounts()
+{
+	renderCalls = RenderCallCounts();
+}
+
+void NullRenderer::printCounts(int frames)
+{
+	if (frames <= 0)
+	{
+		return;
+	}
+
+	const RenderCallCounts& c = renderCalls;
+	cout << "GL calls per frame: " << c.calls / frames << " total, " << c.draws / frames << " draws (" << c.instances / frames
+		<< " instances, " << c.vertices / frames << " vertices), " << c.bufferUploads / frames << " buffer uploads ("
+		<< c.bufferBytes / frames << " bytes), " << c.textureUploads / frames << " texture uploads (" << c.textureBytes / frames
+		<< " bytes), " << c.programBinds / frames << " program binds, " << c.bufferBinds / frames << " buffer/VAO binds, "
+		<< c.textureBinds / frames << " texture binds, " << c.vertexAttribs / frames << " attribute changes, "
+		<< c.uniforms / frames << " uniforms, " << c.stateChanges / frames << " state changes" << endl;
+}
@@ -0,0 +1,45 @@
+/*
+	Null render backend. install() points every GL entry point the engine uses (the glad function pointers) at stubs
+	that count the call and throw it away, so the same display code runs with no context, driver or GPU at all.
+	Running it for a few thousand frames gives the pure CPU cost of a frame plus how many calls, uploads and
+	bytes each frame would hand to the driver. Queries return values that keep the engine on its normal path
+	(shaders compile, programs link, names are unique).
+	Sameer Al Harbi 2022
+*/
+#pragma once
+
+#include "wrapper_glfw.h"
+#include <cstdint>
+
+//GL calls made since the last reset, by kind
+struct RenderCallCounts
+{
+	uint64_t calls; //Every call, including the kinds below
+	uint64_t draws;
+	uint64_t instances; //Instances drawn, 1 for non instanced draws
+	uint64_t vertices; //Vertices drawn, over all instances
+	uint64_t bufferUploads;
+	uint64_t bufferBytes;
+	uint64_t textureUploads;
+	uint64_t textureBytes;
+	uint64_t programBinds;
+	uint64_t bufferBinds;
+	uint64_t textureBinds;
+	uint64_t vertexAttribs; //Attribute pointer/enable/divisor changes
+	uint64_t uniforms;
+	uint64_t stateChanges; //Enable/disable, cull, depth, clear and similar fixed function state
+};
+
+namespace NullRenderer
+{
+	//Replace the loaded GL functions, call instead of gladLoadGLES2Loader
+	void install();
+
+	bool installed();
+
+	RenderCallCounts& counts();
+	void resetCounts();
+
+	//Average calls per frame over frames frames
+	void printCounts(int frames);
+}
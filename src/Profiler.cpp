@@ -0,0 +1,234 @@
+/*
+	Scoped CPU profiler with per-thread ring buffers, see Profiler.h
+	Sameer Al Harbi 2022
+*/
+
+#include "Profiler.h"
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#endif
+
+using namespace std;
+
+//Events kept per thread, the oldest are overwritten once it's full. A frame records a few dozen scopes
+//so this is the last ~1000 frames of the main thread
+const uint64_t PROFILER_BUFFER_SIZE = 1 << 16;
+const uint64_t PROFILER_BUFFER_MASK = PROFILER_BUFFER_SIZE - 1;
+
+//A scope from start to end, or a counter sample at start when counter is set
+struct ProfileEvent
+{
+	const char* name;
+	uint64_t start;
+	uint64_t end;
+	double value;
+	bool counter;
+};
+
+//Written only by its own thread. written counts every event ever recorded, the newest is at (written - 1) & mask
+struct ProfilerThreadBuffer
+{
+	atomic<uint64_t> written;
+	int id;
+	char name[32];
+	ProfileEvent events[PROFILER_BUFFER_SIZE];
+};
+
+atomic<bool> Profiler::recording(false);
+
+static const chrono::steady_clock::time_point epoch = chrono::steady_clock::now();
+
+//Every thread that has recorded, buffers are never freed so events from finished threads still get exported
+static mutex registryLock;
+static vector<ProfilerThreadBuffer*> registry;
+
+static thread_local ProfilerThreadBuffer* threadBuffer = NULL;
+
+//Only allocates (and takes the registry lock) the first time a thread records
+static ProfilerThreadBuffer* currentThreadBuffer()
+{
+	if (threadBuffer == NULL)
+	{
+		ProfilerThreadBuffer* buffer = new ProfilerThreadBuffer();
+		buffer->written.store(0, memory_order_relaxed);
+
+		lock_guard<mutex> lock(registryLock);
+		buffer->id = (int)registry.size() + 1;
+		snprintf(buffer->name, sizeof(buffer->name), "thread %d", buffer->id);
+		registry.push_back(buffer);
+		threadBuffer = buffer;
+	}
+	return threadBuffer;
+}
+
+void Profiler::setEnabled(bool enabled)
+{
+	recording.store(enabled, memory_order_relaxed);
+}
+
+bool Profiler::enabled()
+{
+	return recording.load(memory_order_relaxed);
+}
+
+uint64_t Profiler::now()
+{
+	//+1 so a scope started at the epoch isn't mistaken for one that isn't recording
+	return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - epoch).count() + 1;
+}
+
+static void push(const ProfileEvent& e)
+{
+	ProfilerThreadBuffer* buffer = currentThreadBuffer();
+	uint64_t index = buffer->written.load(memory_order_relaxed);
+
+	buffer->events[index & PROFILER_BUFFER_MASK] = e;
+
+	//Publishes the event to writeTrace
+	buffer->written.store(index + 1, memory_order_release);
+}
+
+void Profiler::record(const char* name, uint64_t start, uint64_t end)
+{
+	ProfileEvent e = { name, start, end, 0.0, false };
+	push(e);
+}
+
+void Profiler::counter(const char* name, double value)
+{
+	if (recording.load(memory_order_relaxed))
+	{
+		ProfileEvent e = { name, now(), 0, value, true };
+		push(e);
+	}
+}
+
+void Profiler::setThreadName(const char* name)
+{
+	ProfilerThreadBuffer* buffer = currentThreadBuffer();
+	lock_guard<mutex> lock(registryLock);
+	snprintf(buffer->name, sizeof(buffer->name), "%s", name);
+}
+
+//Copy out a thread's newest events. Other threads keep recording meanwhile, anything they may have overwritten
+//during the copy is dropped instead of locking them out
+static void snapshot(ProfilerThreadBuffer* buffer, vector<ProfileEvent>& out)
+{
+	uint64_t end = buffer->written.load(memory_order_acquire);
+	uint64_t begin = end > PROFILER_BUFFER_SIZE ? end - PROFILER_BUFFER_SIZE : 0;
+
+	size_t first = out.size();
+	for (uint64_t i = begin; i < end; i++)
+	{
+		out.push_back(buffer->events[i & PROFILER_BUFFER_MASK]);
+	}
+
+	uint64_t after = buffer->written.load(memory_order_acquire);
+	if (after > PROFILER_BUFFER_SIZE && after - PROFILER_BUFFER_SIZE > begin)
+	{
+		uint64_t overwritten = min(after - PROFILER_BUFFER_SIZE, end) - begin;
+		out.erase(out.begin() + first, out.begin() + first + overwritten);
+	}
+}
+
+static void writeJsonString(FILE* file, const char* text)
+{
+	fputc('"', file);
+	for (const char* c = text; *c; c++)
+	{
+		if (*c == '"' || *c == '\\') fputc('\\', file);
+		fputc(*c, file);
+	}
+	fputc('"', file);
+}
+
+bool Profiler::writeTrace(const char* path)
+{
+	vector<ProfilerThreadBuffer*> buffers;
+	{
+		lock_guard<mutex> lock(registryLock);
+		buffers = registry;
+	}
+
+	FILE* file = fopen(path, "w");
+	if (file == NULL)
+	{
+		cerr << "Could not write trace " << path << endl;
+		return false;
+	}
+
+	//Chrome trace event format, complete ("X") scopes and counter ("C") samples with times in microseconds
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	bool first = true;
+	size_t total = 0;
+	vector<ProfileEvent> events;
+
+	for (size_t t = 0; t < buffers.size(); t++)
+	{
+		ProfilerThreadBuffer* buffer = buffers[t];
+
+		fprintf(file, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", first ? "" : ",\n", buffer->id);
+		{
+			lock_guard<mutex> lock(registryLock);
+			writeJsonString(file, buffer->name);
+		}
+		fprintf(file, "}}");
+		first = false;
+
+		events.clear();
+		snapshot(buffer, events);
+		total += events.size();
+
+		for (size_t i = 0; i < events.size(); i++)
+		{
+			if (events[i].counter)
+			{
+				fprintf(file, ",\n{\"ph\":\"C\",\"name\":");
+				writeJsonString(file, events[i].name);
+				fprintf(file, ",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"args\":{\"ms\":%.4f}}", buffer->id,
+					events[i].start / 1000.0, events[i].value);
+				continue;
+			}
+
+			fprintf(file, ",\n{\"ph\":\"X\",\"cat\":\"cpu\",\"name\":");
+			writeJsonString(file, events[i].name);
+			fprintf(file, ",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", buffer->id,
+				events[i].start / 1000.0, (events[i].end - events[i].start) / 1000.0);
+		}
+	}
+
+	fprintf(file, "\n]}\n");
+	bool ok = ferror(file) == 0;
+	fclose(file);
+
+	if (!ok)
+	{
+		cerr << "Could not write trace " << path << endl;
+		return false;
+	}
+
+	cout << "Wrote " << total << " profile events from " << buffers.size() << " threads to " << path << endl;
+
+#ifdef __EMSCRIPTEN__
+	//The file only exists in the in-memory file system, hand it to the browser
+	EM_ASM({
+		var name = UTF8ToString($0);
+		var blob = new Blob([FS.readFile(name)], { type: 'application/json' });
+		var link = document.createElement('a');
+		link.href = URL.createObjectURL(blob);
+		link.download = name.split('/').pop();
+		link.click();
+		URL.revokeObjectURL(link.href);
+	}, path);
+#endif
+
+	return true;
+}
@@ -0,0 +1,66 @@
+/*
+	Scoped CPU profiler. PROFILE_SCOPE("name") times the rest of the enclosing block; nested scopes nest in the trace.
+	Each thread records into its own fixed size ring buffer, written only by that thread with an atomic index, so
+	recording takes no locks and never allocates. The newest events of every thread can be written out as a
+	Chrome trace (open in chrome://tracing or https://ui.perfetto.dev), along with counters such as GPU pass times.
+	Recording is off until Profiler::setEnabled(true) (--profile, or T in game), a disabled scope costs one relaxed
+	atomic load. Building with -DBLOCKWORLD_PROFILER=OFF compiles the scopes out completely.
+	Sameer Al Harbi 2022
+*/
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace Profiler
+{
+	extern std::atomic<bool> recording;
+
+	void setEnabled(bool enabled);
+	bool enabled();
+
+	//Nanoseconds since the profiler's epoch (program start)
+	uint64_t now();
+
+	//Add a finished scope to the calling thread's buffer. name must be a string literal (only the pointer is kept)
+	void record(const char* name, uint64_t start, uint64_t end);
+
+	//Add a sample of a value plotted over time (e.g. GPU pass times), only while recording
+	void counter(const char* name, double value);
+
+	//Name shown for the calling thread in the trace
+	void setThreadName(const char* name);
+
+	//Write every thread's recorded events as Chrome trace JSON. On the web the file is also offered as a download
+	bool writeTrace(const char* path);
+}
+
+class ProfileScope
+{
+public:
+	ProfileScope(const char* name)
+	{
+		this->name = name;
+		start = Profiler::recording.load(std::memory_order_relaxed) ? Profiler::now() : 0;
+	}
+
+	~ProfileScope()
+	{
+		if (start)
+		{
+			Profiler::record(name, start, Profiler::now());
+		}
+	}
+
+private:
+	const char* name;
+	uint64_t start;
+};
+
+#ifdef BLOCKWORLD_PROFILER
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name)
+#endif
@@ -0,0 +1,151 @@
+/*
+	Adaptive quality, see QualityGovernor.h
+	Sameer Al Harbi 2022
+*/
+
+#include "QualityGovernor.h"
+#include "Profiler.h"
+#include <iostream>
+
+using namespace std;
+
+/*
+	Lowest quality first. Going down from the default, MSAA and the chunk budget go before anything that changes what's
+	on screen for good (trees, then the far chunks)
+*/
+static const QualityLevel QUALITY_LEVELS[NUM_QUALITY_LEVELS] =
+{
+	//view radius, chunks generated per frame, trees per chunk, MSAA samples
+	{ 0, 1, 0, 0 },
+	{ 1, 1, 0, 0 },
+	{ 1, 1, 2, 0 },
+	{ 1, 3, 2, 0 },
+	{ 1, 3, 2, 4 },
+	{ 1, 9, 2, 4 },
+	{ 1, 9, 2, 8 },
+	{ 1, 9, 4, 8 },
+	{ 2, 9, 4, 8 },
+	{ 2, 9, 6, 8 },
+};
+
+//Quality drops above target * DROP, rises below target * RAISE
+const double QUALITY_DROP_THRESHOLD = 1.1;
+const double QUALITY_RAISE_THRESHOLD = 0.7;
+
+//A level dropped within this many frames of being reached was too much, and the longest wait that causes
+const uint64_t QUALITY_FAILED_RAISE_FRAMES = QUALITY_RAISE_WINDOW * 2;
+const int QUALITY_MAX_RAISE_WAIT = QUALITY_RAISE_WINDOW * 32;
+
+//A frame this many times over the target, after one that wasn't, is a one-off stall (asset uploads, a hidden tab,
+//a breakpoint) rather than what the scene costs. If the next frame is as slow it's counted
+const double QUALITY_STALL_FACTOR = 8.0;
+
+QualityGovernor::QualityGovernor()
+{
+	enabled = false;
+	targetMs = 1000.0 / 60.0;
+	current = DEFAULT_QUALITY_LEVEL;
+	frame = 0;
+	count = 0;
+	stalled = false;
+	drops = 0;
+	raises = 0;
+	for (int i = 0; i < NUM_QUALITY_LEVELS; i++)
+	{
+		raiseWait[i] = QUALITY_RAISE_WINDOW;
+		reachedAt[i] = 0;
+	}
+}
+
+void QualityGovernor::setLevel(int level)
+{
+	current = level < 0 ? 0 : (level >= NUM_QUALITY_LEVELS ? NUM_QUALITY_LEVELS - 1 : level);
+	count = 0;
+}
+
+const QualityLevel& QualityGovernor::settings() const
+{
+	return QUALITY_LEVELS[current];
+}
+
+bool QualityGovernor::update(double frameMs)
+{
+	frame++;
+	if (!enabled)
+	{
+		return false;
+	}
+
+	bool stall = frameMs > targetMs * QUALITY_STALL_FACTOR;
+	bool skip = stall && !stalled;
+	stalled = stall;
+	if (skip)
+	{
+		return false;
+	}
+
+	history[count % QUALITY_RAISE_WINDOW] = frameMs;
+	count++;
+
+	if (count >= QUALITY_DROP_WINDOW && current > 0)
+	{
+		double drop = average(QUALITY_DROP_WINDOW);
+		if (drop > targetMs * QUALITY_DROP_THRESHOLD)
+		{
+			//Reached recently and already too slow, wait longer before trying it again
+			if (frame - reachedAt[current] < QUALITY_FAILED_RAISE_FRAMES)
+			{
+				int& wait = raiseWait[current - 1];
+				wait = wait * 2 > QUALITY_MAX_RAISE_WAIT ? QUALITY_MAX_RAISE_WAIT : wait * 2;
+			}
+			drops++;
+			return change(current - 1, drop, QUALITY_DROP_WINDOW);
+		}
+	}
+
+	if (count >= raiseWait[current] && count >= QUALITY_RAISE_WINDOW && current < NUM_QUALITY_LEVELS - 1)
+	{
+		double raise = average(QUALITY_RAISE_WINDOW);
+		if (raise < targetMs * QUALITY_RAISE_THRESHOLD)
+		{
+			raises++;
+			return change(current + 1, raise, QUALITY_RAISE_WINDOW);
+		}
+	}
+
+	return false;
+}
+
+bool QualityGovernor::change(int level, double averageMs, int window)
+{
+	const QualityLevel& to = QUALITY_LEVELS[level];
+	cout << "Quality " << current << " -> " << level << " at frame " << frame << ": " << averageMs << " ms average over "
+		<< window << " frames, target " << targetMs << " ms (view radius " << to.viewRadius << ", " << to.chunkBudget
+		<< " chunks per frame, " << to.propDensity << " trees per chunk, MSAA " << to.msaaSamples << "x)" << endl;
+
+	current = level;
+	reachedAt[level] = frame;
+	count = 0;
+	Profiler::counter("quality level", level);
+	return true;
+}
+
+//Mean of the newest frames in history
+double QualityGovernor::average(int frames) const
+{
+	double sum = 0.0;
+	for (int i = 1; i <= frames; i++)
+	{
+		sum += history[(count - i) % QUALITY_RAISE_WINDOW];
+	}
+	return sum / frames;
+}
+
+void QualityGovernor::printStats() const
+{
+	if (enabled)
+	{
+		cout << "Quality: level " << current << " of " << NUM_QUALITY_LEVELS - 1 << " after " << frame << " frames, "
+			<< drops << " drops and " << raises << " raises" << endl;
+	}
+}
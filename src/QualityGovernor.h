@@ -0,0 +1,73 @@
+/*
+	Trades rendering quality for frame time to hold a target (--target-ms, 16.7 ms by default).
+	Quality is a ladder of levels, each one setting the four things that cost the most: view radius (chunks drawn
+	around the camera), chunk budget (chunks generated and uploaded per frame), prop density (trees per chunk) and
+	MSAA samples. Neighbouring levels differ in one of them, so each step is small.
+	A frame's cost is the larger of its CPU time and its GPU time when GpuTimer can measure the GPU, so time spent
+	waiting for vsync isn't counted. Without GPU times it's the whole frame interval.
+	Hysteresis keeps it from flipping between two levels: quality drops when the average over a short window is more
+	than 10% over the target and only rises when the average over a longer window is under 70% of it. After a change
+	both windows start again with frames at the new level, and if a level has to be dropped soon after it was reached,
+	the wait before trying it again doubles.
+	Every change is logged with the measurements that caused it.
+	Sameer Al Harbi 2022
+*/
+#pragma once
+
+#include <cstdint>
+
+struct QualityLevel
+{
+	int viewRadius; //1 is the original 3x3 chunks
+	int chunkBudget;
+	int propDensity;
+	int msaaSamples;
+};
+
+const int NUM_QUALITY_LEVELS = 10;
+const int DEFAULT_QUALITY_LEVEL = 6; //What BlockWorld has always rendered
+
+//Frames averaged to decide on dropping and on raising quality
+const int QUALITY_DROP_WINDOW = 30;
+const int QUALITY_RAISE_WINDOW = 180;
+
+class QualityGovernor
+{
+public:
+	QualityGovernor();
+
+	void setTarget(double ms) { targetMs = ms; }
+	void setEnabled(bool enabled) { this->enabled = enabled; }
+	bool isEnabled() const { return enabled; }
+
+	//Jump straight to a level, clamped to the ladder
+	void setLevel(int level);
+	int level() const { return current; }
+	const QualityLevel& settings() const;
+
+	//Feed one frame's cost. Returns true when the level changed and the new settings() need applying
+	bool update(double frameMs);
+
+	void printStats() const;
+
+private:
+	bool change(int level, double averageMs, int window);
+	double average(int frames) const;
+
+	bool enabled;
+	double targetMs;
+	int current;
+	uint64_t frame;
+
+	//Costs of the frames since the last change, newest at history[(count - 1) % QUALITY_RAISE_WINDOW]
+	double history[QUALITY_RAISE_WINDOW];
+	int count;
+	bool stalled; //Previous frame was over the stall limit
+
+	//Frames to wait at each level before going above it, and when each level was last reached
+	int raiseWait[NUM_QUALITY_LEVELS];
+	uint64_t reachedAt[NUM_QUALITY_LEVELS];
+
+	int drops;
+	int raises;
+};
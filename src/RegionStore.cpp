@@ -0,0 +1,548 @@
+/*
+	Region files for chunks, see RegionStore.h for the layout
+	Sameer Al Harbi 2022
+*/
+
+#include "RegionStore.h"
+#include "LZ4Block.h"
+#include "Profiler.h"
+
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <cmath>
+#include <cerrno>
+#include <algorithm>
+
+//Same condition as the asset pack's mmap, the web build has nowhere to keep files between runs anyway
+#if !defined(__EMSCRIPTEN__) && (defined(__unix__) || defined(__APPLE__))
+#define REGION_FILES
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+//Bytes before the first payload
+static const uint64_t REGION_TABLE_END = sizeof(RegionHeader) + (uint64_t)REGION_CHUNKS * REGION_CHUNKS * sizeof(RegionEntry);
+
+static uint64_t roundToSector(uint64_t bytes)
+{
+	return (bytes + REGION_SECTOR_BYTES - 1) / REGION_SECTOR_BYTES * REGION_SECTOR_BYTES;
+}
+
+//Floor division, so chunks at negative coordinates go in the region below
+static int floorDiv(int value, int divisor)
+{
+	return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+RegionStore::RegionStore()
+{
+	chunkSize = 0;
+	mode = REGION_WHOLE_CHUNKS;
+	opened = false;
+	nextSequence = 0;
+	stopping = false;
+	loads = 0;
+	misses = 0;
+	writes = 0;
+	editWrites = 0;
+	droppedWrites = 0;
+	storedBytes = 0;
+	loadMs = 0.0;
+
+	for (int i = 0; i < REGION_WRITE_SLOTS; i++)
+	{
+		slots[i].state = SLOT_FREE;
+	}
+}
+
+RegionStore::~RegionStore()
+{
+	close();
+}
+
+bool RegionStore::open(const string& directory, int chunkSize, RegionMode mode)
+{
+#ifdef REGION_FILES
+	close();
+
+	//Edits index blocks with 16 bits
+	if ((size_t)chunkSize * chunkSize * chunkSize > 65536)
+	{
+		cerr << "Chunks of size " << chunkSize << " are too big for region files" << endl;
+		return false;
+	}
+
+	if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST)
+	{
+		cerr << "Could not create world folder " << directory << endl;
+		return false;
+	}
+
+	this->directory = directory;
+	this->chunkSize = chunkSize;
+	this->mode = mode;
+	stopping = false;
+
+	//Every slot can hold a chunk or a full edit list without allocating when a save is queued
+	for (int i = 0; i < REGION_WRITE_SLOTS; i++)
+	{
+		slots[i].state = SLOT_FREE;
+		slots[i].offsets.resize((size_t)chunkSize * chunkSize * chunkSize);
+		slots[i].edits.reserve(REGION_COMPACT_EDITS);
+	}
+
+	writer = thread(&RegionStore::writerLoop, this);
+	opened = true;
+	cout << "Saving " << (mode == REGION_EDITS ? "chunk edits" : "chunks") << " in " << directory << endl;
+	return true;
+#else
+	cout << "Region files need a native build with mmap, chunks won't be saved" << endl;
+	return false;
+#endif
+}
+
+void RegionStore::close()
+{
+	if (!opened)
+	{
+		return;
+	}
+
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	queued.notify_all();
+	writer.join();
+
+#ifdef REGION_FILES
+	for (size_t i = 0; i < regions.size(); i++)
+	{
+		Region* r = regions[i];
+		if (r->mapping)
+		{
+			munmap(r->mapping, r->mappedSize);
+		}
+		if (r->fd >= 0)
+		{
+			::close(r->fd);
+		}
+		delete r;
+	}
+#endif
+	regions.clear();
+	opened = false;
+}
+
+void RegionStore::locate(glm::vec3 position, int chunkSize, int& regionX, int& regionZ, int& index)
+{
+	int cx = (int)floor(position.x / chunkSize);
+	int cz = (int)floor(position.z / chunkSize);
+	regionX = floorDiv(cx, REGION_CHUNKS);
+	regionZ = floorDiv(cz, REGION_CHUNKS);
+	index = (cx - regionX * REGION_CHUNKS) * REGION_CHUNKS + (cz - regionZ * REGION_CHUNKS);
+}
+
+RegionStore::Region* RegionStore::region(int x, int z)
+{
+	for (size_t i = 0; i < regions.size(); i++)
+	{
+		if (regions[i]->x == x && regions[i]->z == z)
+		{
+			return regions[i];
+		}
+	}
+
+#ifdef REGION_FILES
+	string path = directory + "/r." + to_string(x) + "." + to_string(z) + ".bwr";
+	int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0)
+	{
+		cerr << "Could not open region file " << path << endl;
+		if (fd >= 0) ::close(fd);
+		return NULL;
+	}
+
+	Region* r = new Region();
+	r->x = x;
+	r->z = z;
+	r->fd = fd;
+	r->mapping = NULL;
+	r->mappedSize = 0;
+	r->table.assign(REGION_CHUNKS * REGION_CHUNKS, RegionEntry());
+
+	RegionHeader header;
+	bool valid = false;
+	if ((uint64_t)st.st_size >= REGION_TABLE_END && pread(fd, &header, sizeof(header), 0) == sizeof(header))
+	{
+		valid = memcmp(header.magic, REGION_MAGIC, 4) == 0 && header.version == REGION_VERSION && header.regionX == x
+			&& header.regionZ == z && header.chunkSize == (uint32_t)chunkSize;
+		size_t tableBytes = r->table.size() * sizeof(RegionEntry);
+		valid = valid && pread(fd, r->table.data(), tableBytes, sizeof(header)) == (ssize_t)tableBytes;
+		if (!valid)
+		{
+			cerr << "Region file " << path << " is from another version or chunk size, starting it again" << endl;
+		}
+	}
+
+	//New (or unusable) file, every chunk starts out not stored
+	if (!valid)
+	{
+		memcpy(header.magic, REGION_MAGIC, 4);
+		header.version = REGION_VERSION;
+		header.regionX = x;
+		header.regionZ = z;
+		header.chunkSize = (uint32_t)chunkSize;
+		header.reserved = 0;
+		r->table.assign(REGION_CHUNKS * REGION_CHUNKS, RegionEntry());
+		if (ftruncate(fd, 0) != 0 || pwrite(fd, &header, sizeof(header), 0) != sizeof(header)
+			|| pwrite(fd, r->table.data(), r->table.size() * sizeof(RegionEntry), sizeof(header)) != (ssize_t)(r->table.size() * sizeof(RegionEntry)))
+		{
+			cerr << "Could not write region file " << path << endl;
+		}
+		st.st_size = (off_t)REGION_TABLE_END;
+	}
+
+	r->fileEnd = roundToSector(std::max((uint64_t)st.st_size, REGION_TABLE_END));
+	regions.push_back(r);
+	return r;
+#else
+	return NULL;
+#endif
+}
+
+//Map at least needed bytes of the region file, the mapping grows as payloads are appended
+bool RegionStore::mapRegion(Region* r, size_t needed)
+{
+#ifdef REGION_FILES
+	if (r->mapping && needed <= r->mappedSize)
+	{
+		return true;
+	}
+
+	struct stat st;
+	if (fstat(r->fd, &st) != 0 || (size_t)st.st_size < needed)
+	{
+		return false;
+	}
+
+	if (r->mapping)
+	{
+		munmap(r->mapping, r->mappedSize);
+		r->mapping = NULL;
+		r->mappedSize = 0;
+	}
+
+	//Shared, so chunks the writer rewrites in place are seen without mapping again
+	void* mapped = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, r->fd, 0);
+	if (mapped == MAP_FAILED)
+	{
+		return false;
+	}
+	r->mapping = (unsigned char*)mapped;
+	r->mappedSize = (size_t)st.st_size;
+	return true;
+#else
+	return false;
+#endif
+}
+
+StoredChunk RegionStore::load(glm::vec3 position, int heightmod, int8_t* offsets, vector<ChunkEdit>& edits, int* storedHeightmod)
+{
+	if (!opened)
+	{
+		return STORED_NONE;
+	}
+
+	PROFILE_SCOPE("RegionStore::load");
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	size_t rawSize = (size_t)chunkSize * chunkSize * chunkSize;
+
+	int regionX, regionZ, index;
+	locate(position, chunkSize, regionX, regionZ, index);
+
+	Region* r;
+	RegionEntry entry;
+	{
+		lock_guard<mutex> guard(lock);
+
+		//A save still waiting to be written has the newest copy
+		WriteSlot* pending = NULL;
+		for (int i = 0; i < REGION_WRITE_SLOTS; i++)
+		{
+			WriteSlot& slot = slots[i];
+			if (slot.state != SLOT_FREE && slot.regionX == regionX && slot.regionZ == regionZ && slot.index == index
+				&& (pending == NULL || slot.sequence > pending->sequence))
+			{
+				pending = &slot;
+			}
+		}
+		if (pending)
+		{
+			if (pending->whole && pending->heightmod != heightmod && storedHeightmod == NULL)
+			{
+				misses++;
+				return STORED_NONE;
+			}
+			loads++;
+			if (pending->whole)
+			{
+				if (storedHeightmod)
+				{
+					*storedHeightmod = pending->heightmod;
+				}
+				memcpy(offsets, pending->offsets.data(), rawSize);
+				return STORED_WHOLE;
+			}
+			edits.assign(pending->edits.begin(), pending->edits.end());
+			return STORED_EDITS;
+		}
+
+		r = region(regionX, regionZ);
+		if (r == NULL)
+		{
+			misses++;
+			return STORED_NONE;
+		}
+		entry = r->table[index];
+	}
+
+	//Edit lists hold the offsets blocks were put at, they're replayed over the terrain at any heightmod
+	bool otherHeight = entry.heightmod != heightmod && !(entry.flags & REGION_FLAG_EDITS) && storedHeightmod == NULL;
+	if (entry.offset == 0 || otherHeight || !mapRegion(r, (size_t)entry.offset + entry.storedSize))
+	{
+		misses++;
+		return STORED_NONE;
+	}
+
+	const unsigned char* payload = r->mapping + entry.offset;
+	bool read;
+	if (entry.flags & REGION_FLAG_EDITS)
+	{
+		size_t count = entry.storedSize / sizeof(ChunkEdit);
+		read = entry.storedSize % sizeof(ChunkEdit) == 0 && count <= REGION_COMPACT_EDITS;
+		if (read)
+		{
+			const ChunkEdit* stored = (const ChunkEdit*)payload;
+			edits.assign(stored, stored + count);
+			for (size_t i = 0; i < count; i++)
+			{
+				read = read && edits[i].index < rawSize;
+			}
+		}
+	}
+	else if (entry.flags & REGION_FLAG_LZ4)
+	{
+		read = LZ4Block::decompress(payload, entry.storedSize, (unsigned char*)offsets, rawSize);
+	}
+	else
+	{
+		read = entry.storedSize == rawSize;
+		if (read)
+		{
+			memcpy(offsets, payload, rawSize);
+		}
+	}
+
+	if (!read)
+	{
+		cerr << "Chunk " << index << " of region " << regionX << "," << regionZ << " is corrupt, generating it again" << endl;
+		misses++;
+		return STORED_NONE;
+	}
+
+	loads++;
+	loadMs += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	if (storedHeightmod && !(entry.flags & REGION_FLAG_EDITS))
+	{
+		*storedHeightmod = entry.heightmod;
+	}
+	return entry.flags & REGION_FLAG_EDITS ? STORED_EDITS : STORED_WHOLE;
+}
+
+bool RegionStore::save(glm::vec3 position, int heightmod, const int8_t* offsets, const vector<ChunkEdit>* edits, bool wait)
+{
+	if (!opened)
+	{
+		return false;
+	}
+
+	int regionX, regionZ, index;
+	locate(position, chunkSize, regionX, regionZ, index);
+
+	unique_lock<mutex> guard(lock);
+	WriteSlot* slot = NULL;
+	while (true)
+	{
+		for (int i = 0; i < REGION_WRITE_SLOTS && slot == NULL; i++)
+		{
+			if (slots[i].state == SLOT_FREE)
+			{
+				slot = &slots[i];
+			}
+		}
+		if (slot || !wait)
+		{
+			break;
+		}
+		freed.wait(guard);
+	}
+
+	if (slot == NULL)
+	{
+		droppedWrites++;
+		return false;
+	}
+
+	slot->state = SLOT_QUEUED;
+	slot->sequence = nextSequence++;
+	slot->regionX = regionX;
+	slot->regionZ = regionZ;
+	slot->index = index;
+	slot->heightmod = heightmod;
+	slot->whole = edits == NULL || edits->size() > REGION_COMPACT_EDITS;
+	if (slot->whole)
+	{
+		memcpy(slot->offsets.data(), offsets, slot->offsets.size());
+	}
+	else
+	{
+		slot->edits.assign(edits->begin(), edits->end());
+	}
+	guard.unlock();
+	queued.notify_one();
+	return true;
+}
+
+void RegionStore::writerLoop()
+{
+	Profiler::setThreadName("region writer");
+	vector<unsigned char> compressed;
+
+	while (true)
+	{
+		WriteSlot* slot = NULL;
+		{
+			unique_lock<mutex> guard(lock);
+			while (true)
+			{
+				//Oldest save first
+				for (int i = 0; i < REGION_WRITE_SLOTS; i++)
+				{
+					if (slots[i].state == SLOT_QUEUED && (slot == NULL || slots[i].sequence < slot->sequence))
+					{
+						slot = &slots[i];
+					}
+				}
+				//Everything queued is written before the writer stops
+				if (slot || stopping)
+				{
+					break;
+				}
+				queued.wait(guard);
+			}
+			if (slot == NULL)
+			{
+				return;
+			}
+			slot->state = SLOT_WRITING;
+		}
+
+		write(*slot, compressed);
+
+		{
+			lock_guard<mutex> guard(lock);
+			slot->state = SLOT_FREE;
+		}
+		freed.notify_all();
+	}
+}
+
+void RegionStore::write(WriteSlot& slot, vector<unsigned char>& compressed)
+{
+#ifdef REGION_FILES
+	PROFILE_SCOPE("RegionStore::write");
+
+	size_t rawSize = slot.offsets.size();
+	const unsigned char* payload = (const unsigned char*)slot.offsets.data();
+	uint32_t size = (uint32_t)rawSize;
+	uint16_t flags = 0;
+	if (!slot.whole)
+	{
+		payload = (const unsigned char*)slot.edits.data();
+		size = (uint32_t)(slot.edits.size() * sizeof(ChunkEdit));
+		flags = REGION_FLAG_EDITS;
+	}
+	else if (LZ4Block::compress(payload, rawSize, compressed) && compressed.size() < rawSize)
+	{
+		payload = compressed.data();
+		size = (uint32_t)compressed.size();
+		flags = REGION_FLAG_LZ4;
+	}
+
+	Region* r;
+	RegionEntry entry;
+	{
+		lock_guard<mutex> guard(lock);
+		r = region(slot.regionX, slot.regionZ);
+		if (r == NULL)
+		{
+			return;
+		}
+		entry = r->table[slot.index];
+	}
+
+	//Over the old payload when it fits, otherwise on the end of the file
+	if (entry.offset == 0 || size > entry.capacity)
+	{
+		entry.offset = (uint32_t)r->fileEnd;
+		entry.capacity = (uint32_t)roundToSector(size);
+		r->fileEnd += entry.capacity;
+	}
+	entry.storedSize = size;
+	entry.heightmod = (int16_t)slot.heightmod;
+	entry.flags = flags;
+
+	//The payload goes down before the table entry pointing at it
+	off_t entryOffset = (off_t)(sizeof(RegionHeader) + slot.index * sizeof(RegionEntry));
+	if (pwrite(r->fd, payload, size, entry.offset) != (ssize_t)size || pwrite(r->fd, &entry, sizeof(entry), entryOffset) != sizeof(entry))
+	{
+		cerr << "Could not write chunk " << slot.index << " of region " << slot.regionX << "," << slot.regionZ << endl;
+		return;
+	}
+
+	{
+		lock_guard<mutex> guard(lock);
+		r->table[slot.index] = entry;
+	}
+	writes++;
+	editWrites += slot.whole ? 0 : 1;
+	storedBytes += size;
+#endif
+}
+
+void RegionStore::printStats()
+{
+	if (!opened && loads + misses + writes == 0)
+	{
+		return;
+	}
+
+	cout << "Region files: " << loads << " chunks loaded";
+	if (loads)
+	{
+		cout << " (" << loadMs / loads << " ms each)";
+	}
+	cout << ", " << misses << " not stored, " << writes << " written (" << editWrites << " as edits, " << storedBytes / 1024 << " KB)";
+	if (droppedWrites)
+	{
+		cout << ", " << droppedWrites << " saves dropped with the write queue full";
+	}
+	cout << endl;
+}
@@ -0,0 +1,168 @@
+/*
+	Chunks saved to disk (--world <dir>), so terrain that's been seen is read back instead of generated from noise again.
+	Chunks are grouped 32x32 (in x and z) per region file. A region file starts with a table holding every chunk's
+	offset, and each chunk's block height offsets are stored LZ4 compressed after it. Only a column's surface chunk is
+	ever generated (ChunkBlock.h), so it's the one stored for the column: a world must be opened with the height it
+	was saved with.
+	Reads go through an mmap of the region file: finding a chunk is a table lookup, and loading it is a decompress.
+	With REGION_EDITS only what was changed from the generated terrain is stored, as a list of edited blocks that's
+	replayed over the chunk generated from noise when it loads. A chunk with more than REGION_COMPACT_EDITS edits is
+	stored whole instead, so the list (and the time to replay it) stays small.
+	Writes are queued into a fixed number of slots and done by a writer thread, so saving a chunk on the render thread
+	only copies its offsets. If every slot is busy the save is dropped and the chunk is generated again next time.
+	Whole chunks are stored at the heightmod they were generated with, edit lists hold the offsets blocks were put at
+	and are replayed over the chunk at any heightmod.
+	Only native builds on systems with mmap have region files.
+	Sameer Al Harbi 2022
+*/
+#pragma once
+
+#include "ChunkBlock.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*
+	On-disk layout of r.<x>.<z>.bwr, all values little endian
+
+	[RegionHeader][RegionEntry * REGION_CHUNKS^2 (x major)][payload]...
+
+	Payloads start on a REGION_SECTOR_BYTES boundary. A chunk that's saved again is written over its old payload if it
+	fits in the space it had, otherwise it's appended to the end of the file and the old space is left unused.
+*/
+const char REGION_MAGIC[4] = { 'B', 'W', 'R', 'G' };
+const uint32_t REGION_VERSION = 1;
+const int REGION_CHUNKS = 32; //Chunks along x and z in one region
+const uint32_t REGION_SECTOR_BYTES = 256;
+const uint32_t REGION_FLAG_LZ4 = 1; //Payload is compressed, otherwise it's the raw offsets
+const uint32_t REGION_FLAG_EDITS = 2; //Payload is a ChunkEdit list (never compressed), otherwise the whole chunk
+
+//Edits a chunk keeps before it's compacted, stored whole from then on
+const int REGION_COMPACT_EDITS = 256;
+
+//Saves that can be waiting for the writer thread
+const int REGION_WRITE_SLOTS = 64;
+
+struct RegionHeader
+{
+	char magic[4];
+	uint32_t version;
+	int32_t regionX;
+	int32_t regionZ;
+	uint32_t chunkSize; //Blocks along each side of a chunk, the payloads are chunkSize^3 offsets
+	uint32_t reserved;
+};
+
+//What's stored for a chunk
+enum RegionMode
+{
+	REGION_WHOLE_CHUNKS, //Every chunk that's been generated, as its block height offsets
+	REGION_EDITS //Only edited chunks, as their edit lists
+};
+
+//What load found
+enum StoredChunk
+{
+	STORED_NONE,
+	STORED_WHOLE, //offsets were filled in
+	STORED_EDITS //edits were filled in, to apply over the generated chunk
+};
+
+struct RegionEntry
+{
+	uint32_t offset; //Of the payload from the start of the file, 0 when the chunk isn't stored
+	uint32_t capacity; //Bytes reserved for the payload
+	uint32_t storedSize;
+	int16_t heightmod; //Terrain height the chunk was generated with, only checked for whole chunks
+	uint16_t flags;
+};
+
+class RegionStore
+{
+public:
+	RegionStore();
+	~RegionStore();
+
+	//Keep region files in directory (created if it doesn't exist) for chunks of chunkSize^3 blocks, at most 2^16
+	bool open(const std::string& directory, int chunkSize, RegionMode mode = REGION_WHOLE_CHUNKS);
+
+	//Finish the queued writes and close every region
+	void close();
+	bool isOpen() const { return opened; }
+	RegionMode getMode() const { return mode; }
+
+	//Read the chunk at position into offsets (chunkSize^3) when it was stored whole with heightmod, or edits (which
+	//must have room for REGION_COMPACT_EDITS) when it's an edit list, saved at any heightmod. With storedHeightmod a
+	//chunk stored whole at another heightmod is read too, and the heightmod it was stored at set
+	StoredChunk load(glm::vec3 position, int heightmod, int8_t* offsets, std::vector<ChunkEdit>& edits, int* storedHeightmod = NULL);
+
+	//Queue the chunk at position to be written, as its edits when given (at most REGION_COMPACT_EDITS), otherwise
+	//whole. With wait, blocks until a slot is free, otherwise a full queue drops the save and returns false
+	bool save(glm::vec3 position, int heightmod, const int8_t* offsets, const std::vector<ChunkEdit>* edits, bool wait = false);
+
+	void printStats();
+
+	uint64_t loads; //Chunks read from disk
+	uint64_t misses; //Chunks looked up but not stored (or stored whole for another heightmod, without storedHeightmod)
+	uint64_t writes; //Chunks written by the writer thread
+	uint64_t editWrites; //Of those, the ones written as edit lists
+	uint64_t droppedWrites;
+	uint64_t storedBytes; //Compressed bytes written
+	double loadMs; //Total time spent in successful loads
+
+private:
+	struct Region
+	{
+		int x;
+		int z;
+		int fd;
+		unsigned char* mapping; //Read side, only used by the thread calling load
+		size_t mappedSize;
+		uint64_t fileEnd; //Where the next appended payload goes, writer thread only
+		std::vector<RegionEntry> table; //Copy of the file's table, guarded by lock
+	};
+
+	enum SlotState { SLOT_FREE, SLOT_QUEUED, SLOT_WRITING };
+
+	struct WriteSlot
+	{
+		SlotState state;
+		uint64_t sequence; //Order saves were made in, the newest of two for one chunk wins
+		int regionX;
+		int regionZ;
+		int index; //Into the region's table
+		int heightmod;
+		bool whole; //offsets are written, otherwise edits
+		std::vector<int8_t> offsets;
+		std::vector<ChunkEdit> edits;
+	};
+
+	//Region holding chunk coordinates (cx, cz), and the chunk's index in it
+	static void locate(glm::vec3 position, int chunkSize, int& regionX, int& regionZ, int& index);
+
+	//Open (or create) the region file, called with lock held
+	Region* region(int x, int z);
+
+	bool mapRegion(Region* r, size_t needed);
+	void writerLoop();
+	void write(WriteSlot& slot, std::vector<unsigned char>& compressed);
+
+	std::string directory;
+	int chunkSize;
+	RegionMode mode;
+	bool opened;
+
+	std::vector<Region*> regions;
+	WriteSlot slots[REGION_WRITE_SLOTS];
+	uint64_t nextSequence;
+	bool stopping;
+	std::mutex lock;
+	std::condition_variable queued; //A slot was queued or the store is closing
+	std::condition_variable freed; //A slot became free
+	std::thread writer;
+};
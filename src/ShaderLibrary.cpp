@@ -0,0 +1,306 @@
+/*
+	Embedded shader sources, preprocessor and program binary cache, see ShaderLibrary.h
+	Sameer Al Harbi 2022
+*/
+
+#include "ShaderLibrary.h"
+#include "AssetPack.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+
+//WebGL 2 has no glGetProgramBinary
+#ifndef __EMSCRIPTEN__
+#define SHADER_BINARY_CACHE
+#include <filesystem>
+#endif
+
+using namespace std;
+
+const char SHADER_CACHE_FOLDER[] = "shadercache";
+const uint32_t SHADER_CACHE_MAGIC = 0x42535742; //"BWSB"
+
+//Includes nested deeper than this are assumed to be a cycle
+const int MAX_INCLUDE_DEPTH = 16;
+
+//Cache file header, followed by the program binary
+struct ShaderCacheHeader
+{
+	uint32_t magic;
+	uint32_t format;
+	uint32_t length;
+};
+
+static ShaderBuildStats buildStats = { 0, 0, 0.0, 0.0, 0.0, 0.0 };
+
+string ShaderLibrary::source(const string& name)
+{
+	for (int i = 0; i < NUM_EMBEDDED_SHADERS; i++)
+	{
+		if (name == EMBEDDED_SHADERS[i].name)
+		{
+			return EMBEDDED_SHADERS[i].source;
+		}
+	}
+
+	//Not embedded (e.g. a shader added without re-running cmake), read it like any other asset
+	AssetData file;
+	if (!AssetPack::instance().read(name, file))
+	{
+		return "";
+	}
+	return file.toString();
+}
+
+//Directory part of a shader name including the trailing slash, includes are relative to the including file
+static string folderOf(const string& name)
+{
+	size_t slash = name.find_last_of('/');
+	return slash == string::npos ? "" : name.substr(0, slash + 1);
+}
+
+//Copy a file into out with its includes expanded, fileNumber is the #line source string number of this file
+static bool expandIncludes(const string& name, int fileNumber, vector<string>& included, const vector<string>& defines, string& out, int depth)
+{
+	string text = ShaderLibrary::source(name);
+	if (text.empty())
+	{
+		cerr << "Could not read shader " << name << endl;
+		return false;
+	}
+
+	if (depth > MAX_INCLUDE_DEPTH)
+	{
+		cerr << "Shader includes nested too deep in " << name << endl;
+		return false;
+	}
+
+	istringstream lines(text);
+	string line;
+	int lineNumber = 0;
+
+	while (getline(lines, line))
+	{
+		lineNumber++;
+
+		size_t start = line.find_first_not_of(" \t");
+		if (start != string::npos && line.compare(start, 8, "#version") == 0)
+		{
+			//Defines can only come after #version, which must be first
+			out += line + "\n";
+			for (size_t i = 0; i < defines.size(); i++)
+			{
+				out += "#define " + defines[i] + "\n";
+			}
+			out += "#line " + to_string(lineNumber + 1) + " " + to_string(fileNumber) + "\n";
+			continue;
+		}
+
+		if (start != string::npos && line.compare(start, 8, "#include") == 0)
+		{
+			size_t open = line.find('"', start);
+			size_t close = open == string::npos ? string::npos : line.find('"', open + 1);
+			if (close == string::npos)
+			{
+				cerr << name << ":" << lineNumber << " malformed #include" << endl;
+				return false;
+			}
+
+			string includeName = folderOf(name) + line.substr(open + 1, close - open - 1);
+
+			//Every file is only pulled in once, like #pragma once
+			bool alreadyIncluded = false;
+			for (size_t i = 0; i < included.size(); i++)
+			{
+				alreadyIncluded = alreadyIncluded || included[i] == includeName;
+			}
+
+			if (alreadyIncluded)
+			{
+				out += "\n";
+				continue;
+			}
+
+			int includeNumber = (int)included.size();
+			included.push_back(includeName);
+
+			out += "// " + includeName + " is source string " + to_string(includeNumber) + "\n";
+			out += "#line 1 " + to_string(includeNumber) + "\n";
+			if (!expandIncludes(includeName, includeNumber, included, vector<string>(), out, depth + 1))
+			{
+				return false;
+			}
+			out += "#line " + to_string(lineNumber + 1) + " " + to_string(fileNumber) + "\n";
+			continue;
+		}
+
+		out += line + "\n";
+	}
+
+	return true;
+}
+
+string ShaderLibrary::preprocess(const string& name, const vector<string>& defines)
+{
+	vector<string> included;
+	included.push_back(name);
+
+	string out;
+	if (!expandIncludes(name, 0, included, defines, out, 0))
+	{
+		return "";
+	}
+	return out;
+}
+
+#ifdef SHADER_BINARY_CACHE
+
+static bool binariesSupported()
+{
+	static int supported = -1;
+	if (supported < 0)
+	{
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		supported = formats > 0 ? 1 : 0;
+	}
+	return supported == 1;
+}
+
+//Binaries only work with the exact driver that made them, so that's part of the key
+static string cachePath(const string& vertSource, const string& fragSource)
+{
+	string key = vertSource + '\0' + fragSource + '\0';
+	key += (const char*)glGetString(GL_VENDOR);
+	key += (const char*)glGetString(GL_RENDERER);
+	key += (const char*)glGetString(GL_VERSION);
+
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)assetNameHash(key.data(), key.size()));
+	return string(SHADER_CACHE_FOLDER) + "/" + name;
+}
+
+GLuint ShaderLibrary::loadCachedProgram(const string& vertSource, const string& fragSource)
+{
+	if (!binariesSupported())
+	{
+		return 0;
+	}
+
+	string path = cachePath(vertSource, fragSource);
+	ifstream file(path, ios::in | ios::binary | ios::ate);
+	if (!file.is_open())
+	{
+		return 0;
+	}
+
+	//The binary is the rest of the file, a length that says otherwise isn't trusted with an allocation
+	streamoff fileSize = file.tellg();
+	file.seekg(0);
+
+	ShaderCacheHeader header;
+	vector<char> binary;
+	if (file.read((char*)&header, sizeof(header)) && header.magic == SHADER_CACHE_MAGIC
+		&& (streamoff)header.length == fileSize - (streamoff)sizeof(header))
+	{
+		binary.resize(header.length);
+		file.read(binary.data(), header.length);
+	}
+
+	if (binary.empty() || !file)
+	{
+		cout << "Ignoring damaged shader cache file " << path << endl;
+		return 0;
+	}
+
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, header.format, binary.data(), header.length);
+
+	//Drivers reject binaries from older versions of themselves, the program is rebuilt and re-cached then
+	GLint status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status == GL_FALSE)
+	{
+		cout << "Shader cache file " << path << " rejected by the driver, rebuilding" << endl;
+		glDeleteProgram(program);
+		return 0;
+	}
+
+	return program;
+}
+
+void ShaderLibrary::storeCachedProgram(GLuint program, const string& vertSource, const string& fragSource)
+{
+	if (!binariesSupported())
+	{
+		return;
+	}
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+	{
+		return;
+	}
+
+	ShaderCacheHeader header;
+	header.magic = SHADER_CACHE_MAGIC;
+	vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, NULL, &format, binary.data());
+	header.format = format;
+	header.length = (uint32_t)length;
+
+	error_code error;
+	filesystem::create_directories(SHADER_CACHE_FOLDER, error);
+
+	string path = cachePath(vertSource, fragSource);
+	ofstream file(path, ios::out | ios::binary | ios::trunc);
+	if (!file.is_open())
+	{
+		cout << "Could not write shader cache file " << path << endl;
+		return;
+	}
+	file.write((const char*)&header, sizeof(header));
+	file.write(binary.data(), binary.size());
+}
+
+void ShaderLibrary::prepareForCaching(GLuint program)
+{
+	if (binariesSupported())
+	{
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+}
+
+#else
+
+GLuint ShaderLibrary::loadCachedProgram(const string& vertSource, const string& fragSource)
+{
+	return 0;
+}
+
+void ShaderLibrary::storeCachedProgram(GLuint program, const string& vertSource, const string& fragSource)
+{
+}
+
+void ShaderLibrary::prepareForCaching(GLuint program)
+{
+}
+
+#endif
+
+ShaderBuildStats& ShaderLibrary::stats()
+{
+	return buildStats;
+}
+
+void ShaderLibrary::printStats()
+{
+	cout << "Shaders: " << buildStats.programs << " programs (" << buildStats.cacheHits << " from cache), preprocess "
+		<< buildStats.preprocessMs << " ms, compile " << buildStats.compileMs << " ms, link " << buildStats.linkMs
+		<< " ms, cache load " << buildStats.cacheLoadMs << " ms" << endl;
+}
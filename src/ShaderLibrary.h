@@ -0,0 +1,58 @@
+/*
+	Shader sources and linked program cache.
+	Every file in src/Assets/Shaders is embedded into the executable at build time (cmake/EmbedShaders.cmake generates
+	EmbeddedShaders.cpp) so shaders never touch the file system or asset pack. Sources go through a small preprocessor
+	before compiling: #include "file" pulls in another shader file once (with #line directives so errors point at the
+	right file) and variant defines are inserted after the #version line.
+	On native builds linked programs are saved with glGetProgramBinary into shadercache/ keyed by a hash of the final
+	sources and the driver, the next start loads them with glProgramBinary and skips compiling and linking entirely.
+	WebGL has no program binaries so the web build always compiles.
+	Sameer Al Harbi 2022
+*/
+#pragma once
+
+#include "wrapper_glfw.h"
+#include <string>
+#include <vector>
+
+//Generated table of embedded shader files, names are relative to src/Assets (e.g. "Shaders/program_v_0.vert")
+struct EmbeddedShader
+{
+	const char* name;
+	const char* source;
+};
+
+extern const EmbeddedShader EMBEDDED_SHADERS[];
+extern const int NUM_EMBEDDED_SHADERS;
+
+//Startup cost of building every program so far
+struct ShaderBuildStats
+{
+	int programs;
+	int cacheHits;
+	double preprocessMs;
+	double compileMs;
+	double linkMs;
+	double cacheLoadMs;
+};
+
+namespace ShaderLibrary
+{
+	//Embedded source of a shader file, falls back to the asset pack/loose file. Empty if not found
+	std::string source(const std::string& name);
+
+	//Source with includes expanded and each define ("NAME" or "NAME VALUE") added after #version
+	std::string preprocess(const std::string& name, const std::vector<std::string>& defines);
+
+	//Try to create a program from a cached binary for these final sources, 0 on a miss
+	GLuint loadCachedProgram(const std::string& vertSource, const std::string& fragSource);
+
+	//Save a linked program's binary for the next start. Does nothing when binaries are unsupported
+	void storeCachedProgram(GLuint program, const std::string& vertSource, const std::string& fragSource);
+
+	//Set the retrievable hint before linking so the driver keeps the binary around
+	void prepareForCaching(GLuint program);
+
+	ShaderBuildStats& stats();
+	void printStats();
+}
@@ -0,0 +1,380 @@
+/*
+	Simplex noise, see SimplexNoise.h
+	Sameer Al Harbi 2022
+*/
+
+#include "SimplexNoise.h"
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+//Skewing into the lattice of cubes the simplices tile, and back
+static const double F2 = 0.5 * (1.7320508075688772 - 1.0);
+static const double G2 = (3.0 - 1.7320508075688772) / 6.0;
+static const double F3 = 1.0 / 3.0;
+static const double G3 = 1.0 / 6.0;
+
+//Corners further than this (squared) from a point don't affect it. 0.5 reaches no further than the simplex's far side,
+//the 0.6 often used in 3D makes a point's value jump where it crosses into the next simplex
+static const double RADIUS_2D = 0.5;
+static const double RADIUS_3D = 0.5;
+
+//What the corners' sum is scaled by to reach about -1 to 1
+static const double SCALE_2D = 70.0;
+static const double SCALE_3D = 76.0;
+
+//Gradients are the midpoints of a cube's 12 edges, 2D noise uses their x and y. Ordered so that the first 8 have an x,
+//the first 4 and the last 4 a y, bit 0 of the index negates the first and bit 1 the second (noise3D4 relies on it)
+static const float GRADIENTS[12][3] =
+{
+	{ 1, 1, 0 }, { -1, 1, 0 }, { 1, -1, 0 }, { -1, -1, 0 },
+	{ 1, 0, 1 }, { -1, 0, 1 }, { 1, 0, -1 }, { -1, 0, -1 },
+	{ 0, 1, 1 }, { 0, -1, 1 }, { 0, 1, -1 }, { 0, -1, -1 }
+};
+
+static inline int fastFloor(double value)
+{
+	int i = (int)value;
+	return i - (value < i);
+}
+
+//A corner's part of the noise at a point (x, y, z) away from it. Whether a corner is in reach is close to random, so
+//it's clamped rather than branched on
+static inline double corner(int gradient, double x, double y, double z, double radius)
+{
+	double t = radius - x * x - y * y - z * z;
+	t = (t + fabs(t)) * 0.5;
+	t *= t;
+	const float* g = GRADIENTS[gradient];
+	return t * t * (g[0] * x + g[1] * y + g[2] * z);
+}
+
+static double maxAmplitude(int32_t octaves, double persistence)
+{
+	double result = 0.0;
+	double amplitude = 1.0;
+	for (int32_t i = 0; i < octaves; i++)
+	{
+		result += amplitude;
+		amplitude *= persistence;
+	}
+	return result;
+}
+
+static double remap01(double value)
+{
+	return value * 0.5 + 0.5;
+}
+
+SimplexNoise::SimplexNoise(seed_type seed)
+{
+	reseed(seed);
+}
+
+void SimplexNoise::reseed(seed_type seed)
+{
+	//Shuffled here rather than with std::shuffle, whose results differ between standard libraries
+	mt19937 random((uint32_t)seed);
+	for (int i = 0; i < 256; i++)
+	{
+		perm[i] = (uint8_t)i;
+	}
+	for (int i = 255; i > 0; i--)
+	{
+		swap(perm[i], perm[random() % (i + 1)]);
+	}
+	for (int i = 0; i < 512; i++)
+	{
+		perm[i] = perm[i & 255];
+		gradient[i] = perm[i] % 12;
+	}
+}
+
+double SimplexNoise::noise2D(double x, double y) const
+{
+	//Cell of the skewed lattice the point is in, and the point from its origin corner
+	double s = (x + y) * F2;
+	int i = fastFloor(x + s);
+	int j = fastFloor(y + s);
+	double t = (i + j) * G2;
+	double x0 = x - (i - t);
+	double y0 = y - (j - t);
+
+	//Each square is two triangles, the one the point is in goes through the middle corner first along x or y
+	int i1 = x0 > y0 ? 1 : 0;
+	int j1 = 1 - i1;
+	double x1 = x0 - i1 + G2;
+	double y1 = y0 - j1 + G2;
+	double x2 = x0 - 1.0 + 2.0 * G2;
+	double y2 = y0 - 1.0 + 2.0 * G2;
+
+	int ii = i & 255;
+	int jj = j & 255;
+	double n = corner(gradient[ii + perm[jj]], x0, y0, 0.0, RADIUS_2D)
+		+ corner(gradient[ii + i1 + perm[jj + j1]], x1, y1, 0.0, RADIUS_2D)
+		+ corner(gradient[ii + 1 + perm[jj + 1]], x2, y2, 0.0, RADIUS_2D);
+	return SCALE_2D * n;
+}
+
+double SimplexNoise::noise3D(double x, double y, double z) const
+{
+	double s = (x + y + z) * F3;
+	int i = fastFloor(x + s);
+	int j = fastFloor(y + s);
+	int k = fastFloor(z + s);
+	double t = (i + j + k) * G3;
+	double x0 = x - (i - t);
+	double y0 = y - (j - t);
+	double z0 = z - (k - t);
+
+	//Each cube is six tetrahedra, the one the point is in steps along its largest axis first and its smallest last
+	bool xy = x0 >= y0;
+	bool yz = y0 >= z0;
+	bool xz = x0 >= z0;
+	int i1 = xy && xz;
+	int j1 = !xy && yz;
+	int k1 = !i1 && !j1;
+	bool smallestX = !xy && !xz;
+	bool smallestY = xy && !yz;
+	int i2 = !smallestX;
+	int j2 = !smallestY;
+	int k2 = smallestX || smallestY;
+
+	int ii = i & 255;
+	int jj = j & 255;
+	int kk = k & 255;
+	double n = corner(gradient[ii + perm[jj + perm[kk]]], x0, y0, z0, RADIUS_3D)
+		+ corner(gradient[ii + i1 + perm[jj + j1 + perm[kk + k1]]], x0 - i1 + G3, y0 - j1 + G3, z0 - k1 + G3, RADIUS_3D)
+		+ corner(gradient[ii + i2 + perm[jj + j2 + perm[kk + k2]]], x0 - i2 + 2.0 * G3, y0 - j2 + 2.0 * G3, z0 - k2 + 2.0 * G3, RADIUS_3D)
+		+ corner(gradient[ii + 1 + perm[jj + 1 + perm[kk + 1]]], x0 - 1.0 + 3.0 * G3, y0 - 1.0 + 3.0 * G3, z0 - 1.0 + 3.0 * G3, RADIUS_3D);
+	return SCALE_3D * n;
+}
+
+double SimplexNoise::noise2D_01(double x, double y) const
+{
+	return remap01(noise2D(x, y));
+}
+
+double SimplexNoise::noise3D_01(double x, double y, double z) const
+{
+	return remap01(noise3D(x, y, z));
+}
+
+double SimplexNoise::octave2D(double x, double y, int32_t octaves, double persistence) const
+{
+	double result = 0.0;
+	double amplitude = 1.0;
+	for (int32_t i = 0; i < octaves; i++)
+	{
+		result += noise2D(x, y) * amplitude;
+		x *= 2;
+		y *= 2;
+		amplitude *= persistence;
+	}
+	return result;
+}
+
+double SimplexNoise::octave3D(double x, double y, double z, int32_t octaves, double persistence) const
+{
+	double result = 0.0;
+	double amplitude = 1.0;
+	for (int32_t i = 0; i < octaves; i++)
+	{
+		result += noise3D(x, y, z) * amplitude;
+		x *= 2;
+		y *= 2;
+		z *= 2;
+		amplitude *= persistence;
+	}
+	return result;
+}
+
+double SimplexNoise::octave2D_11(double x, double y, int32_t octaves, double persistence) const
+{
+	return std::clamp(octave2D(x, y, octaves, persistence), -1.0, 1.0);
+}
+
+double SimplexNoise::octave3D_11(double x, double y, double z, int32_t octaves, double persistence) const
+{
+	return std::clamp(octave3D(x, y, z, octaves, persistence), -1.0, 1.0);
+}
+
+double SimplexNoise::octave2D_01(double x, double y, int32_t octaves, double persistence) const
+{
+	return remap01(octave2D_11(x, y, octaves, persistence));
+}
+
+double SimplexNoise::octave3D_01(double x, double y, double z, int32_t octaves, double persistence) const
+{
+	return remap01(octave3D_11(x, y, z, octaves, persistence));
+}
+
+double SimplexNoise::normalizedOctave2D(double x, double y, int32_t octaves, double persistence) const
+{
+	return octave2D(x, y, octaves, persistence) / maxAmplitude(octaves, persistence);
+}
+
+double SimplexNoise::normalizedOctave3D(double x, double y, double z, int32_t octaves, double persistence) const
+{
+	return octave3D(x, y, z, octaves, persistence) / maxAmplitude(octaves, persistence);
+}
+
+double SimplexNoise::normalizedOctave2D_01(double x, double y, int32_t octaves, double persistence) const
+{
+	return remap01(normalizedOctave2D(x, y, octaves, persistence));
+}
+
+double SimplexNoise::normalizedOctave3D_01(double x, double y, double z, int32_t octaves, double persistence) const
+{
+	return remap01(normalizedOctave3D(x, y, z, octaves, persistence));
+}
+
+#ifdef __SSE2__
+
+//SSE2 has no floor, truncate and take 1 off where that went up
+static __m128 floor4(__m128 v)
+{
+	__m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+	return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmplt_ps(v, truncated), _mm_set1_ps(1.0f)));
+}
+
+/*
+	noise3D for 4 points at once, every step across the 4 but hashing the corners: SSE2 can't look up a table per lane,
+	so that's done a lane at a time. Gradients aren't looked up, GRADIENTS is laid out so a dot product with one can be
+	picked from the hash with masks: x or y from below 8, y or z from below 4, each negated by one of the low 2 bits
+*/
+void SimplexNoise::noise3D4(float x, float y, const float* z, float* out) const
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	__m128 px = _mm_set1_ps(x);
+	__m128 py = _mm_set1_ps(y);
+	__m128 pz = _mm_loadu_ps(z);
+
+	__m128 s = _mm_mul_ps(_mm_add_ps(_mm_add_ps(px, py), pz), _mm_set1_ps((float)F3));
+	__m128 fi = floor4(_mm_add_ps(px, s));
+	__m128 fj = floor4(_mm_add_ps(py, s));
+	__m128 fk = floor4(_mm_add_ps(pz, s));
+	__m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(fi, fj), fk), _mm_set1_ps((float)G3));
+
+	//Distances to the 4 corners, x, y and z of each
+	__m128 d[4][3];
+	d[0][0] = _mm_sub_ps(px, _mm_sub_ps(fi, t));
+	d[0][1] = _mm_sub_ps(py, _mm_sub_ps(fj, t));
+	d[0][2] = _mm_sub_ps(pz, _mm_sub_ps(fk, t));
+
+	__m128 xy = _mm_cmpge_ps(d[0][0], d[0][1]);
+	__m128 yz = _mm_cmpge_ps(d[0][1], d[0][2]);
+	__m128 xz = _mm_cmpge_ps(d[0][0], d[0][2]);
+	__m128 step1[3];
+	step1[0] = _mm_and_ps(xy, xz);
+	step1[1] = _mm_andnot_ps(xy, yz);
+	step1[2] = _mm_andnot_ps(_mm_or_ps(step1[0], step1[1]), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+	__m128 smallestX = _mm_andnot_ps(_mm_or_ps(xy, xz), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+	__m128 smallestY = _mm_andnot_ps(yz, xy);
+	__m128 step2[3];
+	step2[0] = _mm_andnot_ps(smallestX, _mm_castsi128_ps(_mm_set1_epi32(-1)));
+	step2[1] = _mm_andnot_ps(smallestY, _mm_castsi128_ps(_mm_set1_epi32(-1)));
+	step2[2] = _mm_or_ps(smallestX, smallestY);
+
+	for (int a = 0; a < 3; a++)
+	{
+		d[1][a] = _mm_add_ps(_mm_sub_ps(d[0][a], _mm_and_ps(step1[a], one)), _mm_set1_ps((float)G3));
+		d[2][a] = _mm_add_ps(_mm_sub_ps(d[0][a], _mm_and_ps(step2[a], one)), _mm_set1_ps((float)(2.0 * G3)));
+		d[3][a] = _mm_add_ps(_mm_sub_ps(d[0][a], one), _mm_set1_ps((float)(3.0 * G3)));
+	}
+
+	alignas(16) int32_t cell[3][4];
+	const __m128i wrap = _mm_set1_epi32(255);
+	_mm_store_si128((__m128i*)cell[0], _mm_and_si128(_mm_cvttps_epi32(fi), wrap));
+	_mm_store_si128((__m128i*)cell[1], _mm_and_si128(_mm_cvttps_epi32(fj), wrap));
+	_mm_store_si128((__m128i*)cell[2], _mm_and_si128(_mm_cvttps_epi32(fk), wrap));
+	int first[3], second[3];
+	for (int a = 0; a < 3; a++)
+	{
+		first[a] = _mm_movemask_ps(step1[a]);
+		second[a] = _mm_movemask_ps(step2[a]);
+	}
+
+	alignas(16) int32_t hash[4][4];
+	for (int l = 0; l < 4; l++)
+	{
+		int ii = cell[0][l];
+		int jj = cell[1][l];
+		int kk = cell[2][l];
+		int i1 = (first[0] >> l) & 1, j1 = (first[1] >> l) & 1, k1 = (first[2] >> l) & 1;
+		int i2 = (second[0] >> l) & 1, j2 = (second[1] >> l) & 1, k2 = (second[2] >> l) & 1;
+		hash[0][l] = gradient[ii + perm[jj + perm[kk]]];
+		hash[1][l] = gradient[ii + i1 + perm[jj + j1 + perm[kk + k1]]];
+		hash[2][l] = gradient[ii + i2 + perm[jj + j2 + perm[kk + k2]]];
+		hash[3][l] = gradient[ii + 1 + perm[jj + 1 + perm[kk + 1]]];
+	}
+
+	__m128 n = _mm_setzero_ps();
+	for (int c = 0; c < 4; c++)
+	{
+		__m128 falloff = _mm_sub_ps(_mm_set1_ps((float)RADIUS_3D), _mm_add_ps(_mm_add_ps(_mm_mul_ps(d[c][0], d[c][0]),
+			_mm_mul_ps(d[c][1], d[c][1])), _mm_mul_ps(d[c][2], d[c][2])));
+		falloff = _mm_max_ps(falloff, _mm_setzero_ps());
+		falloff = _mm_mul_ps(falloff, falloff);
+		falloff = _mm_mul_ps(falloff, falloff);
+		__m128i h = _mm_load_si128((const __m128i*)hash[c]);
+		__m128 below8 = _mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(8)));
+		__m128 below4 = _mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(4)));
+		__m128 u = _mm_or_ps(_mm_and_ps(below8, d[c][0]), _mm_andnot_ps(below8, d[c][1]));
+		__m128 v = _mm_or_ps(_mm_and_ps(below4, d[c][1]), _mm_andnot_ps(below4, d[c][2]));
+		__m128 signU = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(1)), 31));
+		__m128 signV = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(2)), 30));
+		__m128 dot = _mm_add_ps(_mm_xor_ps(u, signU), _mm_xor_ps(v, signV));
+		n = _mm_add_ps(n, _mm_mul_ps(falloff, dot));
+	}
+	_mm_storeu_ps(out, _mm_mul_ps(n, _mm_set1_ps((float)SCALE_3D)));
+}
+
+void SimplexNoise::octave3DRow(double x, double y, double z, double dz, int count, double* out, int32_t octaves, double persistence) const
+{
+	for (int n = 0; n < count; n += 4)
+	{
+		double sum[4] = { 0.0, 0.0, 0.0, 0.0 };
+		double amplitude = 1.0;
+		double frequency = 1.0;
+		for (int32_t o = 0; o < octaves; o++)
+		{
+			//Past the end of the row the spare lanes are sampled anyway and thrown away
+			float zs[4];
+			float values[4];
+			for (int l = 0; l < 4; l++)
+			{
+				zs[l] = (float)((z + (n + l) * dz) * frequency);
+			}
+			noise3D4((float)(x * frequency), (float)(y * frequency), zs, values);
+			for (int l = 0; l < 4; l++)
+			{
+				sum[l] += values[l] * amplitude;
+			}
+			frequency *= 2.0;
+			amplitude *= persistence;
+		}
+		for (int l = 0; l < 4 && n + l < count; l++)
+		{
+			out[n + l] = sum[l];
+		}
+	}
+}
+
+#else
+
+void SimplexNoise::octave3DRow(double x, double y, double z, double dz, int count, double* out, int32_t octaves, double persistence) const
+{
+	for (int n = 0; n < count; n++)
+	{
+		out[n] = octave3D(x, y, z + n * dz, octaves, persistence);
+	}
+}
+
+#endif
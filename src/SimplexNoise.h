@@ -0,0 +1,66 @@
+/*
+	Simplex noise, the terrain's other noise backend next to siv::PerlinNoise (ChunkBlock picks one with NoiseBackend).
+	Ken Perlin's simplex noise as described in Stefan Gustavson's "Simplex noise demystified" (2005): space is split
+	into tetrahedra rather than cubes, so a 3D sample blends the gradients of 4 lattice corners where Perlin noise
+	blends 8, and a 2D one 3 rather than 4. It has the same interface as siv::BasicPerlinNoise (without the 1D
+	functions, nothing uses them) so either can be sampled the same way, though the two make different terrain.
+	octave3DRow samples a row of points along z at once, 4 at a time with SSE2 where it's available (every x86-64
+	build) and one at a time with noise3D otherwise (the web build). The SSE2 path works in float, so its values can
+	differ from noise3D's slightly (around 1e-4 at the terrain's coordinates).
+	Sameer Al Harbi 2022
+*/
+#pragma once
+
+#include <cstdint>
+
+class SimplexNoise
+{
+public:
+	using value_type = double;
+	using seed_type = std::uint_fast32_t;
+
+	explicit SimplexNoise(seed_type seed = 5489u);
+
+	//Shuffle the permutation table for seed
+	void reseed(seed_type seed);
+
+	//Noise, in the range [-1, 1]
+	double noise2D(double x, double y) const;
+	double noise3D(double x, double y, double z) const;
+
+	//Noise remapped to [0, 1]
+	double noise2D_01(double x, double y) const;
+	double noise3D_01(double x, double y, double z) const;
+
+	//Octave noise, can be out of [-1, 1]
+	double octave2D(double x, double y, std::int32_t octaves, double persistence = 0.5) const;
+	double octave3D(double x, double y, double z, std::int32_t octaves, double persistence = 0.5) const;
+
+	//Octave noise clamped to [-1, 1]
+	double octave2D_11(double x, double y, std::int32_t octaves, double persistence = 0.5) const;
+	double octave3D_11(double x, double y, double z, std::int32_t octaves, double persistence = 0.5) const;
+
+	//Octave noise clamped and remapped to [0, 1]
+	double octave2D_01(double x, double y, std::int32_t octaves, double persistence = 0.5) const;
+	double octave3D_01(double x, double y, double z, std::int32_t octaves, double persistence = 0.5) const;
+
+	//Octave noise divided by the most its octaves can add up to, in [-1, 1]
+	double normalizedOctave2D(double x, double y, std::int32_t octaves, double persistence = 0.5) const;
+	double normalizedOctave3D(double x, double y, double z, std::int32_t octaves, double persistence = 0.5) const;
+
+	//Normalized octave noise remapped to [0, 1]
+	double normalizedOctave2D_01(double x, double y, std::int32_t octaves, double persistence = 0.5) const;
+	double normalizedOctave3D_01(double x, double y, double z, std::int32_t octaves, double persistence = 0.5) const;
+
+	//octave3D at (x, y, z + n * dz) into out[n] for n up to count
+	void octave3DRow(double x, double y, double z, double dz, int count, double* out, std::int32_t octaves, double persistence = 0.5) const;
+
+private:
+#ifdef __SSE2__
+	//noise3D for 4 points sharing x and y, into out
+	void noise3D4(float x, float y, const float* z, float* out) const;
+#endif
+
+	std::uint8_t perm[512]; //Shuffled 0 to 255, twice over so corner hashes never wrap
+	std::uint8_t gradient[512]; //perm[i] % 12, the gradient a hash picks
+};
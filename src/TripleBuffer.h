@@ -0,0 +1,76 @@
+/*
+	Hands one value at a time from a writer thread to a reader thread (the simulation's frame snapshots to the render
+	thread). There are three copies: the writer fills the back one, the reader uses the front one, and the one in the
+	middle is the latest published. Publishing and acquiring only swap indices, so neither side ever waits for the other
+	to finish with its copy, and neither copies the value.
+	The writer stays at most one value ahead: publish waits while the previous value hasn't been acquired, so nothing
+	published is skipped. close() releases a reader waiting for a value that will never come.
+	Sameer Al Harbi 2022
+*/
+#pragma once
+
+#include <mutex>
+#include <condition_variable>
+#include <utility>
+
+template <typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() : backIndex(0), middleIndex(1), frontIndex(2), fresh(false), closed(false) {}
+
+	//Copy the writer fills in before publishing
+	T& back() { return slots[backIndex]; }
+
+	//Copy the reader acquired last
+	const T& front() const { return slots[frontIndex]; }
+
+	//Make the back copy the latest, waiting for the reader to take the one before it if it hasn't yet
+	void publish()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		taken.wait(lock, [this] { return !fresh || closed; });
+		std::swap(backIndex, middleIndex);
+		fresh = true;
+		published.notify_one();
+	}
+
+	//Make the latest published copy the front one. With wait, blocks until there is one or the buffer is closed.
+	//False when nothing new was published
+	bool acquire(bool wait)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (wait)
+		{
+			published.wait(lock, [this] { return fresh || closed; });
+		}
+		if (!fresh)
+		{
+			return false;
+		}
+		std::swap(frontIndex, middleIndex);
+		fresh = false;
+		taken.notify_one();
+		return true;
+	}
+
+	//No more values, a waiting reader gets what was published last and then false
+	void close()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = true;
+		published.notify_all();
+		taken.notify_all();
+	}
+
+private:
+	T slots[3];
+	int backIndex;
+	int middleIndex;
+	int frontIndex;
+	bool fresh; //The middle copy hasn't been acquired yet
+	bool closed;
+	std::mutex mutex;
+	std::condition_variable published;
+	std::condition_variable taken;
+};
@@ -0,0 +1,345 @@
+/*
+	Voxel raycasts, see VoxelRaycast.h
+	Sameer Al Harbi 2022
+*/
+
+#include "VoxelRaycast.h"
+#include "ChunkBlock.h"
+#include "Profiler.h"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+using namespace std;
+
+static const float RAY_INFINITY = numeric_limits<float>::infinity();
+
+//Box bounds that don't limit it
+static const int OPEN_LOW = numeric_limits<int>::min();
+static const int OPEN_HIGH = numeric_limits<int>::max();
+
+//Floor division, so cells at negative coordinates go in the brick or chunk below
+static int floorDiv(int value, int divisor)
+{
+	return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+void ChunkOccupancy::reserve(int size)
+{
+	cells = glm::ivec3(size, 2 * size + 2 * OCCUPANCY_MARGIN, size);
+	bricks = (cells + BRICK_SIZE - 1) / BRICK_SIZE;
+	bits.resize((cells.x * cells.y * cells.z + 63) / 64);
+	brickFlags.resize(bricks.x * bricks.y * bricks.z);
+	blocks = 0;
+}
+
+void ChunkOccupancy::build(const int8_t* offsets, int size, glm::vec3 position)
+{
+	reserve(size);
+	origin = glm::ivec3((int)floor(position.x), (int)floor(position.y) - OCCUPANCY_MARGIN, (int)floor(position.z));
+	std::fill(bits.begin(), bits.end(), 0);
+	std::fill(brickFlags.begin(), brickFlags.end(), 0);
+
+	for (int i = 0; i < size; i++)
+	{
+		for (int j = 0; j < size; j++)
+		{
+			for (int k = 0; k < size; k++)
+			{
+				int8_t offset = *offsets++;
+				glm::ivec3 cell(i, j + offset + OCCUPANCY_MARGIN, k);
+				if (offset == BLOCK_REMOVED || cell.y < 0 || cell.y >= cells.y)
+				{
+					continue;
+				}
+				int index = cellIndex(cell);
+				bits[index >> 6] |= (uint64_t)1 << (index & 63);
+				brickFlags[brickIndex(cell / BRICK_SIZE)] = 1;
+				blocks++;
+			}
+		}
+	}
+}
+
+const ChunkOccupancy* VoxelScene::find(glm::ivec3 cell) const
+{
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		const ChunkOccupancy* c = chunks[i];
+		if (cell.x >= c->origin.x && cell.x < c->origin.x + c->cells.x && cell.z >= c->origin.z && cell.z < c->origin.z + c->cells.z)
+		{
+			return c;
+		}
+	}
+	return NULL;
+}
+
+namespace
+{
+	//Amanatides and Woo's traversal state: the cell the ray is in and the distances to its next cell boundaries
+	struct Traversal
+	{
+		glm::vec3 origin;
+		glm::vec3 direction;
+		glm::ivec3 step;
+		glm::vec3 tDelta; //Distance between boundaries along each axis
+		glm::vec3 tMax; //Distance to the next boundary along each axis
+		glm::ivec3 cell;
+		float t; //Distance to where the ray entered the cell
+		int axis; //It entered through, -1 when it started there
+
+		//Start again at distance at, entering through a boundary on axis (at cell coordinate boundary) unless it's -1
+		void restart(float at, int throughAxis, int boundary)
+		{
+			t = at;
+			axis = throughAxis;
+			glm::vec3 p = origin + direction * at;
+			for (int a = 0; a < 3; a++)
+			{
+				cell[a] = a == throughAxis ? (step[a] > 0 ? boundary : boundary - 1) : (int)floor(p[a]);
+				if (step[a] == 0)
+				{
+					tMax[a] = RAY_INFINITY;
+				}
+				else
+				{
+					tMax[a] = ((step[a] > 0 ? cell[a] + 1 : cell[a]) - origin[a]) / direction[a];
+				}
+			}
+		}
+
+		//Into the next cell along the ray
+		void advance()
+		{
+			int a = tMax.x < tMax.y ? (tMax.x < tMax.z ? 0 : 2) : (tMax.y < tMax.z ? 1 : 2);
+			t = tMax[a];
+			axis = a;
+			cell[a] += step[a];
+			tMax[a] += tDelta[a];
+		}
+
+		//Jump to where the ray leaves the box of cells [lo, hi) it's in, OPEN_LOW/OPEN_HIGH bounds don't count
+		void skip(glm::ivec3 lo, glm::ivec3 hi)
+		{
+			float exit = RAY_INFINITY;
+			int exitAxis = -1;
+			int boundary = 0;
+			for (int a = 0; a < 3; a++)
+			{
+				int bound = step[a] > 0 ? hi[a] : lo[a];
+				if (step[a] == 0 || bound == OPEN_HIGH || bound == OPEN_LOW)
+				{
+					continue;
+				}
+				float te = (bound - origin[a]) / direction[a];
+				if (te < exit)
+				{
+					exit = te;
+					exitAxis = a;
+					boundary = bound;
+				}
+			}
+
+			//Rounding can put the exit behind the ray, a single step still gets it out eventually
+			if (exitAxis < 0 || exit <= t)
+			{
+				advance();
+				return;
+			}
+			restart(exit, exitAxis, boundary);
+		}
+	};
+}
+
+bool VoxelRaycaster::cast(const VoxelScene& scene, const Ray& ray, RayHit& hit)
+{
+	hit.hit = false;
+	float length = glm::length(ray.direction);
+	if (length == 0.0f || scene.chunks.empty())
+	{
+		return false;
+	}
+
+	Traversal walk;
+	walk.origin = ray.origin;
+	walk.direction = ray.direction / length;
+	for (int a = 0; a < 3; a++)
+	{
+		walk.step[a] = walk.direction[a] > 0.0f ? 1 : (walk.direction[a] < 0.0f ? -1 : 0);
+		walk.tDelta[a] = walk.step[a] ? fabs(1.0f / walk.direction[a]) : RAY_INFINITY;
+	}
+	walk.restart(0.0f, -1, 0);
+
+	//Chunks line up on a grid, columns without one are skipped a chunk at a time
+	int size = scene.chunkSize;
+	glm::ivec3 grid = scene.chunks[0]->origin;
+
+	const ChunkOccupancy* chunk = NULL;
+	while (walk.t <= ray.maxDistance)
+	{
+		glm::ivec3 cell = walk.cell;
+		if (chunk == NULL || cell.x < chunk->origin.x || cell.x >= chunk->origin.x + size || cell.z < chunk->origin.z || cell.z >= chunk->origin.z + size)
+		{
+			chunk = scene.find(cell);
+		}
+
+		glm::ivec3 columnLo(grid.x + floorDiv(cell.x - grid.x, size) * size, OPEN_LOW, grid.z + floorDiv(cell.z - grid.z, size) * size);
+		glm::ivec3 columnHi(columnLo.x + size, OPEN_HIGH, columnLo.z + size);
+		if (chunk == NULL || chunk->blocks == 0)
+		{
+			walk.skip(columnLo, columnHi);
+			continue;
+		}
+
+		glm::ivec3 local = cell - chunk->origin;
+		if (local.y < 0 || local.y >= chunk->cells.y)
+		{
+			//Heading away from the chunk's cells it can only hit the next column, otherwise it goes on to where it
+			//reaches them or leaves this column first
+			bool below = local.y < 0;
+			if ((below && walk.step.y <= 0) || (!below && walk.step.y >= 0))
+			{
+				walk.skip(columnLo, columnHi);
+			}
+			else
+			{
+				walk.skip(glm::ivec3(columnLo.x, below ? OPEN_LOW : chunk->origin.y + chunk->cells.y, columnLo.z),
+					glm::ivec3(columnHi.x, below ? chunk->origin.y : OPEN_HIGH, columnHi.z));
+			}
+			continue;
+		}
+
+		glm::ivec3 brick = local / BRICK_SIZE;
+		if (!chunk->brickOccupied(brick))
+		{
+			glm::ivec3 lo = chunk->origin + brick * BRICK_SIZE;
+			walk.skip(lo, lo + BRICK_SIZE);
+			continue;
+		}
+
+		if (chunk->occupied(local))
+		{
+			hit.hit = true;
+			hit.block = cell;
+			hit.normal = glm::ivec3(0);
+			if (walk.axis >= 0)
+			{
+				hit.normal[walk.axis] = -walk.step[walk.axis];
+			}
+			hit.distance = walk.t;
+			return true;
+		}
+
+		walk.advance();
+	}
+	return false;
+}
+
+VoxelRaycaster::VoxelRaycaster()
+{
+	scene = NULL;
+	rays = NULL;
+	hits = NULL;
+	count = 0;
+	next = 0;
+	batch = 0;
+	busy = 0;
+	stopping = false;
+}
+
+VoxelRaycaster::~VoxelRaycaster()
+{
+	stop();
+}
+
+void VoxelRaycaster::start(int workers)
+{
+	stop();
+	stopping = false;
+	for (int i = 0; i < workers; i++)
+	{
+		threads.push_back(thread(&VoxelRaycaster::workerLoop, this));
+	}
+}
+
+void VoxelRaycaster::stop()
+{
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	started.notify_all();
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		threads[i].join();
+	}
+	threads.clear();
+}
+
+//Take slices of the current batch until there are none left
+void VoxelRaycaster::castSlices()
+{
+	while (true)
+	{
+		int first = next.fetch_add(RAYCAST_BATCH_SLICE);
+		if (first >= count)
+		{
+			return;
+		}
+		int last = std::min(first + RAYCAST_BATCH_SLICE, count);
+		for (int i = first; i < last; i++)
+		{
+			cast(*scene, rays[i], hits[i]);
+		}
+	}
+}
+
+void VoxelRaycaster::workerLoop()
+{
+	Profiler::setThreadName("raycast");
+	uint64_t seen = 0;
+
+	while (true)
+	{
+		{
+			unique_lock<mutex> guard(lock);
+			started.wait(guard, [&] { return stopping || batch != seen; });
+			if (stopping)
+			{
+				return;
+			}
+			seen = batch;
+		}
+
+		castSlices();
+
+		{
+			lock_guard<mutex> guard(lock);
+			busy--;
+		}
+		finished.notify_one();
+	}
+}
+
+void VoxelRaycaster::castBatch(const VoxelScene& scene, const Ray* rays, RayHit* hits, int count)
+{
+	PROFILE_SCOPE("VoxelRaycaster::castBatch");
+
+	{
+		lock_guard<mutex> guard(lock);
+		this->scene = &scene;
+		this->rays = rays;
+		this->hits = hits;
+		this->count = count;
+		next = 0;
+		busy = (int)threads.size();
+		batch++;
+	}
+	started.notify_all();
+
+	//The calling thread works on the batch too
+	castSlices();
+
+	unique_lock<mutex> guard(lock);
+	finished.wait(guard, [&] { return busy == 0; });
+}
@@ -0,0 +1,119 @@
+/*
+	Ray queries against the blocks of the resident chunks, for picking, edits and line of sight.
+	Rays are walked a block at a time with Amanatides and Woo's DDA ("A Fast Voxel Traversal Algorithm for Ray
+	Tracing", 1987) over each chunk's occupancy: one bit per block sized cell, and a flag per 4x4x4 brick set when any
+	of its cells is. Space that can't hold a block is skipped in one step, the ray jumping to where it leaves it:
+	columns with no resident chunk (or an empty one), empty bricks and the space above and below what a chunk can hold.
+	Coordinates are in block space, where the block (i, j, k) of a chunk at position p with height offset o fills the
+	cell p + (i, j + o, k). With the terrain at its initial position that's also world space.
+	Batches are split across worker threads that stay running between batches.
+	Sameer Al Harbi 2022
+*/
+#pragma once
+
+#include "FixedContainers.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+//Cells along each side of a brick
+const int BRICK_SIZE = 4;
+
+//Cells below a chunk's blocks and above twice its size that blocks can reach. Noise and biomes move blocks at most
+//MAX_BLOCK_OFFSET cells and a column can only be built up by as many blocks as it has
+const int OCCUPANCY_MARGIN = 32;
+
+//Chunks a scene can hold, more than a chunk cache keeps at the largest view radius
+const int MAX_SCENE_CHUNKS = 256;
+
+//Rays handed to a worker at a time
+const int RAYCAST_BATCH_SLICE = 64;
+
+//Which cells of a chunk hold a block
+struct ChunkOccupancy
+{
+	glm::ivec3 origin; //Cell (0, 0, 0) in block space
+	glm::ivec3 cells; //size, 2 * size + 2 * OCCUPANCY_MARGIN, size
+	glm::ivec3 bricks; //cells / BRICK_SIZE
+	int blocks; //Occupied cells, 0 when the chunk is empty
+	std::vector<uint64_t> bits;
+	std::vector<uint8_t> brickFlags;
+
+	//Size the storage for chunks of size blocks, so build doesn't allocate
+	void reserve(int size);
+
+	//Mark the cell of every block that isn't removed
+	void build(const int8_t* offsets, int size, glm::vec3 position);
+
+	size_t storageBytes() const { return bits.size() * sizeof(uint64_t) + brickFlags.size(); }
+
+	int cellIndex(glm::ivec3 cell) const { return (cell.x * cells.y + cell.y) * cells.z + cell.z; }
+	int brickIndex(glm::ivec3 brick) const { return (brick.x * bricks.y + brick.y) * bricks.z + brick.z; }
+	bool occupied(glm::ivec3 cell) const { int i = cellIndex(cell); return (bits[i >> 6] >> (i & 63)) & 1; }
+	bool brickOccupied(glm::ivec3 brick) const { return brickFlags[brickIndex(brick)] != 0; }
+};
+
+//The chunks rays are cast against, all of one size
+struct VoxelScene
+{
+	FixedVector<const ChunkOccupancy*, MAX_SCENE_CHUNKS> chunks;
+	int chunkSize;
+
+	//Chunk whose columns hold cell (x and z), NULL if none
+	const ChunkOccupancy* find(glm::ivec3 cell) const;
+};
+
+struct Ray
+{
+	glm::vec3 origin;
+	glm::vec3 direction; //Needn't be normalised
+	float maxDistance;
+};
+
+struct RayHit
+{
+	bool hit;
+	glm::ivec3 block; //Cell of the block hit
+	glm::ivec3 normal; //Face the ray went in through, zero when it started inside the block
+	float distance; //Along the ray to the face
+};
+
+class VoxelRaycaster
+{
+public:
+	VoxelRaycaster();
+	~VoxelRaycaster();
+
+	//Workers batches are split across as well as the calling thread, 0 to cast batches on the calling thread only
+	void start(int workers);
+	void stop();
+
+	//First block along ray within its max distance. False (and hit.hit false) when there isn't one
+	static bool cast(const VoxelScene& scene, const Ray& ray, RayHit& hit);
+
+	//cast for every ray into hits, returns when they're all done. The scene mustn't change until then
+	void castBatch(const VoxelScene& scene, const Ray* rays, RayHit* hits, int count);
+
+private:
+	void workerLoop();
+	void castSlices();
+
+	std::vector<std::thread> threads;
+	std::mutex lock;
+	std::condition_variable started; //A batch was started or the workers are stopping
+	std::condition_variable finished; //A worker finished its part of the batch
+
+	//Batch being cast, guarded by lock apart from next
+	const VoxelScene* scene;
+	const Ray* rays;
+	RayHit* hits;
+	int count;
+	std::atomic<int> next; //First ray not taken yet
+	uint64_t batch; //Batches started, workers wait for it to change
+	int busy; //Workers still casting the current batch
+	bool stopping;
+};
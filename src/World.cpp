@@ -0,0 +1,105 @@
+/*
+	BlockWorld state that doesn't need a window or GL context: construction and the layout of the visible chunks.
+	Kept out of BlockWorld.cpp (which holds main and the render callbacks) so the benchmarks can link it.
+	Sameer Al Harbi 2022
+*/
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+using namespace glm;
+
+#include "BlockWorld.h"
+
+BlockWorld::BlockWorld() : chunkCache((size_t)CHUNK_MEMORY_BUDGET_MB * 1024 * 1024), frameMemory(FRAME_MEMORY_BYTES) {
+	cube = Cube(true);
+	loader = NULL;
+	startTime = chrono::steady_clock::now();
+	firstFrameShown = false;
+	assetsLoaded = false;
+	framesPublished = 0;
+	frameCostMs = -1.0;
+	chunkBuilds = 0;
+	uploadBytes = 0;
+	lastRenderTime = startTime;
+	benchmark = NULL;
+	glw = NULL;
+	megaChunkMoves = 0;
+	simulationStarted = false;
+
+	//Default quality level, the governor may change these
+	const QualityLevel& quality = governor.settings();
+	viewRadius = quality.viewRadius;
+	chunkBudget = quality.chunkBudget;
+	propDensity = quality.propDensity;
+	msaaSamples = quality.msaaSamples;
+	msaaLimit = quality.msaaSamples;
+	visibleChunks = 0;
+	allocCheckWarmup = -1;
+	loadedFrames = 0;
+}
+
+//Generate positions at which chunks need to be drawn 
+void generateMegaChunk(bool origin, glm::vec3 direction, BlockWorld *bw)
+{
+	/*
+		Mega Chunk Structure
+		|___| = One Chunk
+		|_x_| = Middle Chunk spawned at cam position and used to calculate rest of Mega Chunk relatively if orgin = true
+	
+		1|___|2|___|3|___|
+		4|___|5|_x_|6|___|
+		7|___|8|___|9|___|
+
+		That's a view radius of 1, a bigger radius adds rings of chunks around it.
+		When generating new mega chunks as the player is moving, instead of spawing a new chunk at camera position instead get 
+		the direction the player is moving and move the megachunk respectively, chunks still in view are already in the chunk cache
+		chunks use perlin noise based on world position so the terrain looks continous irrespective of how chunks movement and regeneration
+	*/
+	
+	int chunkSize = bw->chunkblock.getChunkSize(); //Get size of a single chunk, default is defined as 16
+	glm::vec3 ip = glm::vec3(0, 0, 0); 
+	
+	if (origin == true)
+	{
+		ip = glm::vec3(bw->cam_x - chunkSize / 2, WORLD_BASE_Y, bw->cam_z - chunkSize / 2); //Calculate where the new middle chunk should be based on cam positon
+		bw->chunkOrigin = glm::vec3(ip.x, ip.y, ip.z);
+	}
+	else
+	{
+		ip = glm::vec3(bw->chunkOrigin.x + direction.x, WORLD_BASE_Y, bw->chunkOrigin.z + direction.z); //Move whole mega chunk towards a direction
+		bw->chunkOrigin = glm::vec3(ip.x, ip.y, ip.z);
+		bw->megaChunkMoves++;
+	}
+
+	placeMegaChunk(bw);
+}
+
+void placeMegaChunk(BlockWorld *bw)
+{
+	int chunkSize = bw->chunkblock.getChunkSize();
+	glm::vec3 ip = bw->chunkOrigin;
+
+	//Define actual positions of chunks, ring by ring out from the middle chunk so that the nearest are generated first
+	//when not every chunk can be in one frame. Within a ring they're in the order numbered above. Only the chunk holding
+	//the surface of each column is visible, the rest of the column is all air or all solid (ChunkBlock.h)
+	int n = 0;
+	for (int ring = 0; ring <= bw->viewRadius; ring++)
+	{
+		for (int dz = ring; dz >= -ring; dz--)
+		{
+			for (int dx = ring; dx >= -ring; dx--)
+			{
+				if (std::max(std::abs(dx), std::abs(dz)) == ring)
+				{
+					float x = ip.x + dx * chunkSize;
+					float z = ip.z + dz * chunkSize;
+					bw->megaChunk[n++] = vec3(x, bw->chunkblock.layerY(bw->chunkblock.surfaceLayer(x, z)), z);
+				}
+			}
+		}
+	}
+	bw->visibleChunks = n;
+}
@@ -5,6 +5,7 @@
 */
 
 #include "cube_tex.h"
+#include "MemoryTracker.h"
 
 /* I don't like using namespaces in header files but have less issues with them in
 seperate cpp files */
@@ -173,6 +174,10 @@ void Cube::makeCube()
 	glBindBuffer(GL_ARRAY_BUFFER, normalsBufferObject);
 	glBufferData(GL_ARRAY_BUFFER, 36 * sizeof(glm::vec3), normals, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	MemoryTracker::buffer(positionBufferObject, MEMORY_SKYBOX, sizeof(vertexPositions));
+	MemoryTracker::buffer(colourObject, MEMORY_SKYBOX, sizeof(vertexColours));
+	MemoryTracker::buffer(normalsBufferObject, MEMORY_SKYBOX, 36 * sizeof(glm::vec3));
 }
 
 
@@ -10,33 +10,82 @@
   */
 
 #include "wrapper_glfw.h"
+#include "AssetPack.h"
+#include "ShaderLibrary.h"
+#include "HeadlessContext.h"
+#include "NullRenderer.h"
+#include "AllocationTracker.h"
+#include "Profiler.h"
+#include "GpuTimer.h"
 
 /* Inlcude some standard headers */
 
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <chrono>
+#include <thread>
 
 // For web
+#ifdef __EMSCRIPTEN__
 #include <emscripten.h>
 #include <emscripten/html5.h>
+#endif
 
 using namespace std;
 
+static double millisecondsSince(chrono::steady_clock::time_point start)
+{
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
 static void cursor_callback(GLFWwindow* window, double xpos, double ypos) {
 	std::cout << xpos << std::endl;
 }
 
 /* Constructor for wrapper object */
-GLWrapper::GLWrapper(int width, int height, const char *title, void* rawbw) {
+GLWrapper::GLWrapper(int width, int height, const char *title, void* rawbw, RenderMode mode) {
 
 	this->width = width;
 	this->height = height;
 	this->title = title;
 	this->fps = 60;
 	this->running = true;
+	this->frameLimit = 0;
 	this->renderer = NULL;
+	this->updater = NULL;
+	this->threadRenderer = NULL;
+	this->renderStop = NULL;
 	this->bw = rawbw;
+	this->window = NULL;
+	this->headlessContext = NULL;
+	this->mode = mode;
+
+	if (mode == RENDER_NULL)
+	{
+		NullRenderer::install();
+		cout << "Null renderer, GL calls are counted and discarded.." << endl;
+		return;
+	}
+
+	if (mode == RENDER_HEADLESS)
+	{
+#ifdef __EMSCRIPTEN__
+		cout << "Headless mode is only available in native builds" << endl;
+		exit(EXIT_FAILURE);
+#else
+		headlessContext = new HeadlessContext();
+		if (!headlessContext->create(width, height) || !gladLoadGLES2Loader((GLADloadproc)eglGetProcAddress))
+		{
+			cout << "Failed to create headless context - exiting" << endl;
+			exit(EXIT_FAILURE);
+		}
+
+		cout << "Headless EGL context done.." << endl;
+		DisplayVersion();
+		return;
+#endif
+	}
 
 	/* Initialise GLFW and exit if it fails */
 	if (!glfwInit()) 
@@ -47,10 +96,19 @@ GLWrapper::GLWrapper(int width, int height, const char *title, void* rawbw) {
 
 	cout << "GLFW init done.."<< endl;
 
-	glfwWindowHint(GLFW_SAMPLES, 8);
+	// Antialiasing is done by MultisampleTarget so its level can change while running, the resolve into the window
+	// needs the window's own framebuffer to be single sampled
+	glfwWindowHint(GLFW_SAMPLES, 0);
+#ifdef __EMSCRIPTEN__
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#else
+	// Shaders are GLSL ES 3.00 and glad loads GLES functions, so ask for the same API WebGL 2 gives the web build
+	glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_ES_API);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+#endif
 #ifdef DEBUG
 	glfwOpenWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
 #endif
@@ -97,7 +155,10 @@ GLWrapper::GLWrapper(int width, int height, const char *title, void* rawbw) {
 
 /* Terminate GLFW on destruvtion of the wrapepr object */
 GLWrapper::~GLWrapper() {
-	glfwTerminate();
+#ifndef __EMSCRIPTEN__
+	delete headlessContext;
+#endif
+	if (window) glfwTerminate();
 }
 
 /* Returns the GLFW window handle, required to call GLFW functions outside this class */
@@ -115,7 +176,7 @@ void GLWrapper::DisplayVersion()
 	/* One way to get OpenGL version*/
 	int major, minor;
 	glGetIntegerv(GL_MAJOR_VERSION, &major);
-	glGetIntegerv(GL_MAJOR_VERSION, &minor);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
 	cout << "OpenGL Version = " << major << "." << minor << endl;
 	
 	/* A more detailed way to the version strings*/
@@ -131,17 +192,54 @@ static bool test() {
 
 void webLoop(void* userData) {
 		GLWrapper *glw = static_cast<GLWrapper*>(userData);
+		if (glw->updater)
+		{
+			glw->updater(glw->bw);
+		}
 		glw->renderer(glw->bw);
 		//test();
 
+		glw->present();
+		if (glw->window)
+		{
+			glfwPollEvents();
+		}
+}
 
-		// Swap buffers
-		glfwSwapBuffers(glw->window);
-		glfwPollEvents();
+void GLWrapper::present()
+{
+	// Swap buffers
+	PROFILE_SCOPE("swapBuffers");
+#ifndef __EMSCRIPTEN__
+	if (headlessContext)
+	{
+		headlessContext->swapBuffers();
+	}
+	else
+#endif
+	if (window)
+	{
+		glfwSwapBuffers(window);
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glUseProgram(0);
+}
 
-		glBindVertexArray(0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-        glUseProgram(0);
+void GLWrapper::makeContextCurrent(bool current)
+{
+#ifndef __EMSCRIPTEN__
+	if (headlessContext)
+	{
+		headlessContext->makeCurrent(current);
+	}
+	else
+#endif
+	if (window)
+	{
+		glfwMakeContextCurrent(current ? window : NULL);
+	}
 }
 
 /*
@@ -151,11 +249,127 @@ and then starts the event loop which runs until the program ends
 int GLWrapper::eventLoop()
 {
 	cout << "render loop starting..." << endl;
+#ifdef __EMSCRIPTEN__
 	//emscripten_request_animation_frame_loop(webLoop, this);
 	emscripten_set_main_loop_arg(webLoop, this, 0, 1);
+#else
+	// Native builds drive frames themselves, until the window closes or the frame limit is reached
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	AllocationCounts startAllocations = allocationCounts();
+	NullRenderer::resetCounts();
+	GpuTimer::resetStats();
+	int frames = 0;
+	if (threadRenderer)
+	{
+		// The render thread draws frame N while this one polls input and runs the updater for frame N + 1
+		int rendered = 0;
+		makeContextCurrent(false);
+		thread renderThread([this, &rendered]() {
+			Profiler::setThreadName("render");
+			makeContextCurrent(true);
+			while (threadRenderer(bw))
+			{
+				present();
+				rendered++;
+			}
+			makeContextCurrent(false);
+		});
+
+		while (running)
+		{
+			if (window)
+			{
+				glfwPollEvents();
+			}
+			updater(bw);
+			frames++;
+
+			if ((frameLimit > 0 && frames >= frameLimit) || (window && glfwWindowShouldClose(window)))
+			{
+				running = false;
+			}
+		}
+
+		// Everything the updater published is drawn before the render thread ends
+		renderStop(bw);
+		renderThread.join();
+		makeContextCurrent(true);
+		frames = rendered;
+	}
+	else
+	{
+		while (running)
+		{
+			webLoop(this);
+			frames++;
+
+			if ((frameLimit > 0 && frames >= frameLimit) || (window && glfwWindowShouldClose(window)))
+			{
+				running = false;
+			}
+		}
+	}
+
+	double seconds = millisecondsSince(start) / 1000.0;
+	AllocationCounts endAllocations = allocationCounts();
+	cout << "Rendered " << frames << " frames in " << seconds << " s (" << (seconds * 1000.0 / frames) << " ms per frame)" << endl;
+	cout << "Allocations per frame: " << (endAllocations.allocations - startAllocations.allocations) / frames << " ("
+		<< (endAllocations.bytes - startAllocations.bytes) / frames << " bytes)" << endl;
+	GpuTimer::printStats();
+	if (mode == RENDER_NULL)
+	{
+		NullRenderer::printCounts(frames);
+	}
+#endif
 	return 0;
 }
 
+void GLWrapper::getFramebufferSize(int *width, int *height)
+{
+	if (mode == RENDER_WINDOW)
+	{
+		glfwGetFramebufferSize(window, width, height);
+	}
+	else
+	{
+		*width = this->width;
+		*height = this->height;
+	}
+}
+
+/* Read back the default framebuffer, rows are flipped since GL's origin is the bottom left */
+bool GLWrapper::saveScreenshot(const char *path)
+{
+	if (mode == RENDER_NULL)
+	{
+		cout << "Nothing is rendered by the null renderer, no screenshot saved" << endl;
+		return false;
+	}
+
+	vector<unsigned char> pixels(width * height * 4);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+
+	ofstream file(path, ios::out | ios::binary | ios::trunc);
+	if (!file.is_open())
+	{
+		cerr << "Could not write screenshot " << path << endl;
+		return false;
+	}
+
+	file << "P6\n" << width << " " << height << "\n255\n";
+	for (int y = height - 1; y >= 0; y--)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			file.write((const char*)&pixels[(y * width + x) * 4], 3);
+		}
+	}
+
+	cout << "Saved screenshot " << path << endl;
+	return file.good();
+}
+
 /* Register an error callback function */
 void GLWrapper::setErrorCallback(void(*func)(int error, const char* description))
 {
@@ -167,22 +381,34 @@ void GLWrapper::setRenderer(void(*func)(void* bw)) {
 	this->renderer = func;
 }
 
+void GLWrapper::setUpdater(void(*func)(void* bw)) {
+	this->updater = func;
+}
+
+/* Only native builds have a render thread, the web build keeps calling the updater and renderer in turn */
+void GLWrapper::setRenderThread(bool(*render)(void* bw), void(*stop)(void* bw)) {
+#ifndef __EMSCRIPTEN__
+	this->threadRenderer = render;
+	this->renderStop = stop;
+#endif
+}
+
 /* Register a callback that runs after the window gets resized */
 void GLWrapper::setReshapeCallback(void(*func)(GLFWwindow* window, int w, int h)) {
-	glfwSetFramebufferSizeCallback(window, func);
+	if (window) glfwSetFramebufferSizeCallback(window, func);
 }
 
 
 /* Register a callback to respond to keyboard events */
 void GLWrapper::setKeyCallback(void(*func)(GLFWwindow* window, int key, int scancode, int action, int mods))
 {
-	glfwSetKeyCallback(window, func);
+	if (window) glfwSetKeyCallback(window, func);
 }
 
 /* Register a callback to respond to mouse events */
 void GLWrapper::setMouseCallback(void(*func)(GLFWwindow* window, double xpos, double ypos))
 {
-	glfwSetCursorPosCallback(window, func);
+	if (window) glfwSetCursorPosCallback(window, func);
 }
 
 /* Build shaders from strings containing shader source code */
@@ -223,49 +449,61 @@ GLuint GLWrapper::BuildShader(GLenum eShaderType, const string &shaderText)
 	return shader;
 }
 
-/* Read a text file into a string*/
+/* Read a text file from the asset pack into a string*/
 string GLWrapper::readFile(const char *filePath)
 {
-	string content;
-	ifstream fileStream(filePath, ios::in);
-
-	if (!fileStream.is_open()) {
+	AssetData file;
+	if (!AssetPack::instance().read(filePath, file)) {
 		cerr << "Could not read file " << filePath << ". File does not exist." << endl;
 		return "";
 	}
 
-	string line = "";
-	while (!fileStream.eof()) {
-		getline(fileStream, line);
-		content.append(line + "\n");
-	}
-
-	fileStream.close();
-	return content;
+	return file.toString();
 }
 
 /* Load vertex and fragment shader and return the compiled program */
-GLuint GLWrapper::LoadShader(const char *vertex_path, const char *fragment_path)
+GLuint GLWrapper::LoadShader(const char *vertex_path, const char *fragment_path, const vector<string> &defines)
 {
 	GLuint vertShader, fragShader;
-
-	// Read shaders
-	string vertShaderStr = readFile(vertex_path);
-	string fragShaderStr = readFile(fragment_path);
+	ShaderBuildStats& stats = ShaderLibrary::stats();
+	stats.programs++;
+
+	// Read shaders, embedded at build time, with includes and variant defines expanded
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	string vertShaderStr = ShaderLibrary::preprocess(vertex_path, defines);
+	string fragShaderStr = ShaderLibrary::preprocess(fragment_path, defines);
+	stats.preprocessMs += millisecondsSince(start);
+
+	// Reuse the program linked on a previous run if the driver still accepts it
+	start = chrono::steady_clock::now();
+	GLuint program = ShaderLibrary::loadCachedProgram(vertShaderStr, fragShaderStr);
+	if (program)
+	{
+		stats.cacheHits++;
+		stats.cacheLoadMs += millisecondsSince(start);
+		return program;
+	}
 
 	GLint result = GL_FALSE;
 	int logLength;
 
+	// Compile status is queried in BuildShader so this includes the driver's real compile time
+	start = chrono::steady_clock::now();
 	vertShader = BuildShader(GL_VERTEX_SHADER, vertShaderStr);
 	fragShader = BuildShader(GL_FRAGMENT_SHADER, fragShaderStr);
+	stats.compileMs += millisecondsSince(start);
 
 	cout << "Linking program" << endl;
-	GLuint program = glCreateProgram();
+	start = chrono::steady_clock::now();
+	program = glCreateProgram();
+	ShaderLibrary::prepareForCaching(program);
 	glAttachShader(program, vertShader);
 	glAttachShader(program, fragShader);
 	glLinkProgram(program);
 
 	glGetProgramiv(program, GL_LINK_STATUS, &result);
+	stats.linkMs += millisecondsSince(start);
+
 	glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
 	vector<char> programError((logLength > 1) ? logLength : 1);
 	glGetProgramInfoLog(program, logLength, NULL, &programError[0]);
@@ -274,6 +512,11 @@ GLuint GLWrapper::LoadShader(const char *vertex_path, const char *fragment_path)
 	glDeleteShader(vertShader);
 	glDeleteShader(fragShader);
 
+	if (result == GL_TRUE)
+	{
+		ShaderLibrary::storeCachedProgram(program, vertShaderStr, fragShaderStr);
+	}
+
 	return program;
 }
 
@@ -6,11 +6,21 @@ Iain Martin August 2014
 #pragma once
 
 #include <string>
+#include <vector>
 
 /* Inlcude GL_Load and GLFW */
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+class HeadlessContext;
+
+/*
+	RENDER_WINDOW		GLFW window (a canvas on the web)
+	RENDER_HEADLESS		offscreen EGL context, native builds only
+	RENDER_NULL			no context, GL calls are counted and discarded (NullRenderer.h)
+*/
+enum RenderMode { RENDER_WINDOW, RENDER_HEADLESS, RENDER_NULL };
+
 class GLWrapper {
 private:
 
@@ -19,26 +29,55 @@ private:
 	const char *title;
 	double fps;
 	bool running;
+	int frameLimit;
 
 public:
-	GLWrapper(int width, int height, const char *title, void* rawbw);
+	GLWrapper(int width, int height, const char *title, void* rawbw, RenderMode mode = RENDER_WINDOW);
 	~GLWrapper();//
 
 	void setFPS(double fps) {
 		this->fps = fps;
 	}
 
+	/* Stop the native event loop after this many frames, 0 runs until the window is closed */
+	void setFrameLimit(int frames) {
+		this->frameLimit = frames;
+	}
+
+	/* End the native event loop after the current frame */
+	void stop() {
+		this->running = false;
+	}
+
+	/* Make the GL context current on the calling thread, or release it so another thread can take it */
+	void makeContextCurrent(bool current);
+
+	/* Show the frame just rendered */
+	void present();
+
+	/* Size of the framebuffer frames are drawn to, in pixels */
+	void getFramebufferSize(int *width, int *height);
+
+	/* Write the current frame to a binary PPM image */
+	bool saveScreenshot(const char *path);
+
 	void DisplayVersion();
 
 	/* Callback registering functions */
 	void setRenderer(void(*f)(void* bw));
+	/* Simulation and input for a frame, on the main thread before the renderer draws it */
+	void setUpdater(void(*f)(void* bw));
+	/* Native builds: draw frames on a render thread that owns the GL context, while the main thread runs the updater
+	   for the next one. render returns false when there are no more frames, stop is called to make it do so once the
+	   loop ends */
+	void setRenderThread(bool(*render)(void* bw), void(*stop)(void* bw));
 	void setReshapeCallback(void(*f)(GLFWwindow* window, int w, int h));
 	void setKeyCallback(void(*f)(GLFWwindow* window, int key, int scancode, int action, int mods));
 	void setErrorCallback(void(*f)(int error, const char* description));
 	void setMouseCallback(void(*func)(GLFWwindow* window, double xpos, double ypos));
 
 	/* Shader load and build support functions */
-	GLuint LoadShader(const char *vertex_path, const char *fragment_path);
+	GLuint LoadShader(const char *vertex_path, const char *fragment_path, const std::vector<std::string> &defines = std::vector<std::string>());
 	GLuint BuildShader(GLenum eShaderType, const std::string &shaderText);
 	GLuint BuildShaderProgram(std::string vertShaderStr, std::string fragShaderStr);
 	std::string readFile(const char *filePath);
@@ -47,7 +86,12 @@ public:
 	GLFWwindow* getWindow();
 
 	GLFWwindow* window;
+	HeadlessContext* headlessContext;
+	RenderMode mode;
 	void(*renderer)(void* bw);
+	void(*updater)(void* bw);
+	bool(*threadRenderer)(void* bw);
+	void(*renderStop)(void* bw);
 
 	void* bw;
 
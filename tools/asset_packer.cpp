@@ -0,0 +1,168 @@
+/*
+	Offline asset packer. Walks an asset folder and writes every file into a single BlockWorld.pack
+	(layout described in src/AssetPack.h). Entries are LZ4 compressed when that saves at least 10%,
+	already compressed formats such as jpg/png end up stored raw so they can be read with zero copies.
+
+	Usage: asset_packer <asset folder> <output pack> [more asset folders...] [--no-compress]
+	Extra folders (e.g. generated compressed textures) are merged in with paths relative to their own root.
+	Sameer Al Harbi 2022
+*/
+
+#include "../src/AssetPack.h"
+#include "../src/LZ4Block.h"
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+struct PackInput
+{
+	string name;
+	vector<unsigned char> stored;
+	uint64_t size;
+	uint32_t flags;
+	uint64_t hash;
+};
+
+static bool readFile(const fs::path& path, vector<unsigned char>& out)
+{
+	ifstream file(path, ios::in | ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+	out.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+	return true;
+}
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		cout << "Usage: asset_packer <asset folder> <output pack> [more asset folders...] [--no-compress]" << endl;
+		return 1;
+	}
+
+	vector<fs::path> roots;
+	roots.push_back(argv[1]);
+	fs::path output = argv[2];
+	bool compress = true;
+
+	for (int i = 3; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--no-compress") == 0) compress = false;
+		else roots.push_back(argv[i]);
+	}
+
+	vector<PackInput> inputs;
+	uint64_t rawTotal = 0;
+
+	for (const fs::path& root : roots)
+	{
+		for (const fs::directory_entry& entry : fs::recursive_directory_iterator(root))
+		{
+			if (!entry.is_regular_file())
+			{
+				continue;
+			}
+
+			PackInput input;
+			input.name = fs::relative(entry.path(), root).generic_string();
+
+			vector<unsigned char> raw;
+			if (!readFile(entry.path(), raw))
+			{
+				cerr << "Could not read " << entry.path() << endl;
+				return 1;
+			}
+
+			input.size = raw.size();
+			input.flags = 0;
+			input.hash = assetNameHash(input.name.data(), input.name.size());
+			rawTotal += raw.size();
+
+			vector<unsigned char> packed;
+			if (compress && LZ4Block::compress(raw.data(), raw.size(), packed) && packed.size() < raw.size() * 9 / 10)
+			{
+				input.stored.swap(packed);
+				input.flags |= ASSET_PACK_FLAG_LZ4;
+			}
+			else
+			{
+				input.stored.swap(raw);
+			}
+
+			inputs.push_back(move(input));
+		}
+	}
+
+	//Entries are looked up with a binary search over the hash
+	sort(inputs.begin(), inputs.end(), [](const PackInput& a, const PackInput& b) { return a.hash < b.hash; });
+
+	string names;
+	vector<AssetPackEntry> toc(inputs.size());
+	for (size_t i = 0; i < inputs.size(); i++)
+	{
+		toc[i] = AssetPackEntry();
+		toc[i].nameHash = inputs[i].hash;
+		toc[i].nameOffset = (uint32_t)names.size();
+		toc[i].nameLength = (uint32_t)inputs[i].name.size();
+		toc[i].storedSize = inputs[i].stored.size();
+		toc[i].size = inputs[i].size;
+		toc[i].flags = inputs[i].flags;
+		names += inputs[i].name;
+	}
+
+	AssetPackHeader header;
+	memcpy(header.magic, ASSET_PACK_MAGIC, 4);
+	header.version = ASSET_PACK_VERSION;
+	header.entryCount = (uint32_t)inputs.size();
+	header.alignment = ASSET_PACK_ALIGNMENT;
+	header.namesOffset = sizeof(AssetPackHeader) + toc.size() * sizeof(AssetPackEntry);
+	header.namesSize = names.size();
+
+	//Lay out blobs after the name table, each one aligned
+	uint64_t offset = header.namesOffset + header.namesSize;
+	for (size_t i = 0; i < inputs.size(); i++)
+	{
+		offset = alignUp(offset, ASSET_PACK_ALIGNMENT);
+		toc[i].dataOffset = offset;
+		offset += toc[i].storedSize;
+	}
+
+	ofstream out(output, ios::out | ios::binary | ios::trunc);
+	if (!out.is_open())
+	{
+		cerr << "Could not write " << output << endl;
+		return 1;
+	}
+
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)toc.data(), toc.size() * sizeof(AssetPackEntry));
+	out.write(names.data(), names.size());
+
+	uint64_t written = header.namesOffset + header.namesSize;
+	const char zeros[ASSET_PACK_ALIGNMENT] = { 0 };
+	for (size_t i = 0; i < inputs.size(); i++)
+	{
+		out.write(zeros, toc[i].dataOffset - written);
+		out.write((const char*)inputs[i].stored.data(), inputs[i].stored.size());
+		written = toc[i].dataOffset + toc[i].storedSize;
+
+		cout << inputs[i].name << " " << inputs[i].size << " -> " << toc[i].storedSize
+			<< ((toc[i].flags & ASSET_PACK_FLAG_LZ4) ? " (lz4)" : "") << endl;
+	}
+
+	cout << "Packed " << inputs.size() << " assets, " << rawTotal << " bytes -> " << written << " bytes" << endl;
+	return out.good() ? 0 : 1;
+}
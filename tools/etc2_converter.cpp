@@ -0,0 +1,512 @@
+/*
+	Offline texture converter producing ETC2 compressed KTX files with a full mip chain.
+	ETC2 RGB8 and RGBA8 (ETC2 colour + EAC alpha) are core formats in OpenGL ES 3.0, so the runtime can hand
+	these straight to glCompressedTexImage2D without decoding anything.
+
+	Colour blocks are encoded in the ETC1 compatible individual/differential modes (valid ETC2) with an exhaustive
+	search over both sub block flips and all 8 intensity tables. Alpha blocks use EAC with a search over all
+	16 modifier tables and multipliers. Opaque inputs are written as RGB8, anything with alpha as RGBA8.
+
+	Usage: etc2_converter [--flip] [--no-mips] <output.ktx> <image>            - 2D texture
+	       etc2_converter [--flip] [--no-mips] <output.ktx> <+x> <-x> <+y> <-y> <+z> <-z> - cube map
+	       etc2_converter [--flip] [--no-mips] --array <output.ktx> <layer 0> [layer 1...] - 2D array texture
+	Sameer Al Harbi 2022
+*/
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+
+//Values from the OpenGL ES 3.0 headers, the tool doesn't need a GL context
+const uint32_t GL_RGB_ = 0x1907;
+const uint32_t GL_RGBA_ = 0x1908;
+const uint32_t GL_COMPRESSED_RGB8_ETC2_ = 0x9274;
+const uint32_t GL_COMPRESSED_RGBA8_ETC2_EAC_ = 0x9278;
+
+const unsigned char KTX_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+using namespace std;
+
+//RGBA8 image, rows top to bottom in the order they will be uploaded
+struct Image
+{
+	int width;
+	int height;
+	vector<unsigned char> pixels;
+};
+
+static const int ETC_TABLES[8][2] = { {2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183} };
+
+static const int EAC_TABLES[16][8] = {
+	{-3, -6, -9, -15, 2, 5, 8, 14}, {-3, -7, -10, -13, 2, 6, 9, 12}, {-2, -5, -8, -13, 1, 4, 7, 12}, {-2, -4, -6, -13, 1, 3, 5, 12},
+	{-3, -6, -8, -12, 2, 5, 7, 11}, {-3, -7, -9, -11, 2, 6, 8, 10}, {-4, -7, -8, -11, 3, 6, 7, 10}, {-3, -5, -8, -11, 2, 4, 7, 10},
+	{-2, -6, -8, -10, 1, 5, 7, 9}, {-2, -5, -8, -10, 1, 4, 7, 9}, {-2, -4, -8, -10, 1, 3, 7, 9}, {-2, -5, -7, -10, 1, 4, 6, 9},
+	{-3, -4, -7, -10, 2, 3, 6, 9}, {-1, -2, -3, -10, 0, 1, 2, 9}, {-4, -6, -8, -9, 3, 5, 7, 8}, {-3, -5, -7, -9, 2, 4, 6, 8}
+};
+
+static int clamp255(int v)
+{
+	return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+/*
+	ETC colour block
+*/
+
+//Result of encoding one 2x4 / 4x2 half of a block
+struct SubBlockFit
+{
+	int table;
+	int indices[8]; //Modifier index per pixel (0: +a, 1: +b, 2: -a, 3: -b)
+	long error;
+};
+
+//Find the best table and per pixel modifiers for 8 pixels around an (already quantised and expanded) base colour
+static SubBlockFit fitSubBlock(const int pixels[8][3], const int base[3])
+{
+	SubBlockFit best;
+	best.error = -1;
+
+	for (int t = 0; t < 8; t++)
+	{
+		const int modifiers[4] = { ETC_TABLES[t][0], ETC_TABLES[t][1], -ETC_TABLES[t][0], -ETC_TABLES[t][1] };
+
+		SubBlockFit fit;
+		fit.table = t;
+		fit.error = 0;
+
+		for (int p = 0; p < 8; p++)
+		{
+			long bestPixel = -1;
+			for (int m = 0; m < 4; m++)
+			{
+				long e = 0;
+				for (int c = 0; c < 3; c++)
+				{
+					int d = clamp255(base[c] + modifiers[m]) - pixels[p][c];
+					e += d * d;
+				}
+				if (bestPixel < 0 || e < bestPixel)
+				{
+					bestPixel = e;
+					fit.indices[p] = m;
+				}
+			}
+			fit.error += bestPixel;
+		}
+
+		if (best.error < 0 || fit.error < best.error)
+		{
+			best = fit;
+		}
+	}
+	return best;
+}
+
+static int expand4(int c) { return (c << 4) | c; }
+static int expand5(int c) { return (c << 3) | (c >> 2); }
+
+//Pixel order inside a block is column major: k = x * 4 + y
+static void writeIndices(uint64_t& block, const SubBlockFit& fit, const int pixelIds[8])
+{
+	//Modifier index 0..3 maps to (msb, lsb) = 00, 01, 10, 11
+	for (int p = 0; p < 8; p++)
+	{
+		int k = pixelIds[p];
+		int m = fit.indices[p];
+		block |= (uint64_t)((m >> 1) & 1) << (16 + k);
+		block |= (uint64_t)(m & 1) << k;
+	}
+}
+
+static uint64_t encodeColourBlock(const unsigned char rgba[16][4])
+{
+	uint64_t bestBlock = 0;
+	long bestError = -1;
+
+	for (int flip = 0; flip < 2; flip++)
+	{
+		int pixels[2][8][3];
+		int pixelIds[2][8];
+		double average[2][3] = { {0, 0, 0}, {0, 0, 0} };
+		int count[2] = { 0, 0 };
+
+		for (int y = 0; y < 4; y++)
+		{
+			for (int x = 0; x < 4; x++)
+			{
+				int half = flip ? (y >= 2) : (x >= 2);
+				int n = count[half]++;
+				for (int c = 0; c < 3; c++)
+				{
+					pixels[half][n][c] = rgba[y * 4 + x][c];
+					average[half][c] += rgba[y * 4 + x][c];
+				}
+				pixelIds[half][n] = x * 4 + y;
+			}
+		}
+
+		//Individual mode, two 4 bit base colours
+		{
+			int q[2][3], base[2][3];
+			for (int h = 0; h < 2; h++)
+			{
+				for (int c = 0; c < 3; c++)
+				{
+					q[h][c] = min(15, max(0, (int)lround(average[h][c] / 8.0 / 17.0)));
+					base[h][c] = expand4(q[h][c]);
+				}
+			}
+
+			SubBlockFit a = fitSubBlock(pixels[0], base[0]);
+			SubBlockFit b = fitSubBlock(pixels[1], base[1]);
+			long error = a.error + b.error;
+
+			if (bestError < 0 || error < bestError)
+			{
+				uint64_t block = 0;
+				block |= (uint64_t)q[0][0] << 60 | (uint64_t)q[1][0] << 56;
+				block |= (uint64_t)q[0][1] << 52 | (uint64_t)q[1][1] << 48;
+				block |= (uint64_t)q[0][2] << 44 | (uint64_t)q[1][2] << 40;
+				block |= (uint64_t)a.table << 37 | (uint64_t)b.table << 34;
+				block |= (uint64_t)flip << 32;
+				writeIndices(block, a, pixelIds[0]);
+				writeIndices(block, b, pixelIds[1]);
+				bestBlock = block;
+				bestError = error;
+			}
+		}
+
+		//Differential mode, 5 bit base plus a 3 bit signed delta. The delta is clamped so the second colour never
+		//leaves 0..31, an overflow there would be read as one of the ETC2 T/H/planar modes instead
+		{
+			int q[2][3], delta[3], base[2][3];
+			for (int c = 0; c < 3; c++)
+			{
+				q[0][c] = min(31, max(0, (int)lround(average[0][c] / 8.0 * 31.0 / 255.0)));
+				int second = min(31, max(0, (int)lround(average[1][c] / 8.0 * 31.0 / 255.0)));
+				delta[c] = min(3, max(-4, second - q[0][c]));
+				q[1][c] = q[0][c] + delta[c];
+				base[0][c] = expand5(q[0][c]);
+				base[1][c] = expand5(q[1][c]);
+			}
+
+			SubBlockFit a = fitSubBlock(pixels[0], base[0]);
+			SubBlockFit b = fitSubBlock(pixels[1], base[1]);
+			long error = a.error + b.error;
+
+			if (error < bestError)
+			{
+				uint64_t block = 0;
+				block |= (uint64_t)q[0][0] << 59 | (uint64_t)(delta[0] & 7) << 56;
+				block |= (uint64_t)q[0][1] << 51 | (uint64_t)(delta[1] & 7) << 48;
+				block |= (uint64_t)q[0][2] << 43 | (uint64_t)(delta[2] & 7) << 40;
+				block |= (uint64_t)a.table << 37 | (uint64_t)b.table << 34;
+				block |= (uint64_t)1 << 33;
+				block |= (uint64_t)flip << 32;
+				writeIndices(block, a, pixelIds[0]);
+				writeIndices(block, b, pixelIds[1]);
+				bestBlock = block;
+				bestError = error;
+			}
+		}
+	}
+
+	return bestBlock;
+}
+
+/*
+	EAC alpha block
+*/
+static uint64_t encodeAlphaBlock(const unsigned char rgba[16][4])
+{
+	int amin = 255, amax = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		amin = min(amin, (int)rgba[i][3]);
+		amax = max(amax, (int)rgba[i][3]);
+	}
+
+	uint64_t bestBlock = 0;
+	long bestError = -1;
+
+	for (int t = 0; t < 16 && bestError != 0; t++)
+	{
+		const int* table = EAC_TABLES[t];
+		for (int multiplier = 1; multiplier < 16 && bestError != 0; multiplier++)
+		{
+			//Centre the table's range over the block's alpha range and try the neighbouring bases too
+			int centre = (int)lround((amin + amax) / 2.0 - multiplier * (table[3] + table[7]) / 2.0);
+			for (int base = centre - 1; base <= centre + 1; base++)
+			{
+				if (base < 0 || base > 255) continue;
+
+				uint64_t block = (uint64_t)base << 56 | (uint64_t)multiplier << 52 | (uint64_t)t << 48;
+				long error = 0;
+
+				for (int y = 0; y < 4; y++)
+				{
+					for (int x = 0; x < 4; x++)
+					{
+						int a = rgba[y * 4 + x][3];
+						int bestIndex = 0;
+						long bestPixel = -1;
+						for (int m = 0; m < 8; m++)
+						{
+							int d = clamp255(base + table[m] * multiplier) - a;
+							if (bestPixel < 0 || d * d < bestPixel)
+							{
+								bestPixel = d * d;
+								bestIndex = m;
+							}
+						}
+						error += bestPixel;
+						block |= (uint64_t)bestIndex << (45 - 3 * (x * 4 + y));
+					}
+				}
+
+				if (bestError < 0 || error < bestError)
+				{
+					bestError = error;
+					bestBlock = block;
+				}
+			}
+		}
+	}
+
+	return bestBlock;
+}
+
+static void writeBigEndian(vector<unsigned char>& out, uint64_t block)
+{
+	for (int i = 7; i >= 0; i--)
+	{
+		out.push_back((unsigned char)(block >> (i * 8)));
+	}
+}
+
+//Encode one row of 4x4 blocks
+static void compressBlockRow(const Image& image, bool alpha, int by, vector<unsigned char>& out)
+{
+	for (int bx = 0; bx < image.width; bx += 4)
+	{
+		//Blocks hanging off the edge of small mips repeat the edge pixels
+		unsigned char rgba[16][4];
+		for (int y = 0; y < 4; y++)
+		{
+			for (int x = 0; x < 4; x++)
+			{
+				int sx = min(bx + x, image.width - 1);
+				int sy = min(by + y, image.height - 1);
+				memcpy(rgba[y * 4 + x], &image.pixels[(sy * image.width + sx) * 4], 4);
+			}
+		}
+
+		if (alpha)
+		{
+			writeBigEndian(out, encodeAlphaBlock(rgba));
+		}
+		writeBigEndian(out, encodeColourBlock(rgba));
+	}
+}
+
+//Block rows are independent so they are spread over all cores, the search is exhaustive and slow on big skybox faces
+static vector<unsigned char> compressImage(const Image& image, bool alpha)
+{
+	int numRows = (image.height + 3) / 4;
+	vector<vector<unsigned char>> rows(numRows);
+	atomic<int> nextRow(0);
+
+	vector<thread> workers(max(1u, thread::hardware_concurrency()));
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i] = thread([&]() {
+			for (int row = nextRow++; row < numRows; row = nextRow++)
+			{
+				compressBlockRow(image, alpha, row * 4, rows[row]);
+			}
+		});
+	}
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+
+	vector<unsigned char> out;
+	for (int row = 0; row < numRows; row++)
+	{
+		out.insert(out.end(), rows[row].begin(), rows[row].end());
+	}
+	return out;
+}
+
+//2x2 box filter, odd sizes clamp to the edge
+static Image downsample(const Image& image)
+{
+	Image half;
+	half.width = max(1, image.width / 2);
+	half.height = max(1, image.height / 2);
+	half.pixels.resize(half.width * half.height * 4);
+
+	for (int y = 0; y < half.height; y++)
+	{
+		for (int x = 0; x < half.width; x++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				int sum = 0;
+				for (int dy = 0; dy < 2; dy++)
+				{
+					for (int dx = 0; dx < 2; dx++)
+					{
+						int sx = min(x * 2 + dx, image.width - 1);
+						int sy = min(y * 2 + dy, image.height - 1);
+						sum += image.pixels[(sy * image.width + sx) * 4 + c];
+					}
+				}
+				half.pixels[(y * half.width + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+	return half;
+}
+
+static bool loadImage(const char* path, bool flip, Image& image)
+{
+	int channels;
+	unsigned char* data = stbi_load(path, &image.width, &image.height, &channels, 4);
+	if (!data)
+	{
+		cerr << "Could not load " << path << endl;
+		return false;
+	}
+
+	image.pixels.assign(data, data + image.width * image.height * 4);
+	stbi_image_free(data);
+
+	if (flip)
+	{
+		size_t row = image.width * 4;
+		for (int y = 0; y < image.height / 2; y++)
+		{
+			swap_ranges(image.pixels.begin() + y * row, image.pixels.begin() + (y + 1) * row, image.pixels.begin() + (image.height - 1 - y) * row);
+		}
+	}
+	return true;
+}
+
+static void write32(ofstream& out, uint32_t value)
+{
+	out.write((const char*)&value, 4);
+}
+
+int main(int argc, char* argv[])
+{
+	bool flip = false;
+	bool mips = true;
+	bool array = false;
+	vector<const char*> paths;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--flip") == 0) flip = true;
+		else if (strcmp(argv[i], "--no-mips") == 0) mips = false;
+		else if (strcmp(argv[i], "--array") == 0) array = true;
+		else paths.push_back(argv[i]);
+	}
+
+	if (array ? paths.size() < 2 : (paths.size() != 2 && paths.size() != 7))
+	{
+		cout << "Usage: etc2_converter [--flip] [--no-mips] <output.ktx> <image>" << endl;
+		cout << "       etc2_converter [--flip] [--no-mips] <output.ktx> <+x> <-x> <+y> <-y> <+z> <-z>" << endl;
+		cout << "       etc2_converter [--flip] [--no-mips] --array <output.ktx> <layer 0> [layer 1...]" << endl;
+		return 1;
+	}
+
+	const char* output = paths[0];
+	vector<Image> faces(paths.size() - 1);
+	bool alpha = false;
+
+	for (size_t f = 0; f < faces.size(); f++)
+	{
+		if (!loadImage(paths[f + 1], flip, faces[f]))
+		{
+			return 1;
+		}
+		if (faces[f].width != faces[0].width || faces[f].height != faces[0].height)
+		{
+			cerr << (array ? "Array layers" : "Cube map faces") << " must all be the same size" << endl;
+			return 1;
+		}
+		for (size_t p = 3; p < faces[f].pixels.size(); p += 4)
+		{
+			alpha = alpha || faces[f].pixels[p] != 255;
+		}
+	}
+
+	int width = faces[0].width;
+	int height = faces[0].height;
+	int numLevels = 1;
+	if (mips)
+	{
+		while ((max(width, height) >> (numLevels - 1)) > 1) numLevels++;
+	}
+
+	ofstream out(output, ios::out | ios::binary | ios::trunc);
+	if (!out.is_open())
+	{
+		cerr << "Could not write " << output << endl;
+		return 1;
+	}
+
+	out.write((const char*)KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER));
+	write32(out, 0x04030201); //endianness
+	write32(out, 0); //glType, 0 for compressed
+	write32(out, 1); //glTypeSize
+	write32(out, 0); //glFormat, 0 for compressed
+	write32(out, alpha ? GL_COMPRESSED_RGBA8_ETC2_EAC_ : GL_COMPRESSED_RGB8_ETC2_);
+	write32(out, alpha ? GL_RGBA_ : GL_RGB_);
+	write32(out, width);
+	write32(out, height);
+	write32(out, 0); //pixelDepth
+	//Array layers are stored like faces but share one imageSize per level
+	write32(out, array ? (uint32_t)faces.size() : 0); //numberOfArrayElements
+	write32(out, array ? 1 : (uint32_t)faces.size()); //numberOfFaces
+	write32(out, numLevels);
+	write32(out, 0); //bytesOfKeyValueData
+
+	size_t rawBytes = 0, compressedBytes = 0;
+	for (int level = 0; level < numLevels; level++)
+	{
+		vector<vector<unsigned char>> blocks(faces.size());
+		for (size_t f = 0; f < faces.size(); f++)
+		{
+			blocks[f] = compressImage(faces[f], alpha);
+			rawBytes += faces[f].width * faces[f].height * (alpha ? 4 : 3);
+			compressedBytes += blocks[f].size();
+		}
+
+		//ETC blocks are 8 or 16 bytes so faces never need padding
+		write32(out, (uint32_t)(array ? blocks[0].size() * blocks.size() : blocks[0].size()));
+		for (size_t f = 0; f < faces.size(); f++)
+		{
+			out.write((const char*)blocks[f].data(), blocks[f].size());
+			faces[f] = downsample(faces[f]);
+		}
+	}
+
+	cout << output << ": " << width << "x" << height << " " << faces.size() << (array ? " layer(s) " : " face(s) ") << numLevels << " level(s) "
+		<< (alpha ? "RGBA8_ETC2_EAC" : "RGB8_ETC2") << ", " << rawBytes << " bytes uncompressed -> " << compressedBytes << " bytes" << endl;
+
+	return out.good() ? 0 : 1;
+}